@@ -0,0 +1,80 @@
+#pragma once
+#include "framework.h"
+
+#include "DirectX11Handler.h"
+#include "ShaderVariants.h"
+#include "DrawSort.h"
+#include "ThreadPool.h"
+#include "FlatHashMap.h"
+
+// Below this many billboards a frame is expanded on the calling thread
+constexpr size_t RC_BILLBOARD_CHUNK_SIZE = 4096;
+
+struct Billboard {
+	DirectX::XMFLOAT3 position;
+	// Full width and height in world units
+	DirectX::XMFLOAT2 size;
+};
+
+struct BillboardStats {
+	size_t billboards = 0;
+	size_t textures   = 0;
+	size_t draws      = 0;
+
+	float buildMilliseconds = 0.0f;
+};
+
+// Gathers camera facing quads submitted during a frame and draws them as one call per texture.
+// Quads are expanded on the CPU into the backend's dynamic vertex buffer, so billboards need no model, constants or instancing.
+// Inside a texture they are drawn back to front, textures themselves are drawn in the order they were first submitted.
+class BillboardBatcher {
+private:
+	struct TextureBatch {
+		const Texture* texture;
+		uint32_t       first;
+		uint32_t       count;
+	};
+
+	DirectX11Handler* handler       = nullptr;
+	ThreadPool*       scheduler     = nullptr;
+	size_t            threadsAmount = 1;
+
+	DrawSorter       sorter;
+	ShaderVariantSet shaders;
+
+	// Shared by every quad, indices never change so the buffer is only rebuilt when it has to grow
+	Microsoft::WRL::ComPtr<ID3D11Buffer> quadIndexBuffer;
+	size_t                               quadCapacity = 0;
+
+	std::vector<Billboard> billboards;
+	std::vector<uint32_t>  textureOf;
+
+	FlatHashMap<const Texture*, uint32_t> textureIds;
+	std::vector<const Texture*>           textures;
+
+	std::vector<uint64_t>     keys;
+	std::vector<uint32_t>     order;
+	std::vector<TextureBatch> batches;
+
+	BillboardStats stats;
+
+	void reserveQuads(const size_t count);
+
+public:
+	// Drops texels under half alpha and draws without blending, so the order between textures stops mattering
+	bool alphaCutout = false;
+
+	void build(DirectX11Handler* handler, ThreadPool* scheduler, const size_t threadsAmount);
+
+	// Cleared after every frame, submit again each frame a billboard should be visible
+	void submit(const Texture* texture, const Billboard& billboard);
+	void submit(const Texture* texture, const Billboard* billboards, const size_t count);
+
+	// Sorts and expands this frame's billboards facing the camera of view, and records their draws into list.
+	// Textures are only referenced, they have to stay alive until the list is played back
+	void record(CommandList& list, const DirectX::XMMATRIX& view, const DirectX::XMVECTOR& cameraPosition);
+	// Drops this frame's billboards without drawing them
+	void clear();
+
+	const BillboardStats& getStats() const noexcept { return this->stats; }
+};
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+#include "framework.h"
+
+// Axis aligned box and bounding sphere sharing one center
+struct Bounds {
+	DirectX::XMFLOAT3 center  = { 0.0f, 0.0f, 0.0f };
+	// Half sizes of the box
+	DirectX::XMFLOAT3 extents = { 0.0f, 0.0f, 0.0f };
+	float             radius  = 0.0f;
+};
+
+// Min/max and distance reductions over positions that are stride bytes apart, e.g. the position of every Vertex
+Bounds computeBounds(const DirectX::XMFLOAT3* positions, const size_t count, const size_t stride = sizeof(DirectX::XMFLOAT3));
+
+// Moves local bounds into world space without touching the vertices again.
+// The box is refit around the transformed one (Arvo), the sphere grows with the largest axis scale.
+inline Bounds transformBounds(const Bounds& local, const DirectX::XMMATRIX& world) {
+	using namespace DirectX;
+
+	const XMVECTOR extents = XMLoadFloat3(&local.extents);
+
+	XMVECTOR worldExtents = XMVectorMultiply(XMVectorAbs(world.r[0]), XMVectorSplatX(extents));
+	worldExtents          = XMVectorMultiplyAdd(XMVectorAbs(world.r[1]), XMVectorSplatY(extents), worldExtents);
+	worldExtents          = XMVectorMultiplyAdd(XMVectorAbs(world.r[2]), XMVectorSplatZ(extents), worldExtents);
+
+	const float scaleSquared = std::max({ XMVectorGetX(XMVector3LengthSq(world.r[0])),
+										  XMVectorGetX(XMVector3LengthSq(world.r[1])),
+										  XMVectorGetX(XMVector3LengthSq(world.r[2])) });
+
+	Bounds bounds = {};
+	XMStoreFloat3(&bounds.center, XMVector3TransformCoord(XMLoadFloat3(&local.center), world));
+	XMStoreFloat3(&bounds.extents, worldExtents);
+	bounds.radius = local.radius * sqrtf(scaleSquared);
+	return bounds;
+}
\ No newline at end of file
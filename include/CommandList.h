@@ -0,0 +1,168 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+
+// Commands name GPU objects by opaque handles, only the backend playing a list back knows what they point to.
+// Nothing here depends on a graphics API, lists can be recorded and inspected on any platform.
+using GpuHandle = const void*;
+
+constexpr uint8_t RC_COMMAND_VERTEX_STAGE = 1;
+constexpr uint8_t RC_COMMAND_PIXEL_STAGE  = 2;
+constexpr uint8_t RC_COMMAND_ALL_STAGES   = RC_COMMAND_VERTEX_STAGE | RC_COMMAND_PIXEL_STAGE;
+
+// Largest inline constant payload, one 4096 float4 constant buffer
+constexpr uint32_t RC_COMMAND_MAX_CONSTANTS = 65536;
+
+enum class CommandType : uint8_t {
+	SetPipeline,
+	SetGeometry,
+	SetTexture,
+	SetConstants,
+	SetBuffers,
+	SetBlend,
+	Draw,
+};
+
+// Every command is a header followed by size bytes of payload, padded so the next header stays 8 byte aligned
+struct CommandHeader {
+	CommandType type;
+	uint8_t     stages;
+	uint16_t    slot;
+	uint32_t    size;
+};
+
+struct SetPipelineCommand {
+	GpuHandle vertexShader;
+	GpuHandle pixelShader;
+	GpuHandle inputLayout;
+};
+struct SetGeometryCommand {
+	GpuHandle vertexBuffer;
+	GpuHandle indexBuffer;
+	uint32_t  vertexStride;
+	// Also binds the backend's instance buffer to the second vertex slot
+	uint32_t  instanced;
+	// 2 or 4
+	uint32_t  indexBytes;
+};
+struct SetTextureCommand {
+	GpuHandle texture;
+};
+struct SetBlendCommand {
+	uint32_t alphaBlending;
+};
+// An instance count of 0 is a plain indexed draw
+struct DrawCommand {
+	uint32_t indexCount;
+	uint32_t startIndex;
+	uint32_t instanceCount;
+	uint32_t startInstance;
+};
+// SetConstants carries the raw constant bytes as payload, SetBuffers an array of buffer handles
+
+struct CommandListStats {
+	size_t commands = 0;
+	size_t draws    = 0;
+	size_t bytes    = 0;
+};
+
+// Append only buffer of commands. One list belongs to one recording thread, lists are merged by playing them back in order.
+class CommandList {
+private:
+	std::vector<uint64_t> storage;
+	size_t                used = 0;
+
+	CommandListStats stats;
+
+	unsigned char* allocate(const CommandType type, const uint8_t stages, const uint16_t slot, const uint32_t size) {
+		const size_t words = 1 + (size + 7) / 8;
+		if (this->used + words > this->storage.size()) {
+			this->storage.resize(std::max(this->storage.size() * 2, this->used + words));
+		}
+
+		uint64_t* at = this->storage.data() + this->used;
+		this->used  += words;
+
+		const CommandHeader header = { type, stages, slot, size };
+		memcpy(at, &header, sizeof(CommandHeader));
+
+		this->stats.commands++;
+		this->stats.bytes = this->used * 8;
+		return reinterpret_cast<unsigned char*>(at + 1);
+	}
+	template <typename CommandStruct>
+	void append(const CommandType type, const uint8_t stages, const uint16_t slot, const CommandStruct& command) {
+		memcpy(this->allocate(type, stages, slot, sizeof(CommandStruct)), &command, sizeof(CommandStruct));
+	}
+
+public:
+	// Keeps the storage, so a list reused every frame stops allocating once it has grown
+	void reset() {
+		this->used  = 0;
+		this->stats = {};
+	}
+
+	void setPipeline(const GpuHandle vertexShader, const GpuHandle pixelShader, const GpuHandle inputLayout) {
+		this->append(CommandType::SetPipeline, 0, 0, SetPipelineCommand{ vertexShader, pixelShader, inputLayout });
+	}
+	void setGeometry(const GpuHandle vertexBuffer, const GpuHandle indexBuffer, const uint32_t vertexStride, const bool instanced, const uint32_t indexBytes = sizeof(uint32_t)) {
+		this->append(CommandType::SetGeometry, 0, 0, SetGeometryCommand{ vertexBuffer, indexBuffer, vertexStride, instanced ? 1u : 0u, indexBytes });
+	}
+	void setTexture(const uint16_t slot, const GpuHandle texture) {
+		this->append(CommandType::SetTexture, RC_COMMAND_PIXEL_STAGE, slot, SetTextureCommand{ texture });
+	}
+	void setBlend(const bool alphaBlending) {
+		this->append(CommandType::SetBlend, 0, 0, SetBlendCommand{ alphaBlending ? 1u : 0u });
+	}
+
+	// The bytes are copied into the list, the backend uploads them at playback. Size has to be a multiple of 16
+	void setConstants(const uint8_t stages, const uint16_t slot, const void* data, const uint32_t size) {
+		if (size == 0 || size % 16 != 0 || size > RC_COMMAND_MAX_CONSTANTS) return;
+		memcpy(this->allocate(CommandType::SetConstants, stages, slot, size), data, size);
+	}
+	template <typename StructType>
+	void setConstants(const uint8_t stages, const uint16_t slot, const StructType& data) {
+		static_assert(sizeof(StructType) % 16 == 0, "Constant structs are made of whole float4 registers");
+		this->setConstants(stages, slot, &data, sizeof(StructType));
+	}
+	void setBuffers(const uint8_t stages, const uint16_t startSlot, const GpuHandle* buffers, const uint32_t count) {
+		if (count == 0) return;
+		memcpy(this->allocate(CommandType::SetBuffers, stages, startSlot, count * sizeof(GpuHandle)), buffers, count * sizeof(GpuHandle));
+	}
+
+	void draw(const uint32_t indexCount, const uint32_t startIndex) {
+		this->append(CommandType::Draw, 0, 0, DrawCommand{ indexCount, startIndex, 0, 0 });
+		this->stats.draws++;
+	}
+	void drawInstanced(const uint32_t indexCount, const uint32_t startIndex, const uint32_t instanceCount, const uint32_t startInstance) {
+		this->append(CommandType::Draw, 0, 0, DrawCommand{ indexCount, startIndex, instanceCount, startInstance });
+		this->stats.draws++;
+	}
+
+	// Calls fn(header, payload) for every command in recording order
+	template <typename Fn>
+	void forEach(Fn&& fn) const {
+		size_t at = 0;
+		while (at < this->used) {
+			CommandHeader header;
+			memcpy(&header, this->storage.data() + at, sizeof(CommandHeader));
+
+			fn(header, reinterpret_cast<const unsigned char*>(this->storage.data() + at + 1));
+			at += 1 + (header.size + 7) / 8;
+		}
+	}
+
+	// Payload of a fixed size command
+	template <typename CommandStruct>
+	static CommandStruct read(const unsigned char* payload) {
+		CommandStruct command;
+		memcpy(&command, payload, sizeof(CommandStruct));
+		return command;
+	}
+
+	bool empty() const noexcept { return this->used == 0; }
+	const CommandListStats& getStats() const noexcept { return this->stats; }
+};
\ No newline at end of file
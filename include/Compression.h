@@ -0,0 +1,15 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// Matches are searched back this far at most, offsets are stored in two bytes
+constexpr size_t RC_LZ_WINDOW    = 65535;
+constexpr size_t RC_LZ_MIN_MATCH = 4;
+
+// Byte oriented LZ77 in the spirit of LZ4: no entropy coding, so decoding is little more than memcpy.
+// Vertex and index data repeat whole fields often enough to shrink by about half.
+std::vector<uint8_t> lzCompress(const void* data, const size_t size);
+
+// False when data is corrupt or does not expand to exactly size bytes
+bool lzDecompress(const uint8_t* data, const size_t compressedSize, void* out, const size_t size);
\ No newline at end of file
@@ -0,0 +1,97 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+
+constexpr size_t RC_CONSTANT_ALIGNMENT = 256;
+constexpr size_t RC_RING_FULL          = SIZE_MAX;
+
+// CPU side bookkeeping of the constant buffer ring. Every frame allocates forward from head,
+// and its bytes are only handed out again after the frame was retired by its GPU fence.
+class ConstantRingAllocator {
+private:
+	struct FrameMark {
+		uint64_t frame;
+		size_t   end;
+		size_t   bytes;
+	};
+
+	size_t _capacity = 0;
+	size_t head      = 0;
+	size_t tail      = 0;
+	size_t used      = 0;
+
+	// Bytes handed out since the last endFrame, including the tail wasted on a wrap
+	size_t frameBytes = 0;
+
+	std::deque<FrameMark> inFlight;
+
+public:
+	static size_t align(const size_t size) noexcept {
+		return (size + RC_CONSTANT_ALIGNMENT - 1) & ~(RC_CONSTANT_ALIGNMENT - 1);
+	}
+
+	void build(const size_t capacity) {
+		this->_capacity  = capacity - capacity % RC_CONSTANT_ALIGNMENT;
+		this->head       = 0;
+		this->tail       = 0;
+		this->used       = 0;
+		this->frameBytes = 0;
+		this->inFlight.clear();
+	}
+
+	// Returns the offset of a 256 byte aligned block, or RC_RING_FULL. Blocks never wrap around the end.
+	size_t allocate(const size_t size) {
+		const size_t bytes = align(size);
+		if (bytes == 0 || bytes > this->_capacity) return RC_RING_FULL;
+
+		const size_t free = this->_capacity - this->used;
+		if (bytes > free) return RC_RING_FULL;
+
+		if (this->head >= this->tail) {
+			const size_t untilEnd = this->_capacity - this->head;
+			if (bytes > untilEnd) {
+				// The end of the buffer is skipped and stays owned by this frame until it retires
+				if (bytes > this->tail || bytes + untilEnd > free) return RC_RING_FULL;
+
+				this->used       += untilEnd;
+				this->frameBytes += untilEnd;
+				this->head        = 0;
+			}
+		}
+		else if (bytes > this->tail - this->head) {
+			return RC_RING_FULL;
+		}
+
+		const size_t offset = this->head;
+
+		this->head        = (this->head + bytes) % this->_capacity;
+		this->used       += bytes;
+		this->frameBytes += bytes;
+
+		return offset;
+	}
+
+	void endFrame(const uint64_t frame) {
+		this->inFlight.push_back({ frame, this->head, this->frameBytes });
+		this->frameBytes = 0;
+	}
+	// Releases every frame up to and including the given one
+	void retire(const uint64_t completedFrame) {
+		while (!this->inFlight.empty() && this->inFlight.front().frame <= completedFrame) {
+			this->tail  = this->inFlight.front().end;
+			this->used -= this->inFlight.front().bytes;
+			this->inFlight.pop_front();
+		}
+		if (this->used == 0) {
+			this->head = 0;
+			this->tail = 0;
+		}
+	}
+
+	bool hasFramesInFlight() const noexcept { return !this->inFlight.empty(); }
+	uint64_t oldestFrameInFlight() const noexcept { return this->inFlight.empty() ? 0 : this->inFlight.front().frame; }
+
+	size_t capacity() const noexcept { return this->_capacity; }
+	size_t usedBytes() const noexcept { return this->used; }
+};
\ No newline at end of file
@@ -5,6 +5,20 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+
+#ifdef RC_HEADLESS
+// Output already goes to the terminal the process was started from, nothing to redirect or color
+class RCStreamBuffer {
+public:
+    RCStreamBuffer(std::ostream&, WORD) {}
+};
+
+class DebugConsole {
+public:
+	static void init() {}
+	static void del() {}
+};
+#else
 #include <windows.h>
 
 class RCStreamBuffer : public std::streambuf {
@@ -79,4 +93,5 @@ public:
 	static void del() {
 		FreeConsole();
 	}
-};
\ No newline at end of file
+};
+#endif
\ No newline at end of file
@@ -2,38 +2,127 @@
 #include "framework.h"
 
 #include "DirectX11Types.h"
+#include "ConstantRing.h"
+#include "GlobalLight.h"
+#include "CommandList.h"
+#include "ShaderCache.h"
 
 #include "Window.h"
 
 #include <format>
 
-struct FrameData {
-    DirectX::XMMATRIX model;
+// Constant buffer slots shared by both stages, model buffers are bound after them
+constexpr UINT RC_OBJECT_CONSTANTS_SLOT = 0;
+constexpr UINT RC_FRAME_CONSTANTS_SLOT  = 1;
+constexpr UINT RC_MODEL_BUFFERS_SLOT    = 2;
+
+// Uploaded once per frame, matrices are stored transposed for HLSL
+struct FrameConstants {
     DirectX::XMMATRIX view;
     DirectX::XMMATRIX projection;
+    DirectX::XMMATRIX viewProjection;
+    DirectX::XMFLOAT4 cameraPosition;
+    DirectX::XMFLOAT4 cameraRotation;
+    GlobalLight       light;
+};
+// Uploaded per draw
+struct ObjectConstants {
+    DirectX::XMMATRIX model;
+    DirectX::XMFLOAT4 scale;
 };
 
 struct DirectX11HandlerDescription {
     UINT backBufferCount = 2;
     BOOL vSync           = FALSE;
+
+    // Size of the dynamic constant buffer ring that per-draw constants are suballocated from
+    UINT constantRingSize = 4 * 1024 * 1024;
+
+    // Compiled shaders are kept here between runs, empty compiles every shader on every run
+    std::string shaderCacheDirectory = "ShaderCache";
+};
+
+constexpr uint32_t RC_MAX_FRAMES_IN_FLIGHT = 3;
+
+struct ConstantAllocation {
+    size_t offset = RC_RING_FULL;
+    size_t size   = 0;
+
+    bool valid() const noexcept { return this->offset != RC_RING_FULL; }
 };
 
+#ifdef RC_HEADLESS
+#include "NullDirectX11Handler.h"
+#else
+#include "Pipeline.h"
+#include "StateFilter.h"
+
+// Goes into every shader cache key, cached bytecode is compiled again once the SDK ships another compiler
+constexpr uint32_t RC_SHADER_COMPILER_VERSION = D3D_COMPILER_VERSION;
+
 class DirectX11Handler {
 private:
     Microsoft::WRL::ComPtr<IDXGISwapChain> swapChain;
 
-    Microsoft::WRL::ComPtr<ID3D11Device>        device;
-    Microsoft::WRL::ComPtr<ID3D11DeviceContext> context;
+    Microsoft::WRL::ComPtr<ID3D11Device>         device;
+    Microsoft::WRL::ComPtr<ID3D11DeviceContext>  context;
+    Microsoft::WRL::ComPtr<ID3D11DeviceContext1> context1;
+
+    Microsoft::WRL::ComPtr<ID3D11Buffer> constantRingBuffer;
+    Microsoft::WRL::ComPtr<ID3D11Query>  frameFences[RC_MAX_FRAMES_IN_FLIGHT];
+    ConstantRingAllocator                constantRing;
+    unsigned char*                       constantRingData  = nullptr;
+    bool                                 constantRingFresh = true;
+    uint64_t                             frameIndex        = 0;
 
     Microsoft::WRL::ComPtr<ID3D11RenderTargetView>  renderTargetView;
     Microsoft::WRL::ComPtr<ID3D11DepthStencilView>  depthStencilView;
     Microsoft::WRL::ComPtr<ID3D11DepthStencilState> depthStencilState;
 
+    PipelineStateCache stateCache;
+    ShaderCache        shaderCache;
+
+    // Every bind made through the handler goes through here, so redundant ones never reach the context
+    StateFilter<ID3D11DeviceContext, ID3D11DeviceContext1> stateFilter;
+
     D3D11_INPUT_ELEMENT_DESC layout[3] = {
         { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
         { "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
         { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24, D3D11_INPUT_PER_VERTEX_DATA, 0 },
     };
+    D3D11_INPUT_ELEMENT_DESC instancedLayout[7] = {
+        { "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, 24, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "INSTANCE_WORLD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+        { "INSTANCE_WORLD", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 16, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+        { "INSTANCE_WORLD", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 32, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+        { "INSTANCE_WORLD", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 48, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+    };
+    // CompactVertex, positions reach the shader as -1..1 snorm and are scaled back by the world matrix
+    D3D11_INPUT_ELEMENT_DESC compactLayout[3] = {
+        { "POSITION", 0, DXGI_FORMAT_R16G16B16A16_SNORM, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "OCT_NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, 8, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+    };
+    D3D11_INPUT_ELEMENT_DESC compactInstancedLayout[7] = {
+        { "POSITION", 0, DXGI_FORMAT_R16G16B16A16_SNORM, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "OCT_NORMAL", 0, DXGI_FORMAT_R16G16_SNORM, 0, 8, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+        { "INSTANCE_WORLD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+        { "INSTANCE_WORLD", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 16, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+        { "INSTANCE_WORLD", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 32, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+        { "INSTANCE_WORLD", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 48, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+    };
+
+    Microsoft::WRL::ComPtr<ID3D11Buffer> instanceBuffer;
+    UINT                                 instanceCapacity = 0;
+
+    Microsoft::WRL::ComPtr<ID3D11Buffer> dynamicVertexBuffer;
+    UINT                                 dynamicVertexCapacity = 0;
+
+    // Ring allocations of every SetConstants command played back this call, in playback order
+    std::vector<ConstantAllocation> commandConstants;
 
     D3D11_VIEWPORT viewport;
     BOOL           vSync;
@@ -72,10 +161,171 @@ public:
                                            &swapChainDescription, this->swapChain.GetAddressOf(), this->device.GetAddressOf(), nullptr, this->context.GetAddressOf());
         RC_EI_ASSERT(FAILED(hr), "Failed to create depth stencil view");
 
+        this->stateCache.build(this->device);
+        this->shaderCache.build(description.shaderCacheDirectory, compileShader, RC_SHADER_COMPILER_VERSION);
+
         this->createRenderTargetView();
         this->createDepthStencil(DXGI_FORMAT_D24_UNORM_S8_UINT);
 
         this->setViewport(window->width, window->height);
+
+        this->createConstantRing(description.constantRingSize);
+
+        this->stateFilter.build(this->context.Get(), this->context1.Get());
+    }
+
+    static bool compileShader(const ShaderCompileRequest& request, ShaderBytecode& out, std::string& error) {
+        // D3DCompile wants null terminated strings and a null terminated macro array
+        const std::string entryPoint(request.entryPoint);
+        const std::string target(request.target);
+
+        std::vector<D3D_SHADER_MACRO> macros;
+        macros.reserve(request.defines.size() + 1);
+        for (const ShaderDefine& define : request.defines) macros.push_back({ define.name.c_str(), define.value.c_str() });
+        macros.push_back({ nullptr, nullptr });
+
+        Microsoft::WRL::ComPtr<ID3DBlob> blob;
+        Microsoft::WRL::ComPtr<ID3DBlob> errorBlob;
+
+        HRESULT hr = D3DCompile(request.source.data(), request.source.size(),
+                                nullptr, macros.data(), nullptr,
+                                entryPoint.c_str(), target.c_str(), request.flags, 0,
+                                &blob, &errorBlob);
+        if (FAILED(hr)) {
+            if (errorBlob) error.assign(static_cast<const char*>(errorBlob->GetBufferPointer()), errorBlob->GetBufferSize());
+            return false;
+        }
+
+        const uint8_t* code = static_cast<const uint8_t*>(blob->GetBufferPointer());
+        out.assign(code, code + blob->GetBufferSize());
+        return true;
+    }
+
+    void createConstantRing(const UINT size) {
+        HRESULT hr;
+
+        // Binding at an offset needs D3D11.1, and NO_OVERWRITE maps of constant buffers need driver support
+        D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+        this->device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options));
+
+        hr = this->context.As(&this->context1);
+        if (FAILED(hr) || !options.ConstantBufferOffsetting || !options.MapNoOverwriteOnDynamicConstantBuffer) {
+            RC_DBG_WARN("Constant buffer offsetting is not supported, per-draw constants fall back to one buffer per draw.");
+            this->context1 = nullptr;
+            return;
+        }
+
+        D3D11_BUFFER_DESC ringDesc = {};
+        ringDesc.Usage             = D3D11_USAGE_DYNAMIC;
+        ringDesc.ByteWidth         = size - size % RC_CONSTANT_ALIGNMENT;
+        ringDesc.BindFlags         = D3D11_BIND_CONSTANT_BUFFER;
+        ringDesc.CPUAccessFlags    = D3D11_CPU_ACCESS_WRITE;
+
+        hr = this->device->CreateBuffer(&ringDesc, nullptr, this->constantRingBuffer.GetAddressOf());
+        RC_EI_ASSERT(FAILED(hr), "Failed to create constant ring buffer.");
+        if (FAILED(hr)) {
+            this->context1 = nullptr;
+            return;
+        }
+
+        D3D11_QUERY_DESC fenceDesc = {};
+        fenceDesc.Query            = D3D11_QUERY_EVENT;
+        for (auto& fence : this->frameFences) {
+            hr = this->device->CreateQuery(&fenceDesc, fence.GetAddressOf());
+            RC_EI_ASSERT(FAILED(hr), "Failed to create frame fence.");
+        }
+
+        this->constantRing.build(ringDesc.ByteWidth);
+    }
+
+    bool hasConstantRing() const noexcept { return this->constantRingBuffer.Get() != nullptr; }
+
+    // Retires every frame the GPU finished, or blocks on the oldest one when wait is set
+    void retireFrames(const bool wait) {
+        while (this->constantRing.hasFramesInFlight()) {
+            const uint64_t oldest = this->constantRing.oldestFrameInFlight();
+            ID3D11Query*   fence  = this->frameFences[oldest % RC_MAX_FRAMES_IN_FLIGHT].Get();
+
+            BOOL done = FALSE;
+            if (wait) {
+                while (this->context->GetData(fence, &done, sizeof(BOOL), 0) == S_FALSE) {
+                    std::this_thread::yield();
+                }
+            }
+            else if (this->context->GetData(fence, &done, sizeof(BOOL), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK) {
+                return;
+            }
+
+            this->constantRing.retire(oldest);
+            if (wait) return;
+        }
+    }
+
+    void beginConstants() {
+        if (!this->hasConstantRing()) return;
+
+        this->retireFrames(false);
+        // Fence queries are reused round robin, so a query still in flight has to finish before it is ended again
+        while (this->frameIndex >= RC_MAX_FRAMES_IN_FLIGHT &&
+               this->constantRing.hasFramesInFlight() &&
+               this->constantRing.oldestFrameInFlight() <= this->frameIndex - RC_MAX_FRAMES_IN_FLIGHT)
+        {
+            this->retireFrames(true);
+        }
+
+        D3D11_MAPPED_SUBRESOURCE mapped = {};
+        const D3D11_MAP mapType = this->constantRingFresh ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE;
+
+        HRESULT hr = this->context->Map(this->constantRingBuffer.Get(), 0, mapType, 0, &mapped);
+        RC_EI_ASSERT(FAILED(hr), "Failed to map constant ring buffer.");
+        if (FAILED(hr)) return;
+
+        this->constantRingData  = static_cast<unsigned char*>(mapped.pData);
+        this->constantRingFresh = false;
+    }
+    // Copies the data into the ring, valid for binding until the end of the frame
+    ConstantAllocation writeConstants(const void* data, const size_t size) {
+        ConstantAllocation allocation = {};
+        if (!this->constantRingData) return allocation;
+
+        size_t offset = this->constantRing.allocate(size);
+        while (offset == RC_RING_FULL && this->constantRing.hasFramesInFlight()) {
+            this->retireFrames(true);
+            offset = this->constantRing.allocate(size);
+        }
+        RC_EI_ASSERT(offset == RC_RING_FULL, "Constant ring is full, raise DirectX11HandlerDescription::constantRingSize.");
+        if (offset == RC_RING_FULL) return allocation;
+
+        memcpy(this->constantRingData + offset, data, size);
+
+        allocation.offset = offset;
+        allocation.size   = ConstantRingAllocator::align(size);
+        return allocation;
+    }
+    template <typename StructType>
+    ConstantAllocation writeConstants(const StructType& data) {
+        return this->writeConstants(&data, sizeof(StructType));
+    }
+    void endConstants() {
+        if (!this->constantRingData) return;
+
+        this->context->Unmap(this->constantRingBuffer.Get(), 0);
+        this->constantRingData = nullptr;
+    }
+
+    void VSBindConstants(const UINT slot, const ConstantAllocation& allocation) {
+        if (!allocation.valid()) return;
+
+        const UINT firstConstant = static_cast<UINT>(allocation.offset / 16);
+        const UINT numConstants  = static_cast<UINT>(allocation.size / 16);
+        this->stateFilter.setConstantBufferRange(PipelineStage::VertexStage, slot, this->constantRingBuffer.Get(), firstConstant, numConstants);
+    }
+    void PSBindConstants(const UINT slot, const ConstantAllocation& allocation) {
+        if (!allocation.valid()) return;
+
+        const UINT firstConstant = static_cast<UINT>(allocation.offset / 16);
+        const UINT numConstants  = static_cast<UINT>(allocation.size / 16);
+        this->stateFilter.setConstantBufferRange(PipelineStage::PixelStage, slot, this->constantRingBuffer.Get(), firstConstant, numConstants);
     }
 
     void createRenderTargetView() {
@@ -90,7 +340,7 @@ public:
     }
 
     void bindShaderResource(Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> inShaderResourceView) {
-        this->context->PSSetShaderResources(0, 1, inShaderResourceView.GetAddressOf());
+        this->stateFilter.setShaderResources(PipelineStage::PixelStage, 0, 1, inShaderResourceView.GetAddressOf());
     }
 
     Microsoft::WRL::ComPtr<ID3D11DepthStencilView> createDepthStencilBuffer(const DXGI_FORMAT format) {
@@ -160,52 +410,71 @@ public:
         depthStencilStateDescription.BackFace.StencilPassOp      = D3D11_STENCIL_OP_KEEP;
         depthStencilStateDescription.BackFace.StencilFunc        = D3D11_COMPARISON_ALWAYS;
 
-        hr = this->device->CreateDepthStencilState(&depthStencilStateDescription, this->depthStencilState.GetAddressOf());
-        RC_EI_ASSERT(FAILED(hr), "Failed to create depth stencil state");
+        this->depthStencilState = this->stateCache.getDepthStencilState(depthStencilStateDescription);
+        RC_EI_ASSERT(!this->depthStencilState, "Failed to create depth stencil state");
     }
 
     void prepare() {
         this->context->OMSetRenderTargets(1, this->renderTargetView.GetAddressOf(), this->depthStencilView.Get());
-        this->context->OMSetDepthStencilState(this->depthStencilState.Get(), 0);
+        this->stateFilter.setDepthStencilState(this->depthStencilState.Get(), 0);
     }
 
-    Shader createShadersFromSource(const std::string& vertexShaderSource, const std::string& pixelShaderSource) {
+    // Defines are seen by both stages, and are part of the shader cache key
+    Shader createShadersFromSource(const std::string& vertexShaderSource, const std::string& pixelShaderSource, std::span<const ShaderDefine> defines = {}) {
         HRESULT hr;
 
         Shader shader = {};
 
-        Microsoft::WRL::ComPtr<ID3DBlob> vertexShaderBlob;
-        Microsoft::WRL::ComPtr<ID3DBlob> pixelShaderBlob;
-        Microsoft::WRL::ComPtr<ID3DBlob> pErrorBlob;
+        ShaderBytecode vertexShaderCode;
+        ShaderBytecode pixelShaderCode;
+        std::string    error;
 
-        hr = D3DCompile(vertexShaderSource.c_str(), vertexShaderSource.size() + 1,
-                        nullptr, nullptr, nullptr,
-                        "VSMain", "vs_5_0", 0, 0,
-                        &vertexShaderBlob, pErrorBlob.GetAddressOf());
-        RC_EI_ASSERT(FAILED(hr), "Failed to compile vertex shader\n" << (const char*)pErrorBlob->GetBufferPointer());
+        if (!this->shaderCache.get({ vertexShaderSource, "VSMain", "vs_5_0", defines }, vertexShaderCode, &error)) {
+            RC_DBG_ERROR("Failed to compile vertex shader\n" << error);
+            return shader;
+        }
+        if (!this->shaderCache.get({ pixelShaderSource, "PSMain", "ps_5_0", defines }, pixelShaderCode, &error)) {
+            RC_DBG_ERROR("Failed to compile pixel shader. Error: " << error);
+            return shader;
+        }
 
-        hr = D3DCompile(pixelShaderSource.c_str(), pixelShaderSource.size() + 1,
-                        nullptr, nullptr, nullptr,
-                        "PSMain", "ps_5_0", 0, 0,
-                        &pixelShaderBlob, pErrorBlob.GetAddressOf());
-        RC_EI_ASSERT(FAILED(hr) && pErrorBlob, "Failed to compile pixel shader. Error: " << static_cast<const char*>(pErrorBlob->GetBufferPointer()));
-
-        hr = this->device->CreateVertexShader(vertexShaderBlob->GetBufferPointer(), vertexShaderBlob->GetBufferSize(),
+        hr = this->device->CreateVertexShader(vertexShaderCode.data(), vertexShaderCode.size(),
                                               nullptr, &shader.vertexShader);
         RC_EI_ASSERT(FAILED(hr), "Failed to create vertex shader");
-        hr = this->device->CreatePixelShader(pixelShaderBlob->GetBufferPointer(), pixelShaderBlob->GetBufferSize(),
+        hr = this->device->CreatePixelShader(pixelShaderCode.data(), pixelShaderCode.size(),
                                              nullptr, &shader.pixelShader);
         RC_EI_ASSERT(FAILED(hr), "Failed to create pixel shader");
 
-        this->createInputLayout(&shader.inputLayout, vertexShaderBlob, pixelShaderBlob);
+        shader.instanced = this->hasInput(vertexShaderCode, "INSTANCE_WORLD");
+        shader.format    = this->hasInput(vertexShaderCode, "OCT_NORMAL") ? VertexFormat::Compact : VertexFormat::Full;
+        this->createInputLayout(&shader.inputLayout, vertexShaderCode, shader.instanced, shader.format);
 
         return shader;
     }
 
+    // Shaders opt into instancing by declaring a float4x4 INSTANCE_WORLD vertex input, and into compact vertices with OCT_NORMAL
+    bool hasInput(const ShaderBytecode& inVertexShaderCode, const char* semantic) {
+        Microsoft::WRL::ComPtr<ID3D11ShaderReflection> reflection;
+        HRESULT hr = D3DReflect(inVertexShaderCode.data(), inVertexShaderCode.size(), IID_PPV_ARGS(&reflection));
+        if (FAILED(hr)) return false;
+
+        D3D11_SHADER_DESC shaderDesc = {};
+        reflection->GetDesc(&shaderDesc);
+
+        for (UINT i = 0; i < shaderDesc.InputParameters; i++) {
+            D3D11_SIGNATURE_PARAMETER_DESC parameterDesc = {};
+            reflection->GetInputParameterDesc(i, &parameterDesc);
+            if (strcmp(parameterDesc.SemanticName, semantic) == 0) return true;
+        }
+        return false;
+    }
+
+    ShaderCacheStats getShaderCacheStats() const { return this->shaderCache.getStats(); }
+
+    // The data is only read during the call, callers decide what to keep of it
+    template <typename VertexType>
     void createVertexArrayBuffer(Microsoft::WRL::ComPtr<ID3D11Buffer>* outVertexArrayBuffer, 
-                                 std::vector<Vertex>*                  outVertices, 
-                                 D3D11_SUBRESOURCE_DATA*               outInitData, 
-                                 const std::vector<Vertex>&            inVertices) 
+                                 const std::vector<VertexType>&        inVertices) 
     {
         // Set asserts for debug builds
 		RC_DBG_CODE(
@@ -213,14 +482,6 @@ public:
                 RC_DBG_ERROR("The OUT VERTEX ARRAY BUFFER passed to the create vertex array buffer function is 0.");
                 return;
             }
-            if (!outVertices) {
-                RC_DBG_ERROR("The OUT VERTEX DATA passed to the create vertex array buffer function is 0.");
-                return;
-            }
-            if (!outInitData) {
-                RC_DBG_ERROR("The OUT SUBRESOURCE DATA passed to the create vertex array buffer function is 0.");
-                return;
-            }
             if (inVertices.empty()) {
                 RC_DBG_ERROR("The IN VERTEX DATA passed to the create vertex array buffer function is empty.");
                 return;
@@ -229,39 +490,31 @@ public:
 
         HRESULT hr;
 
-		// Be sure this happens before the vertex array buffer is created
-        *outVertices = inVertices;
-
         D3D11_BUFFER_DESC vertexArrayBufferDescription = {};
         vertexArrayBufferDescription.Usage             = D3D11_USAGE_DEFAULT;
-        vertexArrayBufferDescription.ByteWidth         = outVertices->size() * sizeof(Vertex);
+        vertexArrayBufferDescription.ByteWidth         = inVertices.size() * sizeof(VertexType);
         vertexArrayBufferDescription.BindFlags         = D3D11_BIND_VERTEX_BUFFER;
         vertexArrayBufferDescription.CPUAccessFlags    = NULL;
 
 		// Set the data for the vertex array buffer
-        outInitData->pSysMem = outVertices->data();
-        hr = this->device->CreateBuffer(&vertexArrayBufferDescription, outInitData, outVertexArrayBuffer->GetAddressOf());
+        D3D11_SUBRESOURCE_DATA initData = {};
+        initData.pSysMem                = inVertices.data();
+        hr = this->device->CreateBuffer(&vertexArrayBufferDescription, &initData, outVertexArrayBuffer->GetAddressOf());
         RC_EI_ASSERT(FAILED(hr), "Failed to create vertex array buffer");
     }
+    // 16 or 32 bit indices, the draw has to say which through setGeometry
+    template <typename IndexType>
     void createIndexArrayBuffer(Microsoft::WRL::ComPtr<ID3D11Buffer>* outIndexArrayBuffer, 
-                                std::vector<uint32_t>*                outIndices, 
-                                D3D11_SUBRESOURCE_DATA*               outInitData, 
-                                const std::vector<uint32_t>&          inIndices) 
+                                const std::vector<IndexType>&         inIndices) 
     {
+        static_assert(sizeof(IndexType) == 2 || sizeof(IndexType) == 4, "Index buffers hold 16 or 32 bit indices");
+
         // Set asserts for debug builds
         RC_DBG_CODE(
             if (!outIndexArrayBuffer) {
                 RC_DBG_ERROR("The OUT INDEX ARRAY BUFFER passed to the create index array buffer function is 0.");
                 return;
             }
-            if (!outIndices) {
-                RC_DBG_ERROR("The OUT INDEX DATA passed to the create index array buffer function is 0.");
-                return;
-            }
-            if (!outInitData) {
-                RC_DBG_ERROR("The OUT SUBRESOURCE DATA passed to the create index array buffer function is 0.");
-                return;
-            }
             if (inIndices.empty()) {
                 RC_DBG_ERROR("The IN INDEX DATA passed to the create index array buffer function is empty.");
                 return;
@@ -270,24 +523,23 @@ public:
 
         HRESULT hr;
 
-        // Be sure this happens before the index array buffer is created
-        *outIndices = inIndices;
-
         D3D11_BUFFER_DESC vertexArrayBufferDescription = {};
         vertexArrayBufferDescription.Usage             = D3D11_USAGE_DEFAULT;
-        vertexArrayBufferDescription.ByteWidth         = outIndices->size() * sizeof(DWORD);
+        vertexArrayBufferDescription.ByteWidth         = inIndices.size() * sizeof(IndexType);
         vertexArrayBufferDescription.BindFlags         = D3D11_BIND_INDEX_BUFFER;
         vertexArrayBufferDescription.CPUAccessFlags    = NULL;
 
         // Set the data for the index array buffer
-        outInitData->pSysMem = outIndices->data();
-        hr = this->device->CreateBuffer(&vertexArrayBufferDescription, outInitData, outIndexArrayBuffer->GetAddressOf());
+        D3D11_SUBRESOURCE_DATA initData = {};
+        initData.pSysMem                = inIndices.data();
+        hr = this->device->CreateBuffer(&vertexArrayBufferDescription, &initData, outIndexArrayBuffer->GetAddressOf());
         RC_EI_ASSERT(FAILED(hr), "Failed to create index array buffer");
     }
 
     void createInputLayout(Microsoft::WRL::ComPtr<ID3D11InputLayout>* outInputLayout, 
-                           Microsoft::WRL::ComPtr<ID3DBlob>           inVertexShaderBlob, 
-                           Microsoft::WRL::ComPtr<ID3DBlob>           inPixelShaderBlob)
+                           const ShaderBytecode&                      inVertexShaderCode, 
+                           const bool                                 instanced = false,
+                           const VertexFormat                         format    = VertexFormat::Full)
     {
         // Set asserts for debug builds
         RC_DBG_CODE(
@@ -297,12 +549,19 @@ public:
 			}
         );
 
-        HRESULT hr;
-
-        hr = this->device->CreateInputLayout(this->layout, ARRAYSIZE(this->layout),
-                                             inVertexShaderBlob->GetBufferPointer(), inVertexShaderBlob->GetBufferSize(),
-                                             outInputLayout->GetAddressOf());
-        RC_EI_ASSERT(FAILED(hr), "Failed to create input layout");
+        const bool                      compact  = format == VertexFormat::Compact;
+        const D3D11_INPUT_ELEMENT_DESC* elements = nullptr;
+        UINT                            count    = 0;
+        if (instanced) {
+            elements = compact ? this->compactInstancedLayout : this->instancedLayout;
+            count    = compact ? ARRAYSIZE(this->compactInstancedLayout) : ARRAYSIZE(this->instancedLayout);
+        }
+        else {
+            elements = compact ? this->compactLayout : this->layout;
+            count    = compact ? ARRAYSIZE(this->compactLayout) : ARRAYSIZE(this->layout);
+        }
+        *outInputLayout = this->stateCache.getInputLayout(elements, count, inVertexShaderCode.data(), inVertexShaderCode.size());
+        RC_EI_ASSERT(!*outInputLayout, "Failed to create input layout");
     }
 
     void clearScreen() {
@@ -310,9 +569,7 @@ public:
         rasterizerDesc.FillMode              = D3D11_FILL_SOLID;
         rasterizerDesc.CullMode              = D3D11_CULL_NONE;
 
-        Microsoft::WRL::ComPtr<ID3D11RasterizerState> rasterizerState = nullptr;
-        device->CreateRasterizerState(&rasterizerDesc, rasterizerState.GetAddressOf());
-        context->RSSetState(rasterizerState.Get());
+        this->stateFilter.setRasterizerState(this->stateCache.getRasterizerState(rasterizerDesc));
 
         this->context->ClearRenderTargetView(this->renderTargetView.Get(), DirectX::Colors::CadetBlue);
         this->context->ClearDepthStencilView(this->depthStencilView.Get(), D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
@@ -415,8 +672,6 @@ public:
             }
         );
 
-        HRESULT hr;
-
         D3D11_SAMPLER_DESC samplerDesc = {};
         samplerDesc.Filter             = D3D11_FILTER_MIN_MAG_MIP_LINEAR;  // Linear filtering for min/mag/mip
         samplerDesc.AddressU           = D3D11_TEXTURE_ADDRESS_WRAP;       // Wrap texture coordinates horizontally
@@ -426,38 +681,206 @@ public:
         samplerDesc.MinLOD             = 0;
         samplerDesc.MaxLOD             = D3D11_FLOAT32_MAX;
 
-        hr = this->device->CreateSamplerState(&samplerDesc, outSamplerState->GetAddressOf());
-        RC_EI_ASSERT(FAILED(hr), "Failed to create sampler state.");
+        *outSamplerState = this->stateCache.getSamplerState(samplerDesc);
+        RC_EI_ASSERT(!*outSamplerState, "Failed to create sampler state.");
+    }
+    void setAlphaBlending(const bool enabled) {
+        if (!enabled) {
+            this->stateFilter.setBlendState(nullptr, nullptr, 0xFFFFFFFF);
+            return;
+        }
+
+        D3D11_BLEND_DESC blendDesc                      = {};
+        blendDesc.RenderTarget[0].BlendEnable           = TRUE;
+        blendDesc.RenderTarget[0].SrcBlend              = D3D11_BLEND_SRC_ALPHA;
+        blendDesc.RenderTarget[0].DestBlend             = D3D11_BLEND_INV_SRC_ALPHA;
+        blendDesc.RenderTarget[0].BlendOp               = D3D11_BLEND_OP_ADD;
+        blendDesc.RenderTarget[0].SrcBlendAlpha         = D3D11_BLEND_ONE;
+        blendDesc.RenderTarget[0].DestBlendAlpha        = D3D11_BLEND_INV_SRC_ALPHA;
+        blendDesc.RenderTarget[0].BlendOpAlpha          = D3D11_BLEND_OP_ADD;
+        blendDesc.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+
+        this->stateFilter.setBlendState(this->stateCache.getBlendState(blendDesc), nullptr, 0xFFFFFFFF);
     }
+
     void bindSamplerState(Microsoft::WRL::ComPtr<ID3D11SamplerState> inSamplerState) {
-        this->context->PSSetSamplers(0, 1, inSamplerState.GetAddressOf());
+        this->stateFilter.setSamplers(PipelineStage::PixelStage, 0, 1, inSamplerState.GetAddressOf());
     }
 
-    void render(Microsoft::WRL::ComPtr<ID3D11VertexShader> inVertexShader, 
-                Microsoft::WRL::ComPtr<ID3D11PixelShader>  inPixelShader,
-                Microsoft::WRL::ComPtr<ID3D11InputLayout>  inInputLayout,
-                Microsoft::WRL::ComPtr<ID3D11Buffer>       inVertexArrayBuffer,
-                Microsoft::WRL::ComPtr<ID3D11Buffer>       inIndexArrayBuffer,
-                const uint32_t                             inIndexCount) 
-    {
-        uint32_t stride = sizeof(Vertex);
-        uint32_t offset = 0;
-        this->context->VSSetShader(inVertexShader.Get(), nullptr, 0);
-        this->context->PSSetShader(inPixelShader.Get(), nullptr, 0);
-
-        // Set vertex and index array buffers
-        this->context->IASetVertexBuffers(0, 1, inVertexArrayBuffer.GetAddressOf(), &stride, &offset);
-        this->context->IASetIndexBuffer(inIndexArrayBuffer.Get(), DXGI_FORMAT_R32_UINT, 0);
-
-        // Set input layout and primitive topology
-        this->context->IASetInputLayout(inInputLayout.Get());
-        this->context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-        
-        this->context->DrawIndexed(inIndexCount, 0, 0);
+    // Maps room for this frame's instances, the buffer grows to the next power of two when it is too small
+    InstanceData* beginInstances(const UINT count) {
+        if (count == 0) return nullptr;
+
+        HRESULT hr;
+
+        if (count > this->instanceCapacity) {
+            UINT capacity = std::max(this->instanceCapacity, 256u);
+            while (capacity < count) capacity *= 2;
+
+            D3D11_BUFFER_DESC instanceBufferDesc = {};
+            instanceBufferDesc.Usage             = D3D11_USAGE_DYNAMIC;
+            instanceBufferDesc.ByteWidth         = capacity * sizeof(InstanceData);
+            instanceBufferDesc.BindFlags         = D3D11_BIND_VERTEX_BUFFER;
+            instanceBufferDesc.CPUAccessFlags    = D3D11_CPU_ACCESS_WRITE;
+
+            hr = this->device->CreateBuffer(&instanceBufferDesc, nullptr, this->instanceBuffer.ReleaseAndGetAddressOf());
+            if (FAILED(hr)) {
+                RC_DBG_ERROR("Failed to create instance buffer.");
+                this->instanceCapacity = 0;
+                return nullptr;
+            }
+            this->instanceCapacity = capacity;
+        }
+
+        D3D11_MAPPED_SUBRESOURCE mapped = {};
+        hr = this->context->Map(this->instanceBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
+        if (FAILED(hr)) {
+            RC_DBG_ERROR("Failed to map instance buffer.");
+            return nullptr;
+        }
+        return static_cast<InstanceData*>(mapped.pData);
+    }
+    void endInstances() {
+        this->context->Unmap(this->instanceBuffer.Get(), 0);
+    }
+
+    // Maps room for vertices the CPU generates every frame, grown the same way as the instance buffer
+    Vertex* beginDynamicVertices(const UINT count) {
+        if (count == 0) return nullptr;
+
+        HRESULT hr;
+
+        if (count > this->dynamicVertexCapacity) {
+            UINT capacity = std::max(this->dynamicVertexCapacity, 1024u);
+            while (capacity < count) capacity *= 2;
+
+            D3D11_BUFFER_DESC vertexBufferDesc = {};
+            vertexBufferDesc.Usage             = D3D11_USAGE_DYNAMIC;
+            vertexBufferDesc.ByteWidth         = capacity * sizeof(Vertex);
+            vertexBufferDesc.BindFlags         = D3D11_BIND_VERTEX_BUFFER;
+            vertexBufferDesc.CPUAccessFlags    = D3D11_CPU_ACCESS_WRITE;
+
+            hr = this->device->CreateBuffer(&vertexBufferDesc, nullptr, this->dynamicVertexBuffer.ReleaseAndGetAddressOf());
+            if (FAILED(hr)) {
+                RC_DBG_ERROR("Failed to create dynamic vertex buffer.");
+                this->dynamicVertexCapacity = 0;
+                return nullptr;
+            }
+            this->dynamicVertexCapacity = capacity;
+        }
+
+        D3D11_MAPPED_SUBRESOURCE mapped = {};
+        hr = this->context->Map(this->dynamicVertexBuffer.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
+        if (FAILED(hr)) {
+            RC_DBG_ERROR("Failed to map dynamic vertex buffer.");
+            return nullptr;
+        }
+        return static_cast<Vertex*>(mapped.pData);
+    }
+    void endDynamicVertices() {
+        this->context->Unmap(this->dynamicVertexBuffer.Get(), 0);
+    }
+    ID3D11Buffer* getDynamicVertexBuffer() const noexcept { return this->dynamicVertexBuffer.Get(); }
+
+    // Plays the lists back in order as one stream. Every constant payload is copied into the ring under a single map
+    // first, since nothing can be bound while the ring is mapped, then the binds and draws go through the state filter.
+    void execute(const CommandList* lists, const size_t count) {
+        this->commandConstants.clear();
+
+        this->beginConstants();
+        for (size_t i = 0; i < count; i++) {
+            lists[i].forEach([this](const CommandHeader& header, const unsigned char* payload) {
+                if (header.type == CommandType::SetConstants) this->commandConstants.push_back(this->writeConstants(payload, header.size));
+            });
+        }
+        this->endConstants();
+
+        size_t constantIndex = 0;
+        for (size_t i = 0; i < count; i++) {
+            lists[i].forEach([this, &constantIndex](const CommandHeader& header, const unsigned char* payload) {
+                this->executeCommand(header, payload, constantIndex);
+            });
+        }
+    }
+    void execute(const std::vector<CommandList>& lists) {
+        this->execute(lists.data(), lists.size());
     }
 
+    void executeCommand(const CommandHeader& header, const unsigned char* payload, size_t& constantIndex) {
+        switch (header.type) {
+        case CommandType::SetPipeline: {
+            const auto command = CommandList::read<SetPipelineCommand>(payload);
+            this->stateFilter.setVertexShader(fromHandle<ID3D11VertexShader>(command.vertexShader));
+            this->stateFilter.setPixelShader(fromHandle<ID3D11PixelShader>(command.pixelShader));
+            this->stateFilter.setInputLayout(fromHandle<ID3D11InputLayout>(command.inputLayout));
+            this->stateFilter.setPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+            break;
+        }
+        case CommandType::SetGeometry: {
+            const auto command = CommandList::read<SetGeometryCommand>(payload);
+            this->stateFilter.setVertexBuffer(0, fromHandle<ID3D11Buffer>(command.vertexBuffer), command.vertexStride, 0);
+            if (command.instanced) this->stateFilter.setVertexBuffer(1, this->instanceBuffer.Get(), sizeof(InstanceData), 0);
+            this->stateFilter.setIndexBuffer(fromHandle<ID3D11Buffer>(command.indexBuffer), command.indexBytes == 2 ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT, 0);
+            break;
+        }
+        case CommandType::SetTexture: {
+            ID3D11ShaderResourceView* view = fromHandle<ID3D11ShaderResourceView>(CommandList::read<SetTextureCommand>(payload).texture);
+            this->stateFilter.setShaderResources(PipelineStage::PixelStage, header.slot, 1, &view);
+            break;
+        }
+        case CommandType::SetConstants: {
+            const ConstantAllocation& allocation = this->commandConstants[constantIndex++];
+            if (allocation.valid()) {
+                if (header.stages & RC_COMMAND_VERTEX_STAGE) this->VSBindConstants(header.slot, allocation);
+                if (header.stages & RC_COMMAND_PIXEL_STAGE) this->PSBindConstants(header.slot, allocation);
+                break;
+            }
+
+            // No ring on this device, fall back to a buffer created for this command
+            Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
+            this->createConstantBuffer(&buffer, payload, header.size);
+            if (header.stages & RC_COMMAND_VERTEX_STAGE) this->stateFilter.setConstantBuffers(PipelineStage::VertexStage, header.slot, 1, buffer.GetAddressOf());
+            if (header.stages & RC_COMMAND_PIXEL_STAGE) this->stateFilter.setConstantBuffers(PipelineStage::PixelStage, header.slot, 1, buffer.GetAddressOf());
+            break;
+        }
+        case CommandType::SetBuffers: {
+            if (header.slot >= D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT) break;
+
+            ID3D11Buffer* buffers[D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT];
+            const UINT    bufferCount = std::min<UINT>(header.size / sizeof(GpuHandle), D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT - header.slot);
+            for (UINT i = 0; i < bufferCount; i++) {
+                buffers[i] = fromHandle<ID3D11Buffer>(CommandList::read<GpuHandle>(payload + i * sizeof(GpuHandle)));
+            }
+
+            if (header.stages & RC_COMMAND_VERTEX_STAGE) this->stateFilter.setConstantBuffers(PipelineStage::VertexStage, header.slot, bufferCount, buffers);
+            if (header.stages & RC_COMMAND_PIXEL_STAGE) this->stateFilter.setConstantBuffers(PipelineStage::PixelStage, header.slot, bufferCount, buffers);
+            break;
+        }
+        case CommandType::SetBlend:
+            this->setAlphaBlending(CommandList::read<SetBlendCommand>(payload).alphaBlending != 0);
+            break;
+        case CommandType::Draw: {
+            const auto command = CommandList::read<DrawCommand>(payload);
+            if (command.instanceCount == 0) this->context->DrawIndexed(command.indexCount, command.startIndex, 0);
+            else this->context->DrawIndexedInstanced(command.indexCount, command.instanceCount, command.startIndex, 0, command.startInstance);
+            break;
+        }
+        }
+    }
+
+    template <typename Ty>
+    static Ty* fromHandle(const GpuHandle handle) { return static_cast<Ty*>(const_cast<void*>(handle)); }
+
     void present() {
         this->swapChain->Present(vSync, 0);
+
+        if (this->hasConstantRing()) {
+            this->context->End(this->frameFences[this->frameIndex % RC_MAX_FRAMES_IN_FLIGHT].Get());
+            this->constantRing.endFrame(this->frameIndex);
+        }
+        this->frameIndex++;
+
+        this->stateFilter.endFrame();
     }
 
     void setViewport(const uint32_t width, const uint32_t height) {
@@ -472,11 +895,14 @@ public:
     
     template <typename StructType>
     void createConstantBuffer(Microsoft::WRL::ComPtr<ID3D11Buffer>* outBuffer, const StructType& inData) {
+        this->createConstantBuffer(outBuffer, &inData, sizeof(StructType));
+    }
+    void createConstantBuffer(Microsoft::WRL::ComPtr<ID3D11Buffer>* outBuffer, const void* inData, const UINT inSize) {
         HRESULT hr;
 
         D3D11_BUFFER_DESC cbufferDesc   = {};
         cbufferDesc.Usage               = D3D11_USAGE_DYNAMIC;
-        cbufferDesc.ByteWidth           = sizeof(StructType);
+        cbufferDesc.ByteWidth           = inSize;
         cbufferDesc.BindFlags           = D3D11_BIND_CONSTANT_BUFFER;
         cbufferDesc.CPUAccessFlags      = D3D11_CPU_ACCESS_WRITE;
         cbufferDesc.MiscFlags           = 0;
@@ -485,7 +911,7 @@ public:
         D3D11_SUBRESOURCE_DATA initData = {};
         initData.SysMemPitch            = 0;
         initData.SysMemSlicePitch       = 0;
-        initData.pSysMem                = &inData;
+        initData.pSysMem                = inData;
 
         hr = this->device->CreateBuffer(&cbufferDesc, &initData, outBuffer->GetAddressOf());
         RC_EI_ASSERT(FAILED(hr), "Failed to create constant buffer.");
@@ -500,16 +926,24 @@ public:
 		context->Unmap(inBuffer.Get(), 0);
     }
 
-    void VSBindBuffers(std::vector<Microsoft::WRL::ComPtr<ID3D11Buffer>>& buffers) {
+    void VSBindBuffers(std::vector<Microsoft::WRL::ComPtr<ID3D11Buffer>>& buffers, const UINT startSlot = 0) {
         if (buffers.empty()) return;
-        context->VSSetConstantBuffers(0, buffers.size(), buffers.data()->GetAddressOf());
+        this->stateFilter.setConstantBuffers(PipelineStage::VertexStage, startSlot, buffers.size(), buffers.data()->GetAddressOf());
     }
-    void PSBindBuffers(std::vector<Microsoft::WRL::ComPtr<ID3D11Buffer>>& buffers) {
+    void PSBindBuffers(std::vector<Microsoft::WRL::ComPtr<ID3D11Buffer>>& buffers, const UINT startSlot = 0) {
         if (buffers.empty()) return;
-        context->PSSetConstantBuffers(0, buffers.size(), buffers.data()->GetAddressOf());
+        this->stateFilter.setConstantBuffers(PipelineStage::PixelStage, startSlot, buffers.size(), buffers.data()->GetAddressOf());
     }
     
+    PipelineStateCache& getStateCache() { return this->stateCache; }
+
+    // Counters of the last finished frame
+    const StateFilterStats& getStateFilterStats() const noexcept { return this->stateFilter.getFrameStats(); }
+    // Call after binding anything on the context directly
+    void invalidateState() { this->stateFilter.invalidate(); }
+
     Microsoft::WRL::ComPtr<ID3D11DeviceContext> getDeviceContext() { return this->context.Get(); }
     Microsoft::WRL::ComPtr<IDXGISwapChain> getSwapChain() { return this->swapChain.Get(); }
     Microsoft::WRL::ComPtr<ID3D11Device> getDevice() { return this->device.Get(); }
-};
\ No newline at end of file
+};
+#endif
\ No newline at end of file
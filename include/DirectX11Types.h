@@ -1,6 +1,9 @@
 #pragma once
 #include "framework.h"
 
+#include "StringTable.h"
+#include "Bounds.h"
+
 #include <typeindex>
 
 enum class PipelineStage {
@@ -8,6 +11,11 @@ enum class PipelineStage {
     PixelStage,
 };
 
+enum class RenderPass : uint8_t {
+    Opaque,
+    Transparent,
+};
+
 struct Transform {
     DirectX::XMVECTOR position;
     DirectX::XMVECTOR rotation;
@@ -29,46 +37,177 @@ struct Vertex {
     DirectX::XMFLOAT2 uv;
 };
 
+// How a mesh's vertices are laid out in its GPU buffer, see VertexFormat.h. The CPU copy is always made of Vertex
+enum class VertexFormat : uint8_t {
+    // Vertex, 32 bytes
+    Full,
+    // CompactVertex, 16 bytes. Drawn by shaders taking the OCT_NORMAL input
+    Compact,
+};
+
+// Position is snorm16 inside the mesh bounds, w is padding so the element stays 8 bytes.
+// Normal is octahedral snorm16, uv is half float.
+struct CompactVertex {
+    int16_t  position[4];
+    int16_t  normal[2];
+    uint16_t uv[2];
+};
+static_assert(sizeof(CompactVertex) == 16, "Compact vertices are half of a Vertex");
+
+// Sizes are of the GPU buffers, errors the largest found by decoding every vertex again
+struct VertexCompactionStats {
+    size_t fullBytes    = 0;
+    size_t compactBytes = 0;
+
+    // Mesh units
+    float maxPositionError = 0.0f;
+    // Degrees
+    float maxNormalError   = 0.0f;
+    float maxUvError       = 0.0f;
+};
+
+// Per-instance vertex data, read by shaders through a float4x4 INSTANCE_WORLD input
+struct InstanceData {
+    DirectX::XMFLOAT4X4 world;
+};
+
 struct Shader {
     Microsoft::WRL::ComPtr<ID3D11VertexShader> vertexShader;
     Microsoft::WRL::ComPtr<ID3D11PixelShader>  pixelShader;
     Microsoft::WRL::ComPtr<ID3D11InputLayout>  inputLayout;
+
+    // Set when the vertex shader takes INSTANCE_WORLD, such shaders are always drawn instanced
+    bool instanced = false;
+    // Compact when the vertex shader takes OCT_NORMAL, only meshes of the same format can be drawn with it
+    VertexFormat format = VertexFormat::Full;
+};
+
+// Index range of one level of detail, error is how far the level strays from the full mesh in mesh units
+struct MeshLod {
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    float    error      = 0.0f;
+};
+
+// What a resource keeps in RAM once its data is on the GPU, see Residency.h
+enum class ResidencyPolicy : uint8_t {
+    DropAfterUpload,
+    // LZ compressed, expanded again on demand through readCpuCopy
+    KeepCompressed,
+    // Kept as uploaded, for CPU side work such as occluders or picking
+    KeepForQueries,
 };
 
 struct Mesh {
     Microsoft::WRL::ComPtr<ID3D11Buffer> vertexArrayBuffer;
-    D3D11_SUBRESOURCE_DATA vertexInitData;
-
     Microsoft::WRL::ComPtr<ID3D11Buffer> indexArrayBuffer;
-    D3D11_SUBRESOURCE_DATA indexInitData;
 
+    // Empty unless the residency is KeepForQueries, the counts are always those of the GPU buffers
     std::vector<Vertex>   vertices;
     std::vector<uint32_t> indices;
+    uint32_t              vertexCount = 0;
+    uint32_t              indexCount  = 0;
+
+    // Vertices then indices, set when the residency is KeepCompressed
+    std::vector<uint8_t> compressed;
+    ResidencyPolicy      residency = ResidencyPolicy::KeepForQueries;
+
+    // Layout of the GPU buffers. Compact meshes are drawn with dequantize folded in front of the world matrix
+    VertexFormat          format       = VertexFormat::Full;
+    uint32_t              vertexStride = sizeof(Vertex);
+    uint32_t              indexBytes   = sizeof(uint32_t);
+    DirectX::XMFLOAT4X4   dequantize   = { 1.0f, 0.0f, 0.0f, 0.0f,
+                                           0.0f, 1.0f, 0.0f, 0.0f,
+                                           0.0f, 0.0f, 1.0f, 0.0f,
+                                           0.0f, 0.0f, 0.0f, 1.0f };
+    VertexCompactionStats compaction;
+
+    // Local space, computed once when the mesh is created
+    Bounds bounds;
+
+    // Level 0 is the full mesh, coarser levels follow it in the same index buffer
+    std::vector<MeshLod> lods;
+
+    MeshLod getLod(const size_t level) const {
+        if (this->lods.empty()) return { 0, this->indexCount, 0.0f };
+        return this->lods[std::min(level, this->lods.size() - 1)];
+    }
 
-    std::string path;
+    StringID path = RC_EMPTY_STRING;
 };
 
 struct Texture {
     Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>             texture;
+    // Decoded RGBA8 pixels, only kept when the residency is KeepForQueries
     std::unique_ptr<unsigned char[], decltype(&stbi_image_free)> image;
 
-    std::string path;
+    uint32_t width  = 0;
+    uint32_t height = 0;
+
+    // Pixels, set when the residency is KeepCompressed
+    std::vector<uint8_t> compressed;
+    ResidencyPolicy      residency = ResidencyPolicy::KeepForQueries;
+
+    StringID path = RC_EMPTY_STRING;
 
     Texture() : texture(nullptr), image(nullptr, stbi_image_free) {}
+    Texture(Texture&&) = default;
+    Texture(const Texture& other) :
+        texture(other.texture), image(nullptr, stbi_image_free),
+        width(other.width), height(other.height),
+        compressed(other.compressed), residency(other.residency),
+        path(other.path)
+    {
+        if (!other.image) return;
+
+        // stbi_image_free releases with free, so the copy has to come from malloc too
+        const size_t bytes = static_cast<size_t>(other.width) * other.height * 4;
+        this->image.reset(static_cast<unsigned char*>(malloc(bytes)));
+        if (this->image) memcpy(this->image.get(), other.image.get(), bytes);
+    }
+    Texture& operator=(Texture&&) = default;
 };
 
 struct Buffer {
     Microsoft::WRL::ComPtr<ID3D11Buffer> buffer;
     std::string                          name;
 	PipelineStage                        stage;
+
+    // Last data written, a copied model is given a buffer of its own starting from it
+    std::vector<unsigned char>           contents;
 };
 
+// Resources are immutable and may be shared between models, e.g. every instance of a prefab.
+// Use makeEditable before changing one so the other owners keep their copy.
+// Buffers are written in place, a copied model shares them until Renderer::copyBuffers gives it its own.
 struct Model {
-    Transform                  transform;
-    std::unique_ptr<Mesh>      mesh;
-    std::unique_ptr<Shader>    shader;
-    std::unique_ptr<Texture>   texture;
+    // Picked up at the start of every frame, written directly or through Renderer::setTransform
+    Transform                      transform;
+    std::shared_ptr<const Mesh>    mesh;
+    std::shared_ptr<const Shader>  shader;
+    std::shared_ptr<const Texture> texture;
+
+    // Drawn into the CPU occlusion buffer when set, usually a coarse stand-in for mesh.
+    // Rasterized from its CPU copy, so it has to be loaded with ResidencyPolicy::KeepForQueries
+    std::shared_ptr<const Mesh>    occluder;
 
     std::vector<Buffer> buffers;
-    std::string         name;
-};
\ No newline at end of file
+    StringID            name = RC_EMPTY_STRING;
+
+    // World space mesh bounds, refreshed by the renderer along with transform.model
+    Bounds bounds;
+
+    // Transparent models are drawn after every opaque one, back to front and alpha blended
+    RenderPass pass = RenderPass::Opaque;
+
+    // Level of detail drawn last frame, selection starts from it so levels do not flicker
+    uint8_t lod = 0;
+};
+
+template <typename Ty>
+Ty* makeEditable(std::shared_ptr<const Ty>& resource) {
+    if (!resource) return nullptr;
+    if (resource.use_count() > 1) resource = std::make_shared<Ty>(*resource);
+
+    return const_cast<Ty*>(resource.get());
+}
\ No newline at end of file
@@ -0,0 +1,130 @@
+#pragma once
+#include "framework.h"
+
+#include "DirectX11Types.h"
+#include "ThreadPool.h"
+#include "FlatHashMap.h"
+
+#include <array>
+
+// Draw key layout, most significant bits first:
+//   opaque      | pass:2 | shader:12 | texture:14 | mesh:11 | lod:3 | depth:22 |   front to back inside equal state
+//   transparent | pass:2 | far depth:22 | shader:12 | texture:14 | mesh:11 | lod:3 |   back to front first
+// Levels of detail draw different index ranges, so the level sits next to the mesh to keep equal draws adjacent for batching
+constexpr uint32_t RC_SORT_PASS_BITS    = 2;
+constexpr uint32_t RC_SORT_SHADER_BITS  = 12;
+constexpr uint32_t RC_SORT_TEXTURE_BITS = 14;
+constexpr uint32_t RC_SORT_MESH_BITS    = 11;
+constexpr uint32_t RC_SORT_LOD_BITS     = 3;
+constexpr uint32_t RC_SORT_DEPTH_BITS   = 22;
+constexpr uint32_t RC_SORT_STATE_BITS   = RC_SORT_SHADER_BITS + RC_SORT_TEXTURE_BITS + RC_SORT_MESH_BITS + RC_SORT_LOD_BITS;
+
+static_assert(RC_SORT_PASS_BITS + RC_SORT_STATE_BITS + RC_SORT_DEPTH_BITS == 64, "Draw keys are 64 bits");
+
+// Below this many draws the sort runs on the calling thread, it is faster than waking the pool
+constexpr size_t RC_PARALLEL_SORT_THRESHOLD = 16384;
+
+// Hands out small dense ids for GPU objects, so they fit in the few key bits they get.
+// When the ids run out the table starts over, which can only make sorting worse, never wrong.
+class SortIdTable {
+private:
+	FlatHashMap<const void*, uint32_t> ids;
+	uint32_t                           limit = 0;
+
+public:
+	void build(const uint32_t bits) {
+		this->limit = 1u << bits;
+		this->ids.clear();
+	}
+
+	uint32_t get(const void* object) {
+		if (!object) return 0;
+
+		auto it = this->ids.find(object);
+		if (it != this->ids.end()) return it->second;
+
+		if (this->ids.size() + 1 >= this->limit) this->ids.clear();
+
+		const uint32_t id = static_cast<uint32_t>(this->ids.size()) + 1;
+		this->ids.emplace(object, id);
+		return id;
+	}
+};
+
+// Levels past the last one the key can hold share it
+inline uint64_t drawSortKey(const RenderPass pass, const uint32_t shader, const uint32_t texture, const uint32_t mesh, const uint32_t lod, const float normalizedDepth) {
+	constexpr uint32_t depthMax = (1u << RC_SORT_DEPTH_BITS) - 1;
+	constexpr uint32_t lodMax   = (1u << RC_SORT_LOD_BITS) - 1;
+	const uint64_t     depth    = static_cast<uint64_t>(std::clamp(normalizedDepth, 0.0f, 1.0f) * depthMax);
+
+	const uint64_t state = (static_cast<uint64_t>(shader) << (RC_SORT_TEXTURE_BITS + RC_SORT_MESH_BITS + RC_SORT_LOD_BITS))
+						 | (static_cast<uint64_t>(texture) << (RC_SORT_MESH_BITS + RC_SORT_LOD_BITS))
+						 | (static_cast<uint64_t>(mesh) << RC_SORT_LOD_BITS)
+						 | static_cast<uint64_t>(std::min(lod, lodMax));
+	const uint64_t passBits = static_cast<uint64_t>(pass) << (64 - RC_SORT_PASS_BITS);
+
+	if (pass == RenderPass::Transparent) {
+		return passBits | ((depthMax - depth) << RC_SORT_STATE_BITS) | state;
+	}
+	return passBits | (state << RC_SORT_DEPTH_BITS) | depth;
+}
+
+// Shader, texture, mesh and level of detail bits of a key, whichever pass it belongs to
+inline uint64_t drawStateBits(const uint64_t key) {
+	constexpr uint64_t stateMask = (1ull << RC_SORT_STATE_BITS) - 1;
+
+	const auto pass = static_cast<RenderPass>(key >> (64 - RC_SORT_PASS_BITS));
+	return pass == RenderPass::Transparent ? key & stateMask : (key >> RC_SORT_DEPTH_BITS) & stateMask;
+}
+inline size_t countStateChanges(const uint64_t* keys, const size_t count) {
+	size_t changes = count > 0 ? 1 : 0;
+	for (size_t i = 1; i < count; i++) {
+		if (drawStateBits(keys[i]) != drawStateBits(keys[i - 1])) changes++;
+	}
+	return changes;
+}
+
+struct DrawSortStats {
+	size_t draws = 0;
+
+	// Shader, texture, mesh and level of detail switches the submission order would cost, before and after sorting
+	size_t stateChangesUnsorted = 0;
+	size_t stateChangesSorted   = 0;
+
+	// The radix sort alone, the state change counts are not included
+	float sortMilliseconds = 0.0f;
+};
+
+// LSD radix sort of 64 bit keys carrying 32 bit payloads, the histogram and scatter of every digit run in parallel chunks
+class DrawSorter {
+private:
+	using Histogram = std::array<uint32_t, 256>;
+
+	ThreadPool* scheduler     = nullptr;
+	size_t      threadsAmount = 1;
+
+	std::vector<uint64_t>  keysScratch;
+	std::vector<uint32_t>  valuesScratch;
+	std::vector<Histogram> histograms;
+
+	template <typename Fn>
+	void run(const size_t chunks, Fn& work) {
+		if (chunks == 1) {
+			work(0);
+			return;
+		}
+
+		ThreadGroup* group = this->scheduler->scheduleWorkIndexed(chunks, work);
+		group->join();
+		delete group;
+	}
+
+public:
+	void build(ThreadPool* scheduler, const size_t threadsAmount) {
+		this->scheduler     = scheduler;
+		this->threadsAmount = std::max<size_t>(threadsAmount, 1);
+	}
+
+	// Sorts keys ascending and moves each value along with its key, equal keys keep their order
+	void sort(uint64_t* keys, uint32_t* values, const size_t count);
+};
\ No newline at end of file
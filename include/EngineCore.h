@@ -3,7 +3,7 @@
 #include "Renderer.h"
 #include "Window.h"
 #include "GuiManager.h"
-#include "Time.h"
+#include "RCTime.h"
 #include "InputManager.h"
 #include "DebugConsole.h"
 
@@ -31,8 +31,8 @@ private:
 	std::unique_ptr<InputManager>   inputManager;
 	std::unique_ptr<ThreadPool>     scheduler;
 
-	std::unordered_map<std::type_index, void*> additionalManagers;
-	std::vector<void*>                         additionalManagersPtrs;
+	FlatHashMap<std::type_index, void*> additionalManagers;
+	std::vector<void*>                  additionalManagersPtrs;
 
 	std::chrono::steady_clock::time_point startTime;
 	std::chrono::steady_clock::time_point endTime;
@@ -104,13 +104,13 @@ public:
 					std::this_thread::sleep_for(std::chrono::duration<float>(this->internalTargetFPS - frameDuration));
 				}
 
-				startTime = std::chrono::high_resolution_clock::now();
+				startTime = std::chrono::steady_clock::now();
 				RCTime::startUpdate();
 
 				updateFunction();
 
 				RCTime::endUpdate();
-				endTime = std::chrono::high_resolution_clock::now();
+				endTime = std::chrono::steady_clock::now();
 			}
 		};
 	}
@@ -0,0 +1,387 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <utility>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "Hash.h"
+
+namespace FlatHashDetail {
+	constexpr int8_t EMPTY   = -128;
+	constexpr int8_t DELETED = -2;
+
+	constexpr size_t GROUP_WIDTH = 16;
+
+	// Post mix, identity hashes (integers, pointers) would otherwise leave the low bits idle
+	inline uint64_t mix(uint64_t hash) noexcept {
+		hash ^= hash >> 33;
+		hash *= 0xff51afd7ed558ccdull;
+		hash ^= hash >> 33;
+		return hash;
+	}
+
+	// 16 control bytes compared at once, one bit per slot in the returned masks
+	struct Group {
+		__m128i control;
+
+		explicit Group(const int8_t* position) : control(_mm_load_si128(reinterpret_cast<const __m128i*>(position))) {}
+
+		uint32_t match(const int8_t h2) const noexcept {
+			return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), this->control)));
+		}
+		uint32_t matchEmpty() const noexcept {
+			return this->match(EMPTY);
+		}
+		uint32_t matchEmptyOrDeleted() const noexcept {
+			return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(-1), this->control)));
+		}
+	};
+
+	inline uint32_t lowestBit(const uint32_t mask) noexcept {
+#ifdef _MSC_VER
+		unsigned long index;
+		_BitScanForward(&index, mask);
+		return index;
+#else
+		return static_cast<uint32_t>(__builtin_ctz(mask));
+#endif
+	}
+}
+
+// Transparent hashing so string keyed maps can be searched with a string_view or a literal
+struct StringHash {
+	using is_transparent = void;
+
+	size_t operator()(const std::string_view str) const noexcept { return static_cast<size_t>(fnv1a64(str)); }
+};
+struct StringEqual {
+	using is_transparent = void;
+
+	bool operator()(const std::string_view a, const std::string_view b) const noexcept { return a == b; }
+};
+
+// Open addressing map with SSE2 group probing (Swiss table layout). Rehashing moves the
+// values, so pointers and iterators are only stable until the next insertion.
+template <typename Key, typename Value, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+class FlatHashMap {
+public:
+	using key_type   = Key;
+	using value_type = std::pair<const Key, Value>;
+
+	template <bool IsConst>
+	class IteratorImpl {
+	private:
+		using MapType = std::conditional_t<IsConst, const FlatHashMap, FlatHashMap>;
+
+		MapType* map;
+		size_t   index;
+
+		void skipEmpty() {
+			while (this->index < this->map->_capacity && this->map->control[this->index] < 0) this->index++;
+		}
+
+	public:
+		using reference = std::conditional_t<IsConst, const value_type&, value_type&>;
+		using pointer   = std::conditional_t<IsConst, const value_type*, value_type*>;
+
+		IteratorImpl(MapType* map, const size_t index) : map(map), index(index) { this->skipEmpty(); }
+		template <bool OtherConst> requires (IsConst && !OtherConst)
+		IteratorImpl(const IteratorImpl<OtherConst>& other) : map(other.map), index(other.index) {}
+
+		reference operator*() const { return this->map->slots[this->index]; }
+		pointer operator->() const { return &this->map->slots[this->index]; }
+
+		IteratorImpl& operator++() {
+			this->index++;
+			this->skipEmpty();
+			return *this;
+		}
+
+		bool operator==(const IteratorImpl& other) const noexcept { return this->index == other.index; }
+		bool operator!=(const IteratorImpl& other) const noexcept { return this->index != other.index; }
+
+		friend class FlatHashMap;
+		friend class IteratorImpl<!IsConst>;
+	};
+
+	using iterator       = IteratorImpl<false>;
+	using const_iterator = IteratorImpl<true>;
+
+private:
+	int8_t*     control   = nullptr;
+	value_type* slots     = nullptr;
+	size_t      _capacity = 0;
+	size_t      _size     = 0;
+	size_t      deleted   = 0;
+
+	Hash     hasher;
+	KeyEqual equal;
+
+	template <typename K>
+	uint64_t hashOf(const K& key) const {
+		return FlatHashDetail::mix(static_cast<uint64_t>(this->hasher(key)));
+	}
+
+	// Triangular probing over whole groups visits every group once when the group count is a power of two
+	template <typename K>
+	size_t findIndex(const K& key, const uint64_t hash) const {
+		if (this->_capacity == 0) return this->_capacity;
+
+		const size_t groupMask = this->_capacity / FlatHashDetail::GROUP_WIDTH - 1;
+		const int8_t h2        = static_cast<int8_t>(hash & 0x7f);
+
+		size_t group = (hash >> 7) & groupMask;
+		for (size_t probe = 0; probe <= groupMask; probe++) {
+			const size_t base = group * FlatHashDetail::GROUP_WIDTH;
+			FlatHashDetail::Group controlGroup(this->control + base);
+
+			for (uint32_t mask = controlGroup.match(h2); mask; mask &= mask - 1) {
+				const size_t index = base + FlatHashDetail::lowestBit(mask);
+				if (this->equal(this->slots[index].first, key)) return index;
+			}
+			if (controlGroup.matchEmpty()) break;
+
+			group = (group + probe + 1) & groupMask;
+		}
+		return this->_capacity;
+	}
+	size_t findFreeIndex(const uint64_t hash) const {
+		const size_t groupMask = this->_capacity / FlatHashDetail::GROUP_WIDTH - 1;
+
+		size_t group = (hash >> 7) & groupMask;
+		for (size_t probe = 0;; probe++) {
+			const size_t base = group * FlatHashDetail::GROUP_WIDTH;
+
+			const uint32_t mask = FlatHashDetail::Group(this->control + base).matchEmptyOrDeleted();
+			if (mask) return base + FlatHashDetail::lowestBit(mask);
+
+			group = (group + probe + 1) & groupMask;
+		}
+	}
+
+	void allocate(const size_t capacity) {
+		this->_capacity = capacity;
+		this->control   = static_cast<int8_t*>(::operator new(capacity, std::align_val_t(FlatHashDetail::GROUP_WIDTH)));
+		this->slots     = static_cast<value_type*>(::operator new(capacity * sizeof(value_type), std::align_val_t(alignof(value_type))));
+
+		memset(this->control, FlatHashDetail::EMPTY, capacity);
+	}
+	void release() {
+		if (!this->control) return;
+
+		for (size_t i = 0; i < this->_capacity; i++) {
+			if (this->control[i] >= 0) std::destroy_at(&this->slots[i]);
+		}
+
+		::operator delete(this->control, std::align_val_t(FlatHashDetail::GROUP_WIDTH));
+		::operator delete(this->slots, std::align_val_t(alignof(value_type)));
+
+		this->control   = nullptr;
+		this->slots     = nullptr;
+		this->_capacity = 0;
+		this->_size     = 0;
+		this->deleted   = 0;
+	}
+
+	void rehash(size_t capacity) {
+		capacity = std::max(capacity, FlatHashDetail::GROUP_WIDTH);
+
+		size_t groups = 1;
+		while (groups * FlatHashDetail::GROUP_WIDTH < capacity) groups <<= 1;
+
+		int8_t*      oldControl  = this->control;
+		value_type*  oldSlots    = this->slots;
+		const size_t oldCapacity = this->_capacity;
+
+		this->allocate(groups * FlatHashDetail::GROUP_WIDTH);
+		this->deleted = 0;
+
+		for (size_t i = 0; i < oldCapacity; i++) {
+			if (oldControl[i] < 0) continue;
+
+			const uint64_t hash  = this->hashOf(oldSlots[i].first);
+			const size_t   index = this->findFreeIndex(hash);
+
+			this->control[index] = static_cast<int8_t>(hash & 0x7f);
+			std::construct_at(&this->slots[index], std::move(oldSlots[i]));
+			std::destroy_at(&oldSlots[i]);
+		}
+
+		if (oldControl) {
+			::operator delete(oldControl, std::align_val_t(FlatHashDetail::GROUP_WIDTH));
+			::operator delete(oldSlots, std::align_val_t(alignof(value_type)));
+		}
+	}
+
+	// 7/8 maximum load, tombstones count against it so a churned table gets cleaned by a same size rehash
+	void growIfNeeded() {
+		if ((this->_size + this->deleted + 1) * 8 <= this->_capacity * 7) return;
+
+		if (this->deleted > this->_size / 2 && this->_capacity > 0) this->rehash(this->_capacity);
+		else this->rehash(this->_capacity * 2);
+	}
+
+	template <typename K, typename... Args>
+	std::pair<iterator, bool> emplaceImpl(K&& key, Args&&... args) {
+		uint64_t hash  = this->hashOf(key);
+		size_t   index = this->findIndex(key, hash);
+		if (index != this->_capacity) return { iterator(this, index), false };
+
+		this->growIfNeeded();
+
+		index = this->findFreeIndex(hash);
+		if (this->control[index] == FlatHashDetail::DELETED) this->deleted--;
+
+		this->control[index] = static_cast<int8_t>(hash & 0x7f);
+		std::construct_at(&this->slots[index], std::piecewise_construct,
+						  std::forward_as_tuple(std::forward<K>(key)),
+						  std::forward_as_tuple(std::forward<Args>(args)...));
+		this->_size++;
+
+		return { iterator(this, index), true };
+	}
+
+	static constexpr bool isTransparent = requires { typename Hash::is_transparent; typename KeyEqual::is_transparent; };
+
+public:
+	FlatHashMap() = default;
+	FlatHashMap(const FlatHashMap& other) : hasher(other.hasher), equal(other.equal) {
+		this->reserve(other._size);
+		for (auto& value : other) this->emplaceImpl(value.first, value.second);
+	}
+	FlatHashMap(FlatHashMap&& other) noexcept :
+		control(other.control), slots(other.slots),
+		_capacity(other._capacity), _size(other._size), deleted(other.deleted),
+		hasher(std::move(other.hasher)), equal(std::move(other.equal))
+	{
+		other.control   = nullptr;
+		other.slots     = nullptr;
+		other._capacity = 0;
+		other._size     = 0;
+		other.deleted   = 0;
+	}
+
+	~FlatHashMap() {
+		this->release();
+	}
+
+	FlatHashMap& operator=(const FlatHashMap& other) {
+		if (this != &other) {
+			this->release();
+			this->reserve(other._size);
+			for (auto& value : other) this->emplaceImpl(value.first, value.second);
+		}
+		return *this;
+	}
+	FlatHashMap& operator=(FlatHashMap&& other) noexcept {
+		if (this != &other) {
+			this->release();
+			std::swap(this->control, other.control);
+			std::swap(this->slots, other.slots);
+			std::swap(this->_capacity, other._capacity);
+			std::swap(this->_size, other._size);
+			std::swap(this->deleted, other.deleted);
+		}
+		return *this;
+	}
+
+	void reserve(const size_t count) {
+		const size_t needed = (count * 8 + 6) / 7;
+		if (needed > this->_capacity) this->rehash(needed);
+	}
+	void clear() {
+		for (size_t i = 0; i < this->_capacity; i++) {
+			if (this->control[i] >= 0) std::destroy_at(&this->slots[i]);
+		}
+		if (this->control) memset(this->control, FlatHashDetail::EMPTY, this->_capacity);
+
+		this->_size   = 0;
+		this->deleted = 0;
+	}
+
+	size_t size() const noexcept { return this->_size; }
+	size_t capacity() const noexcept { return this->_capacity; }
+	bool empty() const noexcept { return this->_size == 0; }
+
+	iterator begin() { return iterator(this, 0); }
+	iterator end() { return iterator(this, this->_capacity); }
+	const_iterator begin() const { return const_iterator(this, 0); }
+	const_iterator end() const { return const_iterator(this, this->_capacity); }
+
+	iterator find(const Key& key) {
+		return iterator(this, this->findIndex(key, this->hashOf(key)));
+	}
+	const_iterator find(const Key& key) const {
+		return const_iterator(this, this->findIndex(key, this->hashOf(key)));
+	}
+	// Any other key type goes straight to the transparent functors, so a literal never builds a temporary Key
+	template <typename K> requires (isTransparent && !std::is_same_v<std::remove_cvref_t<K>, Key>)
+	iterator find(const K& key) {
+		return iterator(this, this->findIndex(key, this->hashOf(key)));
+	}
+	template <typename K> requires (isTransparent && !std::is_same_v<std::remove_cvref_t<K>, Key>)
+	const_iterator find(const K& key) const {
+		return const_iterator(this, this->findIndex(key, this->hashOf(key)));
+	}
+
+	bool contains(const Key& key) const { return this->find(key) != this->end(); }
+	template <typename K> requires (isTransparent && !std::is_same_v<std::remove_cvref_t<K>, Key>)
+	bool contains(const K& key) const { return this->find(key) != this->end(); }
+
+	std::pair<iterator, bool> insert(const value_type& value) {
+		return this->emplaceImpl(value.first, value.second);
+	}
+	std::pair<iterator, bool> insert(value_type&& value) {
+		return this->emplaceImpl(value.first, std::move(value.second));
+	}
+	template <typename K, typename... Args>
+	std::pair<iterator, bool> emplace(K&& key, Args&&... args) {
+		return this->emplaceImpl(Key(std::forward<K>(key)), std::forward<Args>(args)...);
+	}
+	template <typename... Args>
+	std::pair<iterator, bool> try_emplace(const Key& key, Args&&... args) {
+		return this->emplaceImpl(key, std::forward<Args>(args)...);
+	}
+	template <typename V>
+	std::pair<iterator, bool> insert_or_assign(const Key& key, V&& value) {
+		auto result = this->emplaceImpl(key, std::forward<V>(value));
+		if (!result.second) result.first->second = std::forward<V>(value);
+		return result;
+	}
+
+	Value& operator[](const Key& key) {
+		return this->emplaceImpl(key).first->second;
+	}
+
+	size_t erase(const Key& key) {
+		const size_t index = this->findIndex(key, this->hashOf(key));
+		if (index == this->_capacity) return 0;
+
+		this->erase(iterator(this, index));
+		return 1;
+	}
+	void erase(const_iterator where) {
+		const size_t index = where.index;
+		std::destroy_at(&this->slots[index]);
+		this->_size--;
+
+		// Probes stop at the first group with an empty byte, so if this group has one nothing probes past it
+		const size_t base = index & ~(FlatHashDetail::GROUP_WIDTH - 1);
+		if (FlatHashDetail::Group(this->control + base).matchEmpty()) {
+			this->control[index] = FlatHashDetail::EMPTY;
+		}
+		else {
+			this->control[index] = FlatHashDetail::DELETED;
+			this->deleted++;
+		}
+	}
+};
\ No newline at end of file
@@ -22,6 +22,10 @@ private:
 
 	Allocator allocator;
 
+	// Set by build<Ty>(), the storage is type erased so this is how the destructor reaches the elements. Copies are
+	// bytewise and leave it empty, the source still owns anything non trivial
+	void (*destroyElements)(unsigned char* storage, const size_t size) = nullptr;
+
 	RC_DBG_VAR(std::type_index FLEXIBLE_VECTOR_DBG_TYPE = typeid(void));
 
 	template <typename Ty>
@@ -87,7 +91,8 @@ public:
 		storage(other.storage),
 		_capacity(other._capacity),
 		_size(other._size),
-		itemSize(other.itemSize)
+		itemSize(other.itemSize),
+		destroyElements(other.destroyElements)
 	{
 		RC_DBG_CODE(
 			this->FLEXIBLE_VECTOR_DBG_TYPE = other.FLEXIBLE_VECTOR_DBG_TYPE;
@@ -97,6 +102,7 @@ public:
 	}
 
 	~FlexibleVector() {
+		if (this->storage && this->destroyElements) this->destroyElements(this->storage, this->_size);
 		if (this->storage) this->allocator.deallocate(this->storage, this->itemSize * this->_capacity);
 	}
 
@@ -112,6 +118,8 @@ public:
 		this->_size = 0;
 
 		this->itemSize = sizeof(Ty);
+
+		this->destroyElements = [](unsigned char* storage, const size_t size) { std::destroy_n(reinterpret_cast<Ty*>(storage), size); };
 	}
 	template <typename Ty>
 	void build(const size_t initialSize) {
@@ -134,6 +142,10 @@ public:
 	const size_t size() const { return this->_size; }
 	const size_t capacity() const { return this->_capacity; }
 
+	unsigned char* data() { return this->storage; }
+	const unsigned char* data() const { return this->storage; }
+	const size_t elementSize() const { return this->itemSize; }
+
 	template <typename Ty>
 	void reserve(const size_t elementsAmmount) {
 		this->reserveImpl<Ty>(elementsAmmount);
@@ -168,6 +180,16 @@ public:
 		std::construct_at(location, std::forward<Ty>(element));
 	}
 
+	// Bulk replace of the contents, only valid for relocatable types
+	template <typename Ty>
+	void assign(const Ty* elements, const size_t count) {
+		static_assert(std::is_trivially_copyable_v<Ty>, "FlexibleVector::assign requires a trivially copyable type");
+
+		if (count > this->_capacity) this->reserveImpl<Ty>(count - this->_capacity);
+		if (count > 0) memcpy(this->storage, elements, count * sizeof(Ty));
+		this->_size = count;
+	}
+
 	template <typename Ty>
 	void erase(const Ty* where) {
 		auto begin = reinterpret_cast<Ty*>(this->storage);
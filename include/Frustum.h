@@ -0,0 +1,84 @@
+#pragma once
+#include "framework.h"
+
+#include "ThreadPool.h"
+
+// Below this many objects a cull runs on the calling thread
+constexpr size_t RC_CULL_CHUNK_SIZE = 16384;
+
+// Planes point inwards and are normalized, a point p is inside when dot(plane.xyz, p) + plane.w >= 0
+struct Frustum {
+	DirectX::XMFLOAT4 planes[6];
+};
+
+// Gribb-Hartmann extraction from the combined matrix, with D3D's 0..1 clip depth
+inline Frustum extractFrustum(const DirectX::XMMATRIX& view, const DirectX::XMMATRIX& projection) {
+	const DirectX::XMMATRIX columns = DirectX::XMMatrixTranspose(view * projection);
+
+	const DirectX::XMVECTOR planes[6] = {
+		DirectX::XMVectorAdd(columns.r[3], columns.r[0]),      // Left
+		DirectX::XMVectorSubtract(columns.r[3], columns.r[0]), // Right
+		DirectX::XMVectorAdd(columns.r[3], columns.r[1]),      // Bottom
+		DirectX::XMVectorSubtract(columns.r[3], columns.r[1]), // Top
+		columns.r[2],                                          // Near
+		DirectX::XMVectorSubtract(columns.r[3], columns.r[2]), // Far
+	};
+
+	Frustum frustum = {};
+	for (int i = 0; i < 6; i++) {
+		DirectX::XMStoreFloat4(&frustum.planes[i], DirectX::XMPlaneNormalize(planes[i]));
+	}
+	return frustum;
+}
+
+// World bounds in structure of arrays form, so one SIMD load reads the same field of several objects.
+// Extents are the half sizes of axis aligned boxes sharing the sphere centers, they may be left empty.
+struct CullBounds {
+	std::vector<float> centerX;
+	std::vector<float> centerY;
+	std::vector<float> centerZ;
+	std::vector<float> radius;
+
+	std::vector<float> extentX;
+	std::vector<float> extentY;
+	std::vector<float> extentZ;
+
+	void resize(const size_t count, const bool boxes) {
+		this->centerX.resize(count);
+		this->centerY.resize(count);
+		this->centerZ.resize(count);
+		this->radius.resize(count);
+
+		const size_t boxCount = boxes ? count : 0;
+		this->extentX.resize(boxCount);
+		this->extentY.resize(boxCount);
+		this->extentZ.resize(boxCount);
+	}
+
+	size_t size() const noexcept { return this->radius.size(); }
+	bool hasBoxes() const noexcept { return !this->extentX.empty() && this->extentX.size() == this->radius.size(); }
+};
+
+// Writes the indices in [begin, end) that intersect the frustum to out, returns how many were written.
+// Spheres are always tested, boxes too when the bounds have them.
+size_t cullRange(const Frustum& frustum, const CullBounds& bounds, const size_t begin, const size_t end, uint32_t* out);
+
+class FrustumCuller {
+private:
+	ThreadPool* scheduler     = nullptr;
+	size_t      threadsAmount = 1;
+
+	std::vector<std::vector<uint32_t>> chunkVisible;
+	std::vector<size_t>                chunkCounts;
+
+	std::vector<uint32_t> visible;
+
+public:
+	void build(ThreadPool* scheduler, const size_t threadsAmount) {
+		this->scheduler     = scheduler;
+		this->threadsAmount = std::max<size_t>(threadsAmount, 1);
+	}
+
+	// Returns the visible indices in ascending order, valid until the next cull
+	const std::vector<uint32_t>& cull(const Frustum& frustum, const CullBounds& bounds);
+};
\ No newline at end of file
@@ -6,6 +6,11 @@
 
 
 class GuiManager {
+#ifdef RC_HEADLESS
+private:
+    Window* window = nullptr;
+
+#endif
 public:
     GuiManager() = default;
 
@@ -0,0 +1,32 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <string_view>
+
+constexpr uint64_t RC_FNV_OFFSET = 14695981039346656037ull;
+constexpr uint64_t RC_FNV_PRIME  = 1099511628211ull;
+
+inline uint64_t fnv1a64(const void* data, const size_t size, uint64_t seed = RC_FNV_OFFSET) noexcept {
+	const unsigned char* bytes = static_cast<const unsigned char*>(data);
+	for (size_t i = 0; i < size; i++) {
+		seed ^= bytes[i];
+		seed *= RC_FNV_PRIME;
+	}
+	return seed;
+}
+constexpr uint64_t fnv1a64(const std::string_view str, uint64_t seed = RC_FNV_OFFSET) noexcept {
+	for (const char c : str) {
+		seed ^= static_cast<unsigned char>(c);
+		seed *= RC_FNV_PRIME;
+	}
+	return seed;
+}
+
+template <typename Ty>
+uint64_t hashCombine(const uint64_t seed, const Ty& value) noexcept {
+	return fnv1a64(&value, sizeof(Ty), seed);
+}
+// Length first, so moving characters from one field to the next changes the hash
+inline uint64_t hashField(const uint64_t seed, const std::string_view field) noexcept {
+	return fnv1a64(field, hashCombine(seed, static_cast<uint64_t>(field.size())));
+}
\ No newline at end of file
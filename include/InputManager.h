@@ -7,19 +7,33 @@ class InputManager {
 private:
 	Window* window;
 
+#ifdef RC_HEADLESS
+	// What a headless run reports as held, whoever scripts the input sets it
+	bool keys[256] = {};
+#else
 	MSG msg;
+#endif
 
-	bool squit;
+	bool squit = false;
 
 public:
 	void build(Window* window);
 
 	void update();
 
+#ifdef RC_HEADLESS
+	bool getKey(const char key) {
+		return this->keys[static_cast<uint8_t>(key)];
+	}
+	void setKey(const char key, const bool down) {
+		this->keys[static_cast<uint8_t>(key)] = down;
+	}
+#else
 	bool getKey(const char key) {
 		if (GetAsyncKeyState(key) & 0x8000) return true;
 		else return false;
 	}
+#endif
 
 	BOOL poolEvents();
 
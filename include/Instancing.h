@@ -0,0 +1,47 @@
+#pragma once
+#include "framework.h"
+
+#include "DirectX11Types.h"
+
+// What decides whether two draws can share an instanced call
+struct InstanceGroupKey {
+	const void* shader   = nullptr;
+	const void* texture  = nullptr;
+	const void* mesh     = nullptr;
+	RenderPass  pass     = RenderPass::Opaque;
+	uint8_t     lod      = 0;
+
+	// The shader reads INSTANCE_WORLD, so the draw goes through the instance buffer even on its own
+	bool instanced = false;
+	// No per-model buffers, so nothing but the world matrix differs from its neighbours
+	bool mergeable = false;
+};
+
+struct DrawBatch {
+	// Range in the sorted draw order
+	uint32_t first          = 0;
+	uint32_t count          = 0;
+	// First instance of the batch in the frame's instance buffer
+	uint32_t instanceOffset = 0;
+	bool     instanced      = false;
+};
+
+// Merges runs of adjacent draws that use the same mesh, shader and texture into instanced batches.
+// Only CPU data goes in and out, the renderer uploads what pack() writes.
+class InstanceBatcher {
+private:
+	std::vector<DrawBatch> batches;
+	uint32_t               instanceCount = 0;
+
+public:
+	// Largest batch, a run longer than this is split
+	uint32_t maxBatchSize = 65536;
+
+	// groups is indexed by draw, order is the sorted draw order
+	const std::vector<DrawBatch>& build(const uint32_t* order, const size_t count, const InstanceGroupKey* groups);
+	// Writes the instances of every instanced batch, out needs room for getInstanceCount() entries
+	void pack(const uint32_t* order, const InstanceData* drawInstances, InstanceData* out) const;
+
+	const std::vector<DrawBatch>& getBatches() const noexcept { return this->batches; }
+	uint32_t getInstanceCount() const noexcept { return this->instanceCount; }
+};
\ No newline at end of file
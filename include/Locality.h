@@ -0,0 +1,146 @@
+#pragma once
+#include "framework.h"
+
+#include "ReObjects.h"
+
+#include <numeric>
+
+// Interleaves three 21 bit coordinates into a 63 bit Morton code
+inline uint64_t spreadBits21(uint64_t value) noexcept {
+	value &= 0x1fffff;
+	value = (value | value << 32) & 0x1f00000000ffffull;
+	value = (value | value << 16) & 0x1f0000ff0000ffull;
+	value = (value | value << 8)  & 0x100f00f00f00f00full;
+	value = (value | value << 4)  & 0x10c30c30c30c30c3ull;
+	value = (value | value << 2)  & 0x1249249249249249ull;
+	return value;
+}
+inline uint64_t mortonKey(const DirectX::XMFLOAT3& position, const DirectX::XMFLOAT3& boundsMin, const DirectX::XMFLOAT3& boundsMax) noexcept {
+	auto quantize = [](const float value, const float min, const float max) -> uint64_t {
+		const float extent = max - min;
+		if (extent <= 0.0f) return 0;
+
+		const float normalized = std::clamp((value - min) / extent, 0.0f, 1.0f);
+		return static_cast<uint64_t>(normalized * 2097151.0f);
+	};
+
+	return spreadBits21(quantize(position.x, boundsMin.x, boundsMax.x))
+		| (spreadBits21(quantize(position.y, boundsMin.y, boundsMax.y)) << 1)
+		| (spreadBits21(quantize(position.z, boundsMin.z, boundsMax.z)) << 2);
+}
+
+// Reorders a column by key a few swaps at a time, the sort itself runs on the objects manager threads.
+// Components stored by value end up in key order in memory. For a column of pointers only the pointers move,
+// the owner can keep its own per-index data in step through the swap callback
+template <typename Ty>
+class ReorderPass {
+private:
+	ObjectsManager* objectsManager = nullptr;
+
+	// Lets the owner move data it keeps in column order along with the entities
+	std::function<void(size_t, size_t)> onSwap;
+
+	std::vector<uint64_t> keys;
+	std::vector<uint32_t> order;
+	std::vector<uint32_t> position;
+	std::vector<uint32_t> occupant;
+
+	ThreadGroup* sortGroup = nullptr;
+
+	uint64_t version = 0;
+	size_t   cursor  = 0;
+	bool     active  = false;
+
+	void waitForSort() {
+		if (!this->sortGroup) return;
+
+		this->sortGroup->join();
+		delete this->sortGroup;
+		this->sortGroup = nullptr;
+	}
+
+public:
+	~ReorderPass() {
+		this->waitForSort();
+	}
+
+	void build(ObjectsManager* objectsManager, std::function<void(size_t, size_t)> onSwap = nullptr) {
+		this->objectsManager = objectsManager;
+		this->onSwap         = std::move(onSwap);
+	}
+
+	void begin(const std::function<uint64_t(const Ty&)>& keyFunction) {
+		this->cancel();
+
+		FlexibleVector<>* column = this->objectsManager->getColumn(typeid(Ty));
+		if (!column || column->size() < 2) return;
+
+		const size_t count = column->size();
+		this->keys.resize(count);
+		for (size_t i = 0; i < count; i++) {
+			this->keys[i] = keyFunction(*column->at<Ty>(i));
+		}
+
+		this->position.resize(count);
+		this->occupant.resize(count);
+		std::iota(this->position.begin(), this->position.end(), 0u);
+		std::iota(this->occupant.begin(), this->occupant.end(), 0u);
+
+		this->version = this->objectsManager->getVersion<Ty>();
+		this->cursor  = 0;
+		this->active  = true;
+
+		this->sortGroup = this->objectsManager->getThreads()->scheduleWork(1, [this]() {
+			this->order.resize(this->keys.size());
+			std::iota(this->order.begin(), this->order.end(), 0u);
+			std::stable_sort(this->order.begin(), this->order.end(), [this](const uint32_t a, const uint32_t b) {
+				return this->keys[a] < this->keys[b];
+			});
+		});
+	}
+
+	// Applies at most maxSwaps swaps, returns true while the pass still has work left
+	bool step(const size_t maxSwaps) {
+		if (!this->active) return false;
+
+		if (this->sortGroup) {
+			if (this->sortGroup->finishedThreads.load(std::memory_order_acquire) < this->sortGroup->neededThreads) return true;
+			this->waitForSort();
+		}
+
+		// Entities were created or destroyed since the keys were taken, the plan is stale
+		if (this->version != this->objectsManager->getVersion<Ty>()) {
+			this->active = false;
+			return false;
+		}
+
+		size_t swaps = 0;
+		while (this->cursor < this->order.size() && swaps < maxSwaps) {
+			const uint32_t wanted  = this->order[this->cursor];
+			const uint32_t current = this->position[wanted];
+
+			if (current != this->cursor) {
+				const uint32_t displaced = this->occupant[this->cursor];
+				this->objectsManager->swapEntities<Ty>(this->cursor, current);
+				if (this->onSwap) this->onSwap(this->cursor, current);
+
+				this->occupant[current]      = displaced;
+				this->position[displaced]    = current;
+				this->occupant[this->cursor] = wanted;
+				this->position[wanted]       = static_cast<uint32_t>(this->cursor);
+				swaps++;
+			}
+			this->cursor++;
+		}
+
+		this->active = this->cursor < this->order.size();
+		return this->active;
+	}
+
+	void cancel() {
+		this->waitForSort();
+		this->active = false;
+	}
+
+	bool running() const noexcept { return this->active; }
+};
\ No newline at end of file
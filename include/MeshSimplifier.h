@@ -0,0 +1,70 @@
+#pragma once
+#include "framework.h"
+
+#include "DirectX11Types.h"
+
+// Index count of each generated level relative to the full mesh
+constexpr float  RC_LOD_RATIOS[]      = { 0.5f, 0.25f, 0.125f, 0.0625f };
+// Levels are not generated below this many triangles
+constexpr size_t RC_LOD_MIN_TRIANGLES = 64;
+
+// Quadric error edge collapse. Vertices only ever collapse onto one another, so every level
+// indexes the original vertex buffer. Vertices on open borders and attribute seams never move.
+class MeshSimplifier {
+private:
+	struct Quadric {
+		double a2, ab, ac, ad;
+		double b2, bc, bd;
+		double c2, cd;
+		double d2;
+	};
+	struct Collapse {
+		uint32_t from;
+		uint32_t to;
+		float    error;
+	};
+
+	std::vector<Quadric>  quadrics;
+	std::vector<uint8_t>  locked;
+	std::vector<uint8_t>  touched;
+	std::vector<uint32_t> remap;
+
+	std::vector<uint64_t> edges;
+	std::vector<Collapse> collapses;
+
+	std::vector<uint32_t> adjacencyOffsets;
+	std::vector<uint32_t> adjacency;
+
+	std::vector<uint32_t> neighbourMarks;
+	uint32_t              neighbourMark = 0;
+
+	void prepare(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+	void buildAdjacency(const std::vector<uint32_t>& indices, const size_t vertexCount);
+	bool canCollapse(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const uint32_t from, const uint32_t to);
+
+public:
+	// Simplifies towards each target index count in turn, they have to be decreasing. Every target reached
+	// adds a level and its error, the largest distance a collapse moved the surface, in mesh units.
+	// Stops early when nothing more can collapse.
+	void simplify(const std::vector<Vertex>&          vertices,
+				  const std::vector<uint32_t>&        indices,
+				  const std::vector<size_t>&          targets,
+				  std::vector<std::vector<uint32_t>>* outLevels,
+				  std::vector<float>*                 outErrors);
+};
+
+// Index buffer holding the full mesh followed by every level that could be generated, their ranges go to outLods
+std::vector<uint32_t> buildLodChain(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, std::vector<MeshLod>* outLods);
+
+// Coarsest level whose error projects under threshold pixels. A level is only left for a coarser one once that
+// one is under threshold * (1 - hysteresis), and for a finer one once it goes over threshold * (1 + hysteresis).
+inline uint8_t selectLod(const Mesh& mesh, const float pixelsPerUnit, const uint8_t current, const float threshold, const float hysteresis) {
+	if (mesh.lods.size() < 2) return 0;
+
+	size_t level = std::min<size_t>(current, mesh.lods.size() - 1);
+
+	while (level > 0 && mesh.lods[level].error * pixelsPerUnit > threshold * (1.0f + hysteresis)) level--;
+	while (level + 1 < mesh.lods.size() && mesh.lods[level + 1].error * pixelsPerUnit <= threshold * (1.0f - hysteresis)) level++;
+
+	return static_cast<uint8_t>(level);
+}
\ No newline at end of file
@@ -1,11 +1,13 @@
 #pragma once
 #include "framework.h"
 
-#include <io.h>
 #include <fstream>
 #include <fcntl.h>
-#include <share.h>
 #include <sys/stat.h>
+#ifdef _WIN32
+#include <io.h>
+#include <share.h>
+#endif
 
 #include <format>
 
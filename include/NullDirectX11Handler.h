@@ -0,0 +1,527 @@
+#pragma once
+// Included by DirectX11Handler.h in headless builds, after the declarations both backends share
+
+// Stands for the null compiler in shader cache keys, bump it whenever compileShader changes its output
+constexpr uint32_t RC_SHADER_COMPILER_VERSION = 1;
+
+struct NullFrameStats {
+    size_t draws          = 0;
+    size_t instancedDraws = 0;
+    size_t instances      = 0;
+    size_t triangles      = 0;
+    size_t commands       = 0;
+    size_t constantBytes  = 0;
+    // Binds that changed bound state, redundant ones are filtered like on the device
+    size_t binds          = 0;
+    // Calls that failed validation, a device would have drawn garbage or nothing for them
+    size_t errors         = 0;
+};
+struct NullResourceStats {
+    size_t buffers      = 0;
+    size_t bufferBytes  = 0;
+    size_t textures     = 0;
+    size_t textureBytes = 0;
+    size_t shaders      = 0;
+};
+
+// Takes the same calls as the Direct3D 11 handler, checks and counts them, and draws nothing.
+// Lets every bit of the renderer's CPU work run on machines without a GPU or a window.
+class DirectX11Handler {
+private:
+    // Only kept to validate draws against
+    struct BoundState {
+        ID3D11VertexShader*       vertexShader = nullptr;
+        ID3D11PixelShader*        pixelShader  = nullptr;
+        ID3D11InputLayout*        inputLayout  = nullptr;
+        ID3D11Buffer*             vertexBuffer = nullptr;
+        ID3D11Buffer*             indexBuffer  = nullptr;
+        UINT                      vertexStride = 0;
+        UINT                      indexBytes   = sizeof(uint32_t);
+        bool                      instanced    = false;
+        ID3D11ShaderResourceView* texture      = nullptr;
+        ID3D11SamplerState*       sampler      = nullptr;
+        bool                      alphaBlend   = false;
+    } bound;
+
+    // Constants are still copied, so the ring costs what it does on a device. Frames retire as soon as they are presented
+    ConstantRingAllocator      constantRing;
+    std::vector<unsigned char> constantRingData;
+    bool                       constantsMapped = false;
+    uint64_t                   frameIndex      = 0;
+
+    std::vector<InstanceData> instanceData;
+    UINT                      mappedInstances = 0;
+
+    std::vector<Vertex>                  dynamicVertices;
+    Microsoft::WRL::ComPtr<ID3D11Buffer> dynamicVertexBuffer;
+
+    Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState;
+
+    // Goes through the same disk cache as the device, the null compiler stands in for D3DCompile
+    ShaderCache shaderCache;
+
+    // Ring allocations of every SetConstants command played back this call, in playback order
+    std::vector<ConstantAllocation> commandConstants;
+
+    NullFrameStats    frame;
+    NullFrameStats    lastFrame;
+    NullResourceStats resources;
+
+    UINT viewportWidth  = 0;
+    UINT viewportHeight = 0;
+
+    Window* window;
+
+    void fail([[maybe_unused]] const char* message) {
+        RC_DBG_ERROR(message);
+        this->frame.errors++;
+    }
+
+    template <typename Ty>
+    static Microsoft::WRL::ComPtr<Ty> createObject() {
+        Microsoft::WRL::ComPtr<Ty> object;
+        object.Attach(new Ty());
+        return object;
+    }
+    template <typename Ty>
+    void bind(Ty& slot, const Ty value) {
+        if (slot == value) return;
+        slot = value;
+        this->frame.binds++;
+    }
+
+    Microsoft::WRL::ComPtr<ID3D11Buffer> createBuffer(const UINT byteWidth, const UINT bindFlags) {
+        auto buffer       = createObject<ID3D11Buffer>();
+        buffer->byteWidth = byteWidth;
+        buffer->bindFlags = bindFlags;
+
+        this->resources.buffers++;
+        this->resources.bufferBytes += byteWidth;
+        return buffer;
+    }
+
+    void bindConstantBuffers(const UINT startSlot, ID3D11Buffer* const* buffers, const size_t count) {
+        if (startSlot + count > 14) this->fail("Constant buffers bound past the last slot.");
+
+        for (size_t i = 0; i < count; i++) {
+            if (!buffers[i] || !(buffers[i]->bindFlags & D3D11_BIND_CONSTANT_BUFFER)) this->fail("Bound a buffer that is not a constant buffer.");
+        }
+        this->frame.binds += count;
+    }
+
+    bool validateDraw(const uint32_t indexCount, const uint32_t startIndex, const uint32_t instanceCount, const uint32_t startInstance) {
+        const BoundState& state = this->bound;
+
+        if (this->constantsMapped) {
+            this->fail("Draw while the constant ring is mapped.");
+            return false;
+        }
+        if (!state.vertexShader || !state.pixelShader || !state.inputLayout) {
+            this->fail("Draw without a complete pipeline bound.");
+            return false;
+        }
+        if (!state.vertexBuffer || !(state.vertexBuffer->bindFlags & D3D11_BIND_VERTEX_BUFFER) || state.vertexStride == 0) {
+            this->fail("Draw without a vertex buffer bound.");
+            return false;
+        }
+        if (!state.indexBuffer || !(state.indexBuffer->bindFlags & D3D11_BIND_INDEX_BUFFER)) {
+            this->fail("Draw without an index buffer bound.");
+            return false;
+        }
+        if (state.vertexStride != state.inputLayout->vertexStride) {
+            this->fail("Vertex buffer stride does not match the input layout, the mesh and shader vertex formats differ.");
+            return false;
+        }
+        if (indexCount % 3 != 0 || (static_cast<uint64_t>(startIndex) + indexCount) * state.indexBytes > state.indexBuffer->byteWidth) {
+            this->fail("Draw reads past the end of its index buffer.");
+            return false;
+        }
+        if (state.vertexShader->instanced != (instanceCount > 0)) {
+            this->fail("Instanced shaders have to be drawn instanced, and only they can be.");
+            return false;
+        }
+        if (instanceCount > 0 && (!state.instanced || static_cast<uint64_t>(startInstance) + instanceCount > this->mappedInstances)) {
+            this->fail("Instanced draw reads past this frame's instances.");
+            return false;
+        }
+        return true;
+    }
+    void draw(const uint32_t indexCount, const uint32_t startIndex, const uint32_t instanceCount, const uint32_t startInstance) {
+        if (!this->validateDraw(indexCount, startIndex, instanceCount, startInstance)) return;
+
+        const size_t copies = std::max<uint32_t>(instanceCount, 1);
+
+        this->frame.draws++;
+        this->frame.triangles += indexCount / 3 * copies;
+        if (instanceCount > 0) {
+            this->frame.instancedDraws++;
+            this->frame.instances += instanceCount;
+        }
+    }
+
+public:
+    DirectX::XMMATRIX modelMatrix;
+    DirectX::XMMATRIX viewMatrix;
+    DirectX::XMMATRIX projectionMatrix;
+
+    DirectX11Handler(Window* window, const DirectX11HandlerDescription& description) :
+        window(window)
+    {
+        this->constantRing.build(description.constantRingSize);
+        this->constantRingData.resize(this->constantRing.capacity());
+
+        this->setViewport(window->width, window->height);
+
+        this->shaderCache.build(description.shaderCacheDirectory, compileShader, RC_SHADER_COMPILER_VERSION);
+    }
+
+    // Checks the entry point exists and hands back the request as the "bytecode", so anything the key covers changes it
+    static bool compileShader(const ShaderCompileRequest& request, ShaderBytecode& out, std::string& error) {
+        if (request.source.find(request.entryPoint) == std::string_view::npos) {
+            error = "Shader source has no " + std::string(request.entryPoint) + ".";
+            return false;
+        }
+
+        std::string code(request.target);
+        for (const ShaderDefine& define : request.defines) code += "\n#define " + define.name + " " + define.value;
+        code += '\n';
+        code += request.source;
+
+        out.assign(code.begin(), code.end());
+        return true;
+    }
+
+    bool hasConstantRing() const noexcept { return true; }
+
+    void beginConstants() {
+        if (this->constantsMapped) this->fail("The constant ring is already mapped.");
+        this->constantsMapped = true;
+    }
+    ConstantAllocation writeConstants(const void* data, const size_t size) {
+        ConstantAllocation allocation = {};
+        if (!this->constantsMapped) return allocation;
+
+        const size_t offset = this->constantRing.allocate(size);
+        if (offset == RC_RING_FULL) {
+            this->fail("Constant ring is full, raise DirectX11HandlerDescription::constantRingSize.");
+            return allocation;
+        }
+
+        memcpy(this->constantRingData.data() + offset, data, size);
+        this->frame.constantBytes += size;
+
+        allocation.offset = offset;
+        allocation.size   = ConstantRingAllocator::align(size);
+        return allocation;
+    }
+    template <typename StructType>
+    ConstantAllocation writeConstants(const StructType& data) {
+        return this->writeConstants(&data, sizeof(StructType));
+    }
+    void endConstants() {
+        this->constantsMapped = false;
+    }
+
+    void VSBindConstants(const UINT, const ConstantAllocation& allocation) {
+        if (!allocation.valid()) return;
+        this->frame.binds++;
+    }
+    void PSBindConstants(const UINT, const ConstantAllocation& allocation) {
+        if (!allocation.valid()) return;
+        this->frame.binds++;
+    }
+
+    void bindShaderResource(Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> inShaderResourceView) {
+        this->bind(this->bound.texture, inShaderResourceView.Get());
+    }
+
+    void prepare() {}
+
+    // No compiler off Windows, the sources are only checked for their entry points
+    // Defines are seen by both stages, and are part of the shader cache key
+    Shader createShadersFromSource(const std::string& vertexShaderSource, const std::string& pixelShaderSource, std::span<const ShaderDefine> defines = {}) {
+        Shader shader = {};
+
+        ShaderBytecode vertexShaderCode;
+        ShaderBytecode pixelShaderCode;
+        std::string    error;
+
+        if (!this->shaderCache.get({ vertexShaderSource, "VSMain", "vs_5_0", defines }, vertexShaderCode, &error)) {
+            this->fail(("Failed to compile vertex shader. Error: " + error).c_str());
+            return shader;
+        }
+        if (!this->shaderCache.get({ pixelShaderSource, "PSMain", "ps_5_0", defines }, pixelShaderCode, &error)) {
+            this->fail(("Failed to compile pixel shader. Error: " + error).c_str());
+            return shader;
+        }
+
+        const std::string_view code(reinterpret_cast<const char*>(vertexShaderCode.data()), vertexShaderCode.size());
+        shader.instanced = code.find("INSTANCE_WORLD") != std::string_view::npos;
+        shader.format    = code.find("OCT_NORMAL") != std::string_view::npos ? VertexFormat::Compact : VertexFormat::Full;
+
+        shader.vertexShader            = createObject<ID3D11VertexShader>();
+        shader.vertexShader->instanced = shader.instanced;
+        shader.pixelShader             = createObject<ID3D11PixelShader>();
+        shader.inputLayout             = createObject<ID3D11InputLayout>();
+        shader.inputLayout->elementCount = shader.instanced ? 7 : 3;
+        shader.inputLayout->vertexStride = shader.format == VertexFormat::Compact ? sizeof(CompactVertex) : sizeof(Vertex);
+
+        this->resources.shaders++;
+        return shader;
+    }
+
+    template <typename VertexType>
+    void createVertexArrayBuffer(Microsoft::WRL::ComPtr<ID3D11Buffer>* outVertexArrayBuffer,
+                                 const std::vector<VertexType>&        inVertices)
+    {
+        if (!outVertexArrayBuffer || inVertices.empty()) {
+            this->fail("Invalid arguments passed to the create vertex array buffer function.");
+            return;
+        }
+
+        *outVertexArrayBuffer = this->createBuffer(static_cast<UINT>(inVertices.size() * sizeof(VertexType)), D3D11_BIND_VERTEX_BUFFER);
+    }
+    template <typename IndexType>
+    void createIndexArrayBuffer(Microsoft::WRL::ComPtr<ID3D11Buffer>* outIndexArrayBuffer,
+                                const std::vector<IndexType>&         inIndices)
+    {
+        static_assert(sizeof(IndexType) == 2 || sizeof(IndexType) == 4, "Index buffers hold 16 or 32 bit indices");
+
+        if (!outIndexArrayBuffer || inIndices.empty()) {
+            this->fail("Invalid arguments passed to the create index array buffer function.");
+            return;
+        }
+
+        *outIndexArrayBuffer = this->createBuffer(static_cast<UINT>(inIndices.size() * sizeof(IndexType)), D3D11_BIND_INDEX_BUFFER);
+    }
+
+    void clearScreen() {}
+
+    // Images are still decoded. A missing one counts as an error and becomes a 1x1 texture, so runs without assets go on
+    void createTexture2D(Microsoft::WRL::ComPtr<ID3D11Texture2D>*                      outTexture,
+                         std::unique_ptr<unsigned char[], decltype(&stbi_image_free)>* outImageData,
+                         const char*                                                   path,
+                         const DXGI_FORMAT                                             format)
+    {
+        if (!outTexture || !outImageData || !path) {
+            this->fail("Invalid arguments passed to the create texture 2D function.");
+            return;
+        }
+
+        int width    = 1;
+        int height   = 1;
+        int channels = 4;
+
+        std::unique_ptr<unsigned char[], decltype(&stbi_image_free)> imageData(
+            stbi_load(path, &width, &height, &channels, STBI_rgb_alpha), stbi_image_free
+        );
+        if (!imageData) {
+            this->fail("Failed to load image data.");
+            width  = 1;
+            height = 1;
+        }
+
+        auto texture                    = createObject<ID3D11Texture2D>();
+        texture->description.Width      = width;
+        texture->description.Height     = height;
+        texture->description.MipLevels  = 1;
+        texture->description.ArraySize  = 1;
+        texture->description.Format     = format;
+        texture->description.BindFlags  = D3D11_BIND_SHADER_RESOURCE;
+
+        this->resources.textures++;
+        this->resources.textureBytes += static_cast<size_t>(width) * height * 4;
+
+        *outTexture   = std::move(texture);
+        *outImageData = std::move(imageData);
+    }
+    void createShaderResourceView(Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>* outShaderResourceView,
+                                  Microsoft::WRL::ComPtr<ID3D11Resource>            inResource)
+    {
+        if (!outShaderResourceView || !inResource) {
+            this->fail("Invalid arguments passed to the create shader resource view function.");
+            return;
+        }
+
+        auto view      = createObject<ID3D11ShaderResourceView>();
+        view->resource = inResource;
+        *outShaderResourceView = std::move(view);
+    }
+
+    // One sampler description is ever asked for, so the cache is a single object
+    void createSamplerState(Microsoft::WRL::ComPtr<ID3D11SamplerState>* outSamplerState) {
+        if (!outSamplerState) {
+            this->fail("The OUT SAMPLER STATE passed to the create sampler state function is 0.");
+            return;
+        }
+
+        if (!this->samplerState) this->samplerState = createObject<ID3D11SamplerState>();
+        *outSamplerState = this->samplerState;
+    }
+    void setAlphaBlending(const bool enabled) {
+        this->bind(this->bound.alphaBlend, enabled);
+    }
+    void bindSamplerState(Microsoft::WRL::ComPtr<ID3D11SamplerState> inSamplerState) {
+        if (!inSamplerState) this->fail("Bound a null sampler state.");
+        this->bind(this->bound.sampler, inSamplerState.Get());
+    }
+
+    InstanceData* beginInstances(const UINT count) {
+        if (count == 0) return nullptr;
+
+        if (count > this->instanceData.size()) this->instanceData.resize(count);
+        this->mappedInstances = count;
+        return this->instanceData.data();
+    }
+    void endInstances() {}
+
+    Vertex* beginDynamicVertices(const UINT count) {
+        if (count == 0) return nullptr;
+
+        if (count > this->dynamicVertices.size()) {
+            UINT capacity = std::max(static_cast<UINT>(this->dynamicVertices.size()), 1024u);
+            while (capacity < count) capacity *= 2;
+
+            this->dynamicVertices.resize(capacity);
+            this->dynamicVertexBuffer = this->createBuffer(capacity * sizeof(Vertex), D3D11_BIND_VERTEX_BUFFER);
+        }
+        return this->dynamicVertices.data();
+    }
+    void endDynamicVertices() {}
+    ID3D11Buffer* getDynamicVertexBuffer() const noexcept { return this->dynamicVertexBuffer.Get(); }
+
+    // Constants go through the same ring as on a device, so the copies are part of what a headless run measures
+    void execute(const CommandList* lists, const size_t count) {
+        this->commandConstants.clear();
+
+        this->beginConstants();
+        for (size_t i = 0; i < count; i++) {
+            lists[i].forEach([this](const CommandHeader& header, const unsigned char* payload) {
+                if (header.type == CommandType::SetConstants) this->commandConstants.push_back(this->writeConstants(payload, header.size));
+            });
+        }
+        this->endConstants();
+
+        size_t constantIndex = 0;
+        for (size_t i = 0; i < count; i++) {
+            lists[i].forEach([this, &constantIndex](const CommandHeader& header, const unsigned char* payload) {
+                this->executeCommand(header, payload, constantIndex);
+            });
+        }
+    }
+    void execute(const std::vector<CommandList>& lists) {
+        this->execute(lists.data(), lists.size());
+    }
+
+    void executeCommand(const CommandHeader& header, const unsigned char* payload, size_t& constantIndex) {
+        this->frame.commands++;
+
+        switch (header.type) {
+        case CommandType::SetPipeline: {
+            const auto command = CommandList::read<SetPipelineCommand>(payload);
+            this->bind(this->bound.vertexShader, fromHandle<ID3D11VertexShader>(command.vertexShader));
+            this->bind(this->bound.pixelShader, fromHandle<ID3D11PixelShader>(command.pixelShader));
+            this->bind(this->bound.inputLayout, fromHandle<ID3D11InputLayout>(command.inputLayout));
+            break;
+        }
+        case CommandType::SetGeometry: {
+            const auto command = CommandList::read<SetGeometryCommand>(payload);
+            this->bind(this->bound.vertexBuffer, fromHandle<ID3D11Buffer>(command.vertexBuffer));
+            this->bind(this->bound.indexBuffer, fromHandle<ID3D11Buffer>(command.indexBuffer));
+            this->bind(this->bound.vertexStride, command.vertexStride);
+            this->bind(this->bound.instanced, command.instanced != 0);
+            this->bind(this->bound.indexBytes, command.indexBytes);
+            break;
+        }
+        case CommandType::SetTexture:
+            if (header.slot != 0) this->fail("Only texture slot 0 is tracked by the null backend.");
+            this->bind(this->bound.texture, fromHandle<ID3D11ShaderResourceView>(CommandList::read<SetTextureCommand>(payload).texture));
+            break;
+        case CommandType::SetConstants:
+            if (constantIndex >= this->commandConstants.size() || !this->commandConstants[constantIndex++].valid()) {
+                this->fail("Constants of a command did not fit in the ring.");
+                break;
+            }
+            if (header.stages & RC_COMMAND_VERTEX_STAGE) this->frame.binds++;
+            if (header.stages & RC_COMMAND_PIXEL_STAGE) this->frame.binds++;
+            break;
+        case CommandType::SetBuffers: {
+            ID3D11Buffer* buffers[14];
+            const size_t  bufferCount = std::min<size_t>(header.size / sizeof(GpuHandle), 14);
+            for (size_t i = 0; i < bufferCount; i++) {
+                buffers[i] = fromHandle<ID3D11Buffer>(CommandList::read<GpuHandle>(payload + i * sizeof(GpuHandle)));
+            }
+
+            if (header.stages & RC_COMMAND_VERTEX_STAGE) this->bindConstantBuffers(header.slot, buffers, bufferCount);
+            if (header.stages & RC_COMMAND_PIXEL_STAGE) this->bindConstantBuffers(header.slot, buffers, bufferCount);
+            break;
+        }
+        case CommandType::SetBlend:
+            this->setAlphaBlending(CommandList::read<SetBlendCommand>(payload).alphaBlending != 0);
+            break;
+        case CommandType::Draw: {
+            const auto command = CommandList::read<DrawCommand>(payload);
+            this->draw(command.indexCount, command.startIndex, command.instanceCount, command.startInstance);
+            break;
+        }
+        default:
+            this->fail("Unknown command in a command list.");
+            break;
+        }
+    }
+
+    template <typename Ty>
+    static Ty* fromHandle(const GpuHandle handle) { return static_cast<Ty*>(const_cast<void*>(handle)); }
+
+    // The null device is done with a frame the moment it is presented
+    void present() {
+        this->constantRing.endFrame(this->frameIndex);
+        this->constantRing.retire(this->frameIndex);
+        this->frameIndex++;
+
+        this->lastFrame       = this->frame;
+        this->frame           = {};
+        this->bound           = {};
+        this->mappedInstances = 0;
+    }
+
+    void setViewport(const uint32_t width, const uint32_t height) {
+        this->viewportWidth  = width;
+        this->viewportHeight = height;
+    }
+
+    template <typename StructType>
+    void createConstantBuffer(Microsoft::WRL::ComPtr<ID3D11Buffer>* outBuffer, const StructType& inData) {
+        this->createConstantBuffer(outBuffer, &inData, sizeof(StructType));
+    }
+    void createConstantBuffer(Microsoft::WRL::ComPtr<ID3D11Buffer>* outBuffer, const void* inData, const UINT inSize) {
+        if (!outBuffer || !inData || inSize == 0 || inSize % 16 != 0) {
+            this->fail("Constant buffers need data and a size that is a multiple of 16.");
+            return;
+        }
+        *outBuffer = this->createBuffer(inSize, D3D11_BIND_CONSTANT_BUFFER);
+    }
+    template <typename StructType>
+    void updateConstantBuffer(Microsoft::WRL::ComPtr<ID3D11Buffer> inBuffer, const StructType&) {
+        if (!inBuffer || sizeof(StructType) > inBuffer->byteWidth) {
+            this->fail("Constant buffer update does not fit the buffer.");
+            return;
+        }
+        this->frame.constantBytes += sizeof(StructType);
+    }
+
+    void VSBindBuffers(std::vector<Microsoft::WRL::ComPtr<ID3D11Buffer>>& buffers, const UINT startSlot = 0) {
+        if (buffers.empty()) return;
+        this->bindConstantBuffers(startSlot, buffers.data()->GetAddressOf(), buffers.size());
+    }
+    void PSBindBuffers(std::vector<Microsoft::WRL::ComPtr<ID3D11Buffer>>& buffers, const UINT startSlot = 0) {
+        if (buffers.empty()) return;
+        this->bindConstantBuffers(startSlot, buffers.data()->GetAddressOf(), buffers.size());
+    }
+
+    // Counters of the last finished frame
+    const NullFrameStats& getFrameStats() const noexcept { return this->lastFrame; }
+    const NullResourceStats& getResourceStats() const noexcept { return this->resources; }
+    ShaderCacheStats getShaderCacheStats() const { return this->shaderCache.getStats(); }
+    void invalidateState() { this->bound = {}; }
+};
\ No newline at end of file
@@ -0,0 +1,194 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <utility>
+
+// Stand-ins for the Direct3D 11 declarations the engine uses outside of its backend, used by headless builds.
+// Objects only carry what the null backend validates against, nothing here talks to a device.
+// Windows still provides its own Win32 types, elsewhere the few the engine names are declared here.
+#ifdef _WIN32
+#include <intrin.h>
+
+#include <windows.h>
+#else
+#include <immintrin.h>
+
+using BOOL    = int;
+using WORD    = uint16_t;
+using DWORD   = uint32_t;
+using UINT    = uint32_t;
+using ULONG   = uint32_t;
+using FLOAT   = float;
+using HRESULT = int32_t;
+
+#define TRUE  1
+#define FALSE 0
+
+#define S_OK          static_cast<HRESULT>(0)
+#define FAILED(hr)    (static_cast<HRESULT>(hr) < 0)
+#define SUCCEEDED(hr) (static_cast<HRESULT>(hr) >= 0)
+
+#define FOREGROUND_BLUE      0x0001
+#define FOREGROUND_GREEN     0x0002
+#define FOREGROUND_RED       0x0004
+#define FOREGROUND_INTENSITY 0x0008
+
+struct POINT {
+	long x;
+	long y;
+};
+#endif
+
+enum DXGI_FORMAT {
+	DXGI_FORMAT_UNKNOWN             = 0,
+	DXGI_FORMAT_R32G32B32A32_FLOAT  = 2,
+	DXGI_FORMAT_R32G32B32_FLOAT     = 6,
+	DXGI_FORMAT_R32G32_FLOAT        = 16,
+	DXGI_FORMAT_R8G8B8A8_UNORM      = 28,
+	DXGI_FORMAT_R8G8B8A8_UNORM_SRGB = 29,
+	DXGI_FORMAT_R32_UINT            = 42,
+	DXGI_FORMAT_D24_UNORM_S8_UINT   = 45,
+	DXGI_FORMAT_R16_UINT            = 57,
+};
+
+enum D3D11_BIND_FLAG {
+	D3D11_BIND_VERTEX_BUFFER   = 0x1,
+	D3D11_BIND_INDEX_BUFFER    = 0x2,
+	D3D11_BIND_CONSTANT_BUFFER = 0x4,
+	D3D11_BIND_SHADER_RESOURCE = 0x8,
+};
+
+enum D3D11_PRIMITIVE_TOPOLOGY {
+	D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED    = 0,
+	D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST = 4,
+};
+
+constexpr UINT D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT = 14;
+constexpr UINT D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT             = 16;
+
+struct D3D11_SUBRESOURCE_DATA {
+	const void* pSysMem;
+	UINT        SysMemPitch;
+	UINT        SysMemSlicePitch;
+};
+
+struct D3D11_TEXTURE2D_DESC {
+	UINT        Width;
+	UINT        Height;
+	UINT        MipLevels;
+	UINT        ArraySize;
+	DXGI_FORMAT Format;
+	UINT        BindFlags;
+};
+
+// Reference counted like COM objects, so ComPtr ownership behaves the same as on a device
+struct NullObject {
+	std::atomic<ULONG> references{ 1 };
+
+	virtual ~NullObject() = default;
+
+	ULONG AddRef() { return ++this->references; }
+	ULONG Release() {
+		const ULONG left = --this->references;
+		if (left == 0) delete this;
+		return left;
+	}
+};
+
+namespace Microsoft::WRL {
+	template <typename Ty>
+	class ComPtr {
+	private:
+		template <typename Other>
+		friend class ComPtr;
+
+		Ty* ptr = nullptr;
+
+		void addRef() const { if (this->ptr) this->ptr->AddRef(); }
+		void release() {
+			if (this->ptr) this->ptr->Release();
+			this->ptr = nullptr;
+		}
+
+	public:
+		ComPtr() = default;
+		ComPtr(std::nullptr_t) {}
+		ComPtr(Ty* ptr) : ptr(ptr) { this->addRef(); }
+		ComPtr(const ComPtr& other) : ptr(other.ptr) { this->addRef(); }
+		ComPtr(ComPtr&& other) noexcept : ptr(std::exchange(other.ptr, nullptr)) {}
+		template <typename Other>
+		ComPtr(const ComPtr<Other>& other) : ptr(other.ptr) { this->addRef(); }
+
+		~ComPtr() { this->release(); }
+
+		ComPtr& operator=(const ComPtr& other) {
+			if (this->ptr != other.ptr) {
+				other.addRef();
+				this->release();
+				this->ptr = other.ptr;
+			}
+			return *this;
+		}
+		ComPtr& operator=(ComPtr&& other) noexcept {
+			if (this != &other) {
+				this->release();
+				this->ptr = std::exchange(other.ptr, nullptr);
+			}
+			return *this;
+		}
+		ComPtr& operator=(std::nullptr_t) {
+			this->release();
+			return *this;
+		}
+
+		// Takes over a reference the caller already owns
+		void Attach(Ty* ptr) {
+			this->release();
+			this->ptr = ptr;
+		}
+		void Reset() { this->release(); }
+
+		Ty* Get() const noexcept { return this->ptr; }
+		Ty* const* GetAddressOf() const noexcept { return &this->ptr; }
+		Ty** GetAddressOf() noexcept { return &this->ptr; }
+		Ty** ReleaseAndGetAddressOf() {
+			this->release();
+			return &this->ptr;
+		}
+
+		Ty* operator->() const noexcept { return this->ptr; }
+		explicit operator bool() const noexcept { return this->ptr != nullptr; }
+		bool operator==(std::nullptr_t) const noexcept { return this->ptr == nullptr; }
+	};
+}
+
+struct ID3D11DeviceChild : NullObject {};
+struct ID3D11Resource : ID3D11DeviceChild {};
+
+struct ID3D11Buffer : ID3D11Resource {
+	UINT byteWidth = 0;
+	UINT bindFlags = 0;
+};
+struct ID3D11Texture2D : ID3D11Resource {
+	D3D11_TEXTURE2D_DESC description = {};
+
+	void GetDesc(D3D11_TEXTURE2D_DESC* out) const { *out = this->description; }
+};
+struct ID3D11ShaderResourceView : ID3D11DeviceChild {
+	Microsoft::WRL::ComPtr<ID3D11Resource> resource;
+};
+
+struct ID3D11VertexShader : ID3D11DeviceChild {
+	bool instanced = false;
+};
+struct ID3D11PixelShader : ID3D11DeviceChild {};
+struct ID3D11InputLayout : ID3D11DeviceChild {
+	UINT elementCount = 0;
+	UINT vertexStride = 0;
+};
+struct ID3D11SamplerState : ID3D11DeviceChild {};
+struct ID3D11RasterizerState : ID3D11DeviceChild {};
+struct ID3D11DepthStencilState : ID3D11DeviceChild {};
+struct ID3D11BlendState : ID3D11DeviceChild {};
+struct ID3D11ClassInstance : ID3D11DeviceChild {};
\ No newline at end of file
@@ -0,0 +1,88 @@
+#pragma once
+#include "framework.h"
+
+#include "DirectX11Types.h"
+#include "Frustum.h"
+#include "ThreadPool.h"
+
+constexpr uint32_t RC_OCCLUSION_WIDTH  = 256;
+constexpr uint32_t RC_OCCLUSION_HEIGHT = 128;
+
+// Occluder triangle after projection, in depth buffer pixels and D3D 0..1 depth
+struct OccluderTriangle {
+	float x[3];
+	float y[3];
+	float z[3];
+
+	int rowMin;
+	int rowMax;
+};
+
+struct OcclusionStats {
+	size_t occluderTriangles = 0;
+	// Occluders without a CPU copy, see ResidencyPolicy::KeepForQueries
+	size_t skippedOccluders  = 0;
+	size_t tested            = 0;
+	size_t occluded          = 0;
+
+	float rasterMilliseconds = 0.0f;
+};
+
+// Rasterizes occluders into a small CPU depth buffer and rejects objects whose screen bounds lie behind it.
+// A frame is begin, addOccluder for every occluder, rasterize, then any number of visible or cull calls.
+class OcclusionCuller {
+private:
+	ThreadPool* scheduler     = nullptr;
+	size_t      threadsAmount = 1;
+
+	uint32_t width  = RC_OCCLUSION_WIDTH;
+	uint32_t height = RC_OCCLUSION_HEIGHT;
+
+	DirectX::XMFLOAT4X4           viewProjection;
+	std::vector<OccluderTriangle> triangles;
+
+	// Level 0 is the depth buffer itself, every level above keeps the farthest depth of 2x2 texels below
+	std::vector<std::vector<float>> pyramid;
+	std::vector<DirectX::XMUINT2>   levelSizes;
+
+	std::vector<std::vector<uint32_t>> chunkVisible;
+	std::vector<size_t>                chunkCounts;
+
+	OcclusionStats stats;
+
+	template <typename Fn>
+	void run(const size_t chunks, Fn& work) {
+		if (chunks == 1) {
+			work(0);
+			return;
+		}
+
+		ThreadGroup* group = this->scheduler->scheduleWorkIndexed(chunks, work);
+		group->join();
+		delete group;
+	}
+
+	void rasterizeBand(const int rowBegin, const int rowEnd);
+	void buildPyramid();
+
+public:
+	// Width is rounded up to a multiple of four, rows are filled four pixels at a time
+	void build(ThreadPool* scheduler, const size_t threadsAmount, const uint32_t width = RC_OCCLUSION_WIDTH, const uint32_t height = RC_OCCLUSION_HEIGHT);
+
+	void begin(const DirectX::XMMATRIX& viewProjection);
+	// Triangles with a vertex behind the near plane are dropped, which can only hide less
+	void addOccluder(const Mesh& mesh, const DirectX::XMMATRIX& world);
+	// Fills the depth buffer in horizontal bands on the pool and builds the depth pyramid
+	void rasterize();
+
+	// False when the box is certainly behind the occluders
+	bool visible(const DirectX::XMFLOAT3& center, const DirectX::XMFLOAT3& extents) const;
+	// Keeps the candidates whose box in bounds is not occluded, in order, and returns how many were kept
+	size_t cull(const CullBounds& bounds, const uint32_t* candidates, const size_t count, uint32_t* out);
+
+	const std::vector<float>& getDepth() const noexcept { return this->pyramid[0]; }
+	uint32_t getWidth() const noexcept { return this->width; }
+	uint32_t getHeight() const noexcept { return this->height; }
+	bool hasOccluders() const noexcept { return !this->triangles.empty(); }
+	const OcclusionStats& getStats() const noexcept { return this->stats; }
+};
\ No newline at end of file
@@ -1,7 +1,120 @@
 #pragma once
 #include "framework.h"
 
+#include "FlatHashMap.h"
+#include "Hash.h"
 
-class Pipeline {
+struct PipelineCacheStats {
+	uint64_t hits   = 0;
+	uint64_t misses = 0;
+};
 
+// Device state objects keyed by a hash of their descriptor, identical descriptors share one object.
+// The cache owns the states, so the returned pointers stay valid until clear() or destruction.
+// It is not synchronized and is meant to be used from the thread that owns the immediate context.
+class PipelineStateCache {
+private:
+	template <typename DescType, typename StateType>
+	struct StateEntry {
+		DescType                          description;
+		Microsoft::WRL::ComPtr<StateType> state;
+	};
+
+	template <typename DescType, typename StateType>
+	using StateMap = FlatHashMap<uint64_t, StateEntry<DescType, StateType>>;
+
+	// D3D11_INPUT_ELEMENT_DESC with its own copy of the semantic name
+	struct InputElement {
+		std::string                semanticName;
+		UINT                       semanticIndex;
+		DXGI_FORMAT                format;
+		UINT                       inputSlot;
+		UINT                       alignedByteOffset;
+		D3D11_INPUT_CLASSIFICATION inputSlotClass;
+		UINT                       instanceDataStepRate;
+	};
+	struct InputLayoutEntry {
+		std::vector<uint8_t>                      signature;
+		std::vector<InputElement>                 elements;
+		Microsoft::WRL::ComPtr<ID3D11InputLayout> inputLayout;
+	};
+
+	Microsoft::WRL::ComPtr<ID3D11Device> device;
+
+	StateMap<D3D11_RASTERIZER_DESC, ID3D11RasterizerState>     rasterizerStates;
+	StateMap<D3D11_SAMPLER_DESC, ID3D11SamplerState>           samplerStates;
+	StateMap<D3D11_DEPTH_STENCIL_DESC, ID3D11DepthStencilState> depthStencilStates;
+	StateMap<D3D11_BLEND_DESC, ID3D11BlendState>               blendStates;
+
+	// Layouts depend only on the elements and the vertex shader input signature, not on the whole shader
+	FlatHashMap<uint64_t, InputLayoutEntry> inputLayouts;
+
+	// States replaced after a hash collision, kept alive because callers may still hold their raw pointers
+	std::vector<Microsoft::WRL::ComPtr<ID3D11DeviceChild>> retired;
+
+	PipelineCacheStats stats;
+
+	// Descriptors are copied field by field into zeroed storage so padding never reaches the hash
+	template <typename DescType>
+	static void normalize(const DescType& description, DescType* out) { *out = description; }
+	static void normalize(const D3D11_DEPTH_STENCIL_DESC& description, D3D11_DEPTH_STENCIL_DESC* out);
+	static void normalize(const D3D11_BLEND_DESC& description, D3D11_BLEND_DESC* out);
+
+	static bool matches(const InputLayoutEntry& entry, const uint8_t* signature, const size_t signatureSize,
+						const D3D11_INPUT_ELEMENT_DESC* elements, const UINT elementCount);
+
+	template <typename DescType, typename StateType, typename CreateFn>
+	StateType* findOrCreate(StateMap<DescType, StateType>& states, const DescType& description, CreateFn&& create) {
+		DescType normalized;
+		memset(&normalized, 0, sizeof(DescType));
+		normalize(description, &normalized);
+
+		const uint64_t key = fnv1a64(&normalized, sizeof(DescType));
+
+		auto it = states.find(key);
+		if (it != states.end()) {
+			if (memcmp(&it->second.description, &normalized, sizeof(DescType)) == 0) {
+				this->stats.hits++;
+				return it->second.state.Get();
+			}
+			RC_DBG_WARN("Pipeline state hash collision, replacing the cached state.");
+			this->retired.push_back(it->second.state);
+		}
+
+		this->stats.misses++;
+
+		Microsoft::WRL::ComPtr<StateType> state;
+		HRESULT hr = create(&normalized, state.GetAddressOf());
+		if (FAILED(hr)) {
+			RC_DBG_ERROR("Failed to create pipeline state.");
+			return nullptr;
+		}
+
+		auto& entry = states[key];
+		memcpy(&entry.description, &normalized, sizeof(DescType));
+		entry.state = state;
+		return entry.state.Get();
+	}
+
+public:
+	PipelineStateCache() = default;
+
+	void build(Microsoft::WRL::ComPtr<ID3D11Device> device);
+
+	ID3D11RasterizerState*   getRasterizerState(const D3D11_RASTERIZER_DESC& description);
+	ID3D11SamplerState*      getSamplerState(const D3D11_SAMPLER_DESC& description);
+	ID3D11DepthStencilState* getDepthStencilState(const D3D11_DEPTH_STENCIL_DESC& description);
+	ID3D11BlendState*        getBlendState(const D3D11_BLEND_DESC& description);
+	ID3D11InputLayout*       getInputLayout(const D3D11_INPUT_ELEMENT_DESC* elements, const UINT elementCount,
+											const void* vertexShaderBytecode, const size_t bytecodeSize);
+
+	void clear();
+
+	const PipelineCacheStats& getStats() const noexcept { return this->stats; }
+	void resetStats() noexcept { this->stats = {}; }
+
+	size_t size() const noexcept {
+		return this->rasterizerStates.size() + this->samplerStates.size() + this->depthStencilStates.size() +
+			   this->blendStates.size() + this->inputLayouts.size();
+	}
 };
\ No newline at end of file
@@ -0,0 +1,42 @@
+#pragma once
+#include "framework.h"
+
+#include "Renderer.h"
+
+using PrefabID = uint32_t;
+
+constexpr PrefabID RC_INVALID_PREFAB = UINT32_MAX;
+
+struct PrefabDescription {
+	const char*			  modelPath          = nullptr;
+	const char*			  vertexShaderSource = nullptr;
+	const char*			  pixelShaderSource  = nullptr;
+	const char*			  texturePath        = nullptr;
+	std::vector<Vertex>   vertices;
+	std::vector<uint32_t> indices;
+
+	Transform transform;
+};
+
+// Prefabs load their resources once, every instance shares them until it overrides one
+class PrefabManager {
+private:
+	Renderer* renderer;
+
+	std::vector<Model>                        prefabs;
+	FlatHashMap<std::string, PrefabID, StringHash, StringEqual> names;
+
+public:
+	void build(Renderer* renderer);
+
+	PrefabID registerPrefab(const std::string& name, const PrefabDescription& description);
+	PrefabID find(const std::string_view name) const;
+
+	const Model* getPrefab(const PrefabID id) const;
+
+	Model instantiate(const PrefabID id) const;
+	Model instantiate(const PrefabID id, const Transform& transform) const;
+
+	void spawn(const PrefabID id, const Transform& transform);
+	void spawn(const PrefabID id, const std::vector<Transform>& transforms);
+};
\ No newline at end of file
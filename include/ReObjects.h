@@ -3,10 +3,133 @@
 
 #include "FlexibleVector.h"
 #include "ThreadPool.h"
+#include "Hash.h"
+#include "FlatHashMap.h"
 
 using ObjectKey = size_t;
 using HashKey   = std::type_index;
 
+constexpr uint32_t RC_INVALID_ENTITY = UINT32_MAX;
+
+// Stays valid while the entity moves inside its column, the slot table tracks where it is
+struct EntityHandle {
+    uint32_t slot       = RC_INVALID_ENTITY;
+    uint32_t generation = 0;
+
+    bool valid() const noexcept { return this->slot != RC_INVALID_ENTITY; }
+};
+
+// Indirection table between handles and dense column indices
+class EntitySlots {
+private:
+    std::vector<uint32_t> slotToDense;
+    std::vector<uint32_t> generations;
+    std::vector<uint32_t> denseToSlot;
+    std::vector<uint32_t> freeSlots;
+
+public:
+    EntityHandle create(const uint32_t dense) {
+        uint32_t slot;
+        if (!this->freeSlots.empty()) {
+            slot = this->freeSlots.back();
+            this->freeSlots.pop_back();
+        }
+        else {
+            slot = static_cast<uint32_t>(this->slotToDense.size());
+            this->slotToDense.push_back(RC_INVALID_ENTITY);
+            this->generations.push_back(0);
+        }
+
+        this->slotToDense[slot] = dense;
+        if (this->denseToSlot.size() <= dense) this->denseToSlot.resize(dense + 1);
+        this->denseToSlot[dense] = slot;
+
+        return { slot, this->generations[slot] };
+    }
+
+    // Mirrors FlexibleVector::erase, everything after dense shifts down by one
+    void erase(const uint32_t dense) {
+        if (dense >= this->denseToSlot.size()) return;
+
+        const uint32_t slot = this->denseToSlot[dense];
+        this->slotToDense[slot] = RC_INVALID_ENTITY;
+        this->generations[slot]++;
+        this->freeSlots.push_back(slot);
+
+        this->denseToSlot.erase(this->denseToSlot.begin() + dense);
+        for (size_t i = dense; i < this->denseToSlot.size(); i++) {
+            this->slotToDense[this->denseToSlot[i]] = static_cast<uint32_t>(i);
+        }
+    }
+    void swap(const uint32_t a, const uint32_t b) {
+        std::swap(this->denseToSlot[a], this->denseToSlot[b]);
+        this->slotToDense[this->denseToSlot[a]] = a;
+        this->slotToDense[this->denseToSlot[b]] = b;
+    }
+
+    void reset(const uint32_t count) {
+        this->slotToDense.resize(count);
+        this->generations.assign(count, 0);
+        this->denseToSlot.resize(count);
+        this->freeSlots.clear();
+
+        for (uint32_t i = 0; i < count; i++) {
+            this->slotToDense[i] = i;
+            this->denseToSlot[i] = i;
+        }
+    }
+    // Tables read back from a file, every dense entry has to name its own slot inside the generations array
+    static bool validate(const uint32_t* inDenseToSlot, const uint32_t denseCount, const uint32_t slotCount) {
+        if (denseCount > slotCount) return false;
+
+        std::vector<bool> used(slotCount, false);
+        for (uint32_t i = 0; i < denseCount; i++) {
+            const uint32_t slot = inDenseToSlot[i];
+            if (slot >= slotCount || used[slot]) return false;
+            used[slot] = true;
+        }
+        return true;
+    }
+    bool restore(const uint32_t* inDenseToSlot, const uint32_t denseCount, const uint32_t* inGenerations, const uint32_t slotCount) {
+        if (!EntitySlots::validate(inDenseToSlot, denseCount, slotCount)) return false;
+
+        this->denseToSlot.assign(inDenseToSlot, inDenseToSlot + denseCount);
+        this->generations.assign(inGenerations, inGenerations + slotCount);
+        this->slotToDense.assign(slotCount, RC_INVALID_ENTITY);
+        this->freeSlots.clear();
+
+        for (uint32_t i = 0; i < denseCount; i++) this->slotToDense[this->denseToSlot[i]] = i;
+        for (uint32_t i = slotCount; i > 0; i--) {
+            if (this->slotToDense[i - 1] == RC_INVALID_ENTITY) this->freeSlots.push_back(i - 1);
+        }
+        return true;
+    }
+
+    uint32_t resolve(const EntityHandle handle) const noexcept {
+        if (handle.slot >= this->slotToDense.size() || this->generations[handle.slot] != handle.generation) return RC_INVALID_ENTITY;
+        return this->slotToDense[handle.slot];
+    }
+    EntityHandle handleOf(const uint32_t dense) const noexcept {
+        if (dense >= this->denseToSlot.size()) return {};
+
+        const uint32_t slot = this->denseToSlot[dense];
+        return { slot, this->generations[slot] };
+    }
+
+    const std::vector<uint32_t>& getDenseToSlot() const noexcept { return this->denseToSlot; }
+    const std::vector<uint32_t>& getGenerations() const noexcept { return this->generations; }
+};
+
+// Stable description of a component column, needed to persist it across runs
+struct ComponentInfo {
+    std::string name;
+    uint64_t    nameHash;
+    size_t      itemSize;
+
+    void (*build)(FlexibleVector<>& column);
+    void (*assign)(FlexibleVector<>& column, const void* elements, const size_t count);
+};
+
 template <typename Ty>
 class EntitiesQuery {
 private:
@@ -75,10 +198,32 @@ public:
 
 class ObjectsManager {
 private:
-    std::unordered_map<HashKey, FlexibleVector<>> storage;
+    // Columns move when a new component type is added, queries must not outlive that
+    FlatHashMap<HashKey, FlexibleVector<>> storage;
+    FlatHashMap<HashKey, EntitySlots>      slots;
+    FlatHashMap<HashKey, ComponentInfo>    components;
+
+    // Bumped on every create/destroy so long running passes can notice the column changed
+    FlatHashMap<HashKey, uint64_t> versions;
 
     ThreadPool threads;
 
+    template <typename Ty, typename Arg>
+    EntityHandle createEntityImpl(Arg&& entity) {
+        auto it = this->storage.find(typeid(Ty));
+        if (it == this->storage.end()) {
+            FlexibleVector group;
+            group.build<Ty>();
+
+            it = this->storage.insert({ typeid(Ty), std::move(group) }).first;
+        }
+
+        it->second.push(std::forward<Arg>(entity));
+        this->versions[typeid(Ty)]++;
+
+        return this->slots[typeid(Ty)].create(static_cast<uint32_t>(it->second.size() - 1));
+    }
+
 public:
     void build(const size_t initialSize, const size_t threadsAmount) {
         this->storage.reserve(initialSize);
@@ -87,32 +232,12 @@ public:
     }
 
     template <typename Ty, typename = std::enable_if_t<std::is_copy_constructible_v<Ty>>>
-    void createEntity(const Ty& entity) {
-        auto it = this->storage.find(typeid(Ty));
-        if (it != this->storage.end()) {
-            it->second.push(entity);
-            return;
-        }
-
-        FlexibleVector group;
-        group.build<Ty>();
-        group.push(entity);
-
-        this->storage.insert({ typeid(Ty), std::move(group) });
+    EntityHandle createEntity(const Ty& entity) {
+        return this->createEntityImpl<Ty>(entity);
     }
     template <typename Ty>
-    void createEntity(Ty&& entity) {
-        auto it = this->storage.find(typeid(Ty));
-        if (it != this->storage.end()) {
-            it->second.push(std::move(entity));
-            return;
-        }
-
-        FlexibleVector group;
-        group.build<Ty>();
-        group.push(std::move(entity));
-
-        this->storage.insert({ typeid(Ty), std::move(group) });
+    EntityHandle createEntity(Ty&& entity) {
+        return this->createEntityImpl<std::remove_reference_t<Ty>>(std::move(entity));
     }
 
 	template <typename Ty>
@@ -120,16 +245,129 @@ public:
 		auto it = this->storage.find(typeid(Ty));
 		if (it == this->storage.end()) return;
 
-		it->second.erase<Ty>(entity);
+		const size_t idx = entity - it->second.begin<Ty>();
+		if (idx >= it->second.size()) return;
+
+		this->destroyEntity<Ty>(idx);
 	}
 	template <typename Ty>
 	void destroyEntity(const size_t idx) {
 		auto it = this->storage.find(typeid(Ty));
-		if (it == this->storage.end()) return;
+		if (it == this->storage.end() || idx >= it->second.size()) return;
 
 		it->second.erase<Ty>(it->second.begin<Ty>() + idx);
+		this->slots[typeid(Ty)].erase(static_cast<uint32_t>(idx));
+		this->versions[typeid(Ty)]++;
+	}
+	template <typename Ty>
+	void destroyEntity(const EntityHandle handle) {
+		const uint32_t idx = this->indexOf<Ty>(handle);
+		if (idx == RC_INVALID_ENTITY) return;
+
+		this->destroyEntity<Ty>(static_cast<size_t>(idx));
 	}
 
+    template <typename Ty>
+    uint32_t indexOf(const EntityHandle handle) const {
+        auto it = this->slots.find(typeid(Ty));
+        if (it == this->slots.end()) return RC_INVALID_ENTITY;
+
+        return it->second.resolve(handle);
+    }
+    template <typename Ty>
+    EntityHandle handleOf(const size_t idx) const {
+        auto it = this->slots.find(typeid(Ty));
+        if (it == this->slots.end()) return {};
+
+        return it->second.handleOf(static_cast<uint32_t>(idx));
+    }
+    template <typename Ty>
+    Ty* resolve(const EntityHandle handle) {
+        const uint32_t idx = this->indexOf<Ty>(handle);
+        if (idx == RC_INVALID_ENTITY) return nullptr;
+
+        return this->storage.find(typeid(Ty))->second.at<Ty>(idx);
+    }
+
+    // Exchanges two entities inside their column, handles follow them. The values move, so a column of pointers
+    // only reorders the pointers
+    template <typename Ty>
+    void swapEntities(const size_t a, const size_t b) {
+        auto it = this->storage.find(typeid(Ty));
+        if (it == this->storage.end() || a == b) return;
+
+        std::swap(*it->second.at<Ty>(a), *it->second.at<Ty>(b));
+        this->slots[typeid(Ty)].swap(static_cast<uint32_t>(a), static_cast<uint32_t>(b));
+    }
+
+    template <typename Ty>
+    uint64_t getVersion() const {
+        auto it = this->versions.find(typeid(Ty));
+        if (it == this->versions.end()) return 0;
+
+        return it->second;
+    }
+
+    // Relocatable components can be saved and restored in bulk by WorldSnapshot
+    template <typename Ty>
+    void registerComponent(const char* name) {
+        static_assert(std::is_trivially_copyable_v<Ty>, "Only trivially copyable components can be registered");
+
+        ComponentInfo info = {};
+        info.name     = name;
+        info.nameHash = fnv1a64(std::string_view(name));
+        info.itemSize = sizeof(Ty);
+        info.build    = [](FlexibleVector<>& column) { column.build<Ty>(); };
+        info.assign   = [](FlexibleVector<>& column, const void* elements, const size_t count) {
+            column.assign<Ty>(static_cast<const Ty*>(elements), count);
+        };
+
+        this->components.insert_or_assign(typeid(Ty), std::move(info));
+    }
+
+    const FlatHashMap<HashKey, ComponentInfo>& getComponents() const noexcept { return this->components; }
+
+    FlexibleVector<>* getColumn(const HashKey key) {
+        auto it = this->storage.find(key);
+        if (it == this->storage.end()) return nullptr;
+        return &it->second;
+    }
+    EntitySlots* getSlots(const HashKey key) {
+        auto it = this->slots.find(key);
+        if (it == this->slots.end()) return nullptr;
+        return &it->second;
+    }
+
+    // Bulk replaces a registered column, the slot table is restored from the given arrays or rebuilt as identity.
+    // Nothing changes when the key is not registered or the slot arrays are inconsistent
+    bool restoreColumn(const HashKey key, const void* elements, const size_t count,
+                       const uint32_t* denseToSlot = nullptr, const uint32_t* generations = nullptr, const uint32_t slotCount = 0)
+    {
+        auto info = this->components.find(key);
+        if (info == this->components.end()) return false;
+
+        const bool withSlots = denseToSlot && generations;
+        if (withSlots && (count > UINT32_MAX || !EntitySlots::validate(denseToSlot, static_cast<uint32_t>(count), slotCount))) return false;
+
+        auto it = this->storage.find(key);
+        if (it == this->storage.end()) {
+            FlexibleVector group;
+            info->second.build(group);
+
+            it = this->storage.insert({ key, std::move(group) }).first;
+        }
+
+        info->second.assign(it->second, elements, count);
+
+        if (withSlots) this->slots[key].restore(denseToSlot, static_cast<uint32_t>(count), generations, slotCount);
+        else this->slots[key].reset(static_cast<uint32_t>(count));
+        this->versions[key]++;
+
+        return true;
+    }
+
+    ThreadPool* getThreads() noexcept { return &this->threads; }
+
     template <typename Ty>
     EntitiesQuery<Ty> get() {
         EntitiesQuery<Ty> query;
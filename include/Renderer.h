@@ -5,13 +5,25 @@
 
 #include "DirectX11Handler.h"
 
-#include "Math.h"
+#include <cmath>
 
 #include "Camera.h"
 #include "GlobalLight.h"
 
 #include "GuiManager.h"
 #include "ReObjects.h"
+#include "Locality.h"
+#include "DrawSort.h"
+#include "Instancing.h"
+#include "Frustum.h"
+#include "TransformKernel.h"
+#include "SceneBVH.h"
+#include "Occlusion.h"
+#include "MeshSimplifier.h"
+#include "ResourceManager.h"
+#include "ShaderVariants.h"
+#include "Billboards.h"
+#include "VertexFormat.h"
 
 #include "assimp/Importer.hpp"
 #include "assimp/scene.h"
@@ -19,6 +31,9 @@
 
 class EngineCore;
 
+// Batches recorded by one worker, fewer than this and the frame is recorded on the calling thread
+constexpr size_t RC_RECORD_CHUNK_SIZE = 128;
+
 enum class BufferUsage {
 	
 };
@@ -27,10 +42,22 @@ struct SceneDescription {
 	bool globalLightsEnabled = true;
 };
 struct Scene {
-	Buffer      globalLightBuffer;
 	GlobalLight globalLightData;
 };
 
+enum class LocalityKey {
+	RenderState,
+	Position,
+};
+
+enum class CullingMode {
+	None,
+	// Every model's bounds are tested, several at a time with SIMD
+	Linear,
+	// The scene BVH is walked, whole subtrees are kept or dropped by one test
+	Hierarchy,
+};
+
 enum class ModelTemplate {
 	Billboard,
 };
@@ -39,8 +66,19 @@ struct BillboardDescription {
 	const char*			  texturePath;
 	std::vector<Vertex>   vertices;
 	std::vector<uint32_t> indices;
+
+	// Drops texels under half alpha instead of blending them
+	bool alphaCutout = false;
+	// Turns around the world up axis only, instead of facing the camera fully
+	bool axisLocked  = false;
 };
 
+// Shaders see the renderer constants at fixed slots on both stages:
+//   b0 ObjectConstants { matrix model; float4 scale; }
+//   b1 FrameConstants  { matrix view; matrix projection; matrix viewProjection; float4 cameraPosition; float4 cameraRotation; GlobalLight light; }
+// Buffers added with createBuffer follow from b2, in the order they were added per stage.
+// A vertex shader that declares float4x4 INSTANCE_WORLD is drawn instanced: models sharing its mesh and texture
+// and having no buffers of their own are merged into one call, and the world matrix comes from that input instead of b0.
 class Renderer {
 public:
 	friend class EngineCore;
@@ -54,9 +92,51 @@ private:
 
 	ObjectsManager* objectsManager;
 
-	Assimp::Importer importer;
+	ResourceManager resources;
+
+	// Built the first time a billboard template is asked for
+	ShaderVariantSet billboardShaders;
 
 	ThreadPool scheduler;
+	size_t     threadsAmount = 1;
+
+	ReorderPass<std::unique_ptr<Model>> localityPass;
+
+	FlatHashMap<StringID, EntityHandle> modelsByName;
+
+	DrawSorter            drawSorter;
+	SortIdTable           shaderIds;
+	SortIdTable           textureIds;
+	SortIdTable           meshIds;
+	std::vector<uint64_t> drawKeys;
+	std::vector<uint32_t> drawOrder;
+	DrawSortStats         drawSortStats;
+
+	TransformKernel                  transformKernel;
+	TransformStreams                 transformStreams;
+	std::vector<DirectX::XMFLOAT4X4> worldTransposed;
+
+	FrustumCuller         frustumCuller;
+	CullBounds            cullBounds;
+	std::vector<uint32_t> allModels;
+	std::vector<uint32_t> hierarchyVisible;
+	SceneBVH              sceneBVH;
+
+	OcclusionCuller       occlusionCuller;
+	std::vector<uint32_t> occluderModels;
+	std::vector<uint32_t> unoccluded;
+	size_t                visibleModels = 0;
+
+	InstanceBatcher               instanceBatcher;
+	std::vector<InstanceGroupKey> drawGroups;
+	std::vector<InstanceData>     drawInstances;
+
+	// The first list holds the frame constants, the last the billboards, the rest one chunk of batches each
+	std::vector<CommandList> commandLists;
+
+	BillboardBatcher billboardBatcher;
+
+	void recordBatches(CommandList& list, FlexibleVector<>* column, const DrawBatch* batches, const size_t count, const bool instancesReady);
 
 	DirectX11Handler* getDirectX11Handler() { return this->handler; }
 
@@ -66,17 +146,55 @@ public:
 
 	Camera* camera;
 
+	// Swaps spent per frame on reordering the model column
+	size_t localityBudget = 256;
+
+	// How models outside the camera frustum are skipped
+	CullingMode cullingMode = CullingMode::Hierarchy;
+	// Tests what passed the frustum against the depth of models that have an occluder mesh
+	bool occlusionCulling = true;
+
+	// Meshes get a chain of simplified levels when created, the coarsest one whose error stays under
+	// lodErrorPixels on screen is drawn. lodHysteresis widens that limit both ways before switching levels
+	bool  generateLods   = true;
+	float lodErrorPixels = 1.0f;
+	float lodHysteresis  = 0.25f;
+
+	// What loaded resources keep in RAM after upload when the load does not say. DropAfterUpload saves memory, but
+	// occluder meshes loaded that way are skipped by occlusion culling
+	ResidencyPolicy meshResidency    = ResidencyPolicy::KeepForQueries;
+	ResidencyPolicy textureResidency = ResidencyPolicy::KeepForQueries;
+
 	~Renderer();
 
 	void build(ObjectsManager* objectsManager, Window* window, GuiManager* guiManager, const size_t threadsAmount);
 
-	Mesh createMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
-	Mesh createMesh(const char* path);
+	// Compact meshes only draw with shaders of the same format, createModel picks the format from the shader.
+	// Meshes of at most RC_MAX_SHORT_INDEX_VERTICES vertices get 16 bit indices in either format
+	Mesh createMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const VertexFormat format = VertexFormat::Full);
+	Mesh createMesh(const char* path, const VertexFormat format = VertexFormat::Full);
 	
 	Shader createShaderFromSource(const char* vertexShaderSource, const char* pixelShaderSource);
 
 	Texture createTexture(const char* path);
 
+	// Declares the keywords of a pair of sources, variants are compiled from it when first asked for
+	void createShaderVariants(ShaderVariantSet* out, const char* vertexShaderSource, const char* pixelShaderSource, std::initializer_list<const char*> keywords);
+
+	// Cached versions of the above, the same path or contents return the same shared resource.
+	// Safe to call from several threads, a resource being loaded elsewhere is waited for instead of loaded twice.
+	// The residency is applied once uploaded, loads of one resource under two policies are cached apart
+	std::shared_ptr<Mesh>    loadMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const ResidencyPolicy residency, const VertexFormat format = VertexFormat::Full);
+	std::shared_ptr<Mesh>    loadMesh(const char* path, const ResidencyPolicy residency, const VertexFormat format = VertexFormat::Full);
+	std::shared_ptr<Shader>  loadShaderFromSource(const char* vertexShaderSource, const char* pixelShaderSource);
+	std::shared_ptr<Texture> loadTexture(const char* path, const ResidencyPolicy residency);
+
+	std::shared_ptr<Mesh> loadMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices) {
+		return this->loadMesh(vertices, indices, this->meshResidency);
+	}
+	std::shared_ptr<Mesh>    loadMesh(const char* path) { return this->loadMesh(path, this->meshResidency); }
+	std::shared_ptr<Texture> loadTexture(const char* path) { return this->loadTexture(path, this->textureResidency); }
+
 	Model createModel(const std::vector<Vertex>&    vertices, 
 					  const std::vector<uint32_t>&  indices,
 					  const char*                   vertexShaderSource, 
@@ -91,16 +209,21 @@ public:
 
 	template <typename Ty>
 	void createBuffer(Model* bufferParent, const PipelineStage stage, const Ty& bufferData, const std::string name = "") {
-		Buffer buffer = {};
+		Buffer buffer   = {};
 		this->handler->createConstantBuffer<Ty>(&buffer.buffer, bufferData);
-		buffer.name   = std::move(name);
-		buffer.stage  = stage;
-		bufferParent->buffers.push_back(buffer);
+		buffer.name     = std::move(name);
+		buffer.stage    = stage;
+		buffer.contents.assign(reinterpret_cast<const unsigned char*>(&bufferData), reinterpret_cast<const unsigned char*>(&bufferData) + sizeof(Ty));
+		bufferParent->buffers.push_back(std::move(buffer));
 	}
 	template <typename Ty>
 	void updateBuffer(Model* bufferParent, const Ty& bufferData, const size_t index) {
-		this->handler->updateConstantBuffer<Ty>(bufferParent->buffers[index].buffer, bufferData);
+		Buffer& buffer = bufferParent->buffers[index];
+		this->handler->updateConstantBuffer<Ty>(buffer.buffer, bufferData);
+		buffer.contents.assign(reinterpret_cast<const unsigned char*>(&bufferData), reinterpret_cast<const unsigned char*>(&bufferData) + sizeof(Ty));
 	}
+	// Replaces every buffer of a copied model with a new one holding the same contents
+	void copyBuffers(Model* model);
 
 	void createGlobalLight();
 
@@ -109,8 +232,35 @@ public:
 	void render();
 	void present();
 
-	void toQueue(Model&& model);
+	const DrawSortStats& getDrawSortStats() const noexcept { return this->drawSortStats; }
+	size_t getVisibleModels() const noexcept { return this->visibleModels; }
+	// Items are indices into the model column, refreshed every render
+	const SceneBVH& getSceneBVH() const noexcept { return this->sceneBVH; }
+	const OcclusionCuller& getOcclusionCuller() const noexcept { return this->occlusionCuller; }
+	ResourceManager& getResources() noexcept { return this->resources; }
+	// Billboards submitted here are drawn with the next render and then dropped
+	BillboardBatcher& getBillboards() noexcept { return this->billboardBatcher; }
+#ifdef RC_HEADLESS
+	// What the null backend was handed during the last presented frame
+	const NullFrameStats& getBackendStats() const noexcept { return this->handler->getFrameStats(); }
+#endif
+
+	// Starts reordering the model column and the transform streams by key, it finishes over the next frames.
+	// Draws then come out of the column mostly sorted and neighbours are composed and culled together.
+	// The Model objects themselves stay where they were allocated
+	void reorderModels(const LocalityKey key);
+	void reorderModels(const std::function<uint64_t(const Model&)>& key);
+
+	EntityHandle toQueue(Model&& model);
+
+	// Models are indexed by name when queued, the last one queued under a name wins
+	Model* findModel(const std::string_view name);
+
+	// Same as writing Model::transform, found by handle or name
+	void setTransform(const EntityHandle handle, const Transform& transform);
+	void setTransform(const std::string_view name, const Transform& transform);
+
 	void removeModel(const size_t index);
-	void removeModel(const std::string& name);
+	void removeModel(const std::string_view name);
 	void removeModel(const Model* model);
 };
\ No newline at end of file
@@ -0,0 +1,20 @@
+#pragma once
+#include "framework.h"
+
+#include "DirectX11Types.h"
+#include "Compression.h"
+
+// Bytes of RAM a resource holds on top of its GPU copy
+size_t residentBytes(const Mesh& mesh);
+size_t residentBytes(const Texture& texture);
+// Bytecode is dropped once the shader objects exist
+inline size_t residentBytes(const Shader&) { return 0; }
+
+// Called once the resource is uploaded, drops or compresses the CPU copy and records the policy on it
+void applyResidency(Mesh& mesh, const ResidencyPolicy policy);
+void applyResidency(Texture& texture, const ResidencyPolicy policy);
+
+// Copies the CPU data out whether it is kept as is or compressed, false when it was dropped.
+// Either output may be 0 when only the other one is needed.
+bool readCpuCopy(const Mesh& mesh, std::vector<Vertex>* outVertices, std::vector<uint32_t>* outIndices);
+bool readCpuCopy(const Texture& texture, std::vector<uint8_t>* outPixels);
\ No newline at end of file
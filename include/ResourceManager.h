@@ -0,0 +1,215 @@
+#pragma once
+#include <list>
+#include <chrono>
+#include <vector>
+#include <mutex>
+#include <future>
+#include <memory>
+#include <exception>
+#include <string_view>
+
+#include "Hash.h"
+#include "FlatHashMap.h"
+#include "DirectX11Types.h"
+#include "Residency.h"
+
+using ResourceKey = uint64_t;
+
+// Resources kept alive by the cache alone, above this many per type the least recently used ones are dropped
+constexpr size_t RC_RESOURCE_CACHE_CAPACITY = 256;
+
+// A path key names a file, a content key the bytes a resource was built from. The kind keeps
+// a mesh and a texture loaded from the same string apart.
+inline ResourceKey pathKey(const std::string_view kind, const std::string_view path) noexcept {
+	return fnv1a64(path, fnv1a64(kind));
+}
+inline ResourceKey contentKey(const std::string_view kind, const void* data, const size_t size, const ResourceKey seed = RC_FNV_OFFSET) noexcept {
+	return fnv1a64(data, size, fnv1a64(kind, seed));
+}
+
+struct ResourceCacheStats {
+	size_t hits      = 0;
+	// Hits on a load another thread had started, the caller waited for it instead of loading again
+	size_t joins     = 0;
+	size_t misses    = 0;
+	size_t evictions = 0;
+	size_t resident  = 0;
+
+	// RAM the cached resources hold besides their GPU copies, as measured by residentBytes when each was loaded
+	size_t bytes  = 0;
+	size_t budget = SIZE_MAX;
+};
+
+// Thread safe cache handing out shared handles to one resource per key. A key is loaded once even when
+// several threads ask for it at the same time, and entries nobody else holds are evicted least recently used first.
+// Eviction starts when either the entry capacity or the byte budget is exceeded.
+template <typename Ty>
+class ResourceCache {
+private:
+	using Handle = std::shared_ptr<Ty>;
+
+	struct Entry {
+		std::shared_future<Handle>       future;
+		std::list<ResourceKey>::iterator position;
+		size_t                           bytes = 0;
+	};
+
+	mutable std::mutex              mutex;
+	FlatHashMap<ResourceKey, Entry> entries;
+	// Front is the most recently acquired key
+	std::list<ResourceKey>          recent;
+	size_t                          capacity = RC_RESOURCE_CACHE_CAPACITY;
+	size_t                          budget   = SIZE_MAX;
+	size_t                          bytes    = 0;
+	ResourceCacheStats              stats;
+
+	bool over() const {
+		return this->entries.size() > this->capacity || this->bytes > this->budget;
+	}
+
+	static bool ready(const std::shared_future<Handle>& future) {
+		return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+	}
+
+	// Caller holds the mutex. Evicted handles go to out so the resources are released after it is unlocked
+	void evict(std::vector<Handle>& out) {
+		for (auto it = this->recent.end(); it != this->recent.begin() && this->over();) {
+			--it;
+
+			auto entry = this->entries.find(*it);
+			if (!ready(entry->second.future)) continue;
+
+			// The future holds one reference, anything above that is a model still using the resource
+			const Handle& handle = entry->second.future.get();
+			if (handle.use_count() > 1) continue;
+
+			out.push_back(handle);
+			this->bytes -= entry->second.bytes;
+			this->entries.erase(entry);
+			it = this->recent.erase(it);
+			this->stats.evictions++;
+		}
+	}
+
+public:
+	// Returns the resource for key, calling load() to build it when it is not cached or being loaded.
+	// load returns the resource by value and runs on the calling thread without the lock held.
+	template <typename Loader>
+	Handle acquire(const ResourceKey key, Loader&& load) {
+		std::promise<Handle>       promise;
+		std::shared_future<Handle> pending;
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+
+			auto found = this->entries.find(key);
+			if (found != this->entries.end()) {
+				this->recent.splice(this->recent.begin(), this->recent, found->second.position);
+
+				pending = found->second.future;
+				if (ready(pending)) this->stats.hits++;
+				else                this->stats.joins++;
+			}
+			else {
+				this->recent.push_front(key);
+				this->entries.insert({ key, Entry{ promise.get_future().share(), this->recent.begin() } });
+				this->stats.misses++;
+			}
+		}
+		if (pending.valid()) return pending.get();
+
+		Handle handle;
+		try {
+			handle = std::make_shared<Ty>(load());
+		}
+		catch (...) {
+			// Waiting threads get the exception, the next acquire tries again
+			promise.set_exception(std::current_exception());
+
+			std::lock_guard<std::mutex> lock(this->mutex);
+			auto entry = this->entries.find(key);
+			if (entry != this->entries.end()) {
+				this->recent.erase(entry->second.position);
+				this->entries.erase(entry);
+			}
+			throw;
+		}
+		promise.set_value(handle);
+
+		const size_t bytes = residentBytes(*handle);
+
+		std::vector<Handle> evicted;
+		{
+			std::lock_guard<std::mutex> lock(this->mutex);
+
+			auto entry = this->entries.find(key);
+			if (entry != this->entries.end()) {
+				entry->second.bytes = bytes;
+				this->bytes        += bytes;
+			}
+			this->evict(evicted);
+		}
+		return handle;
+	}
+
+	// Cached without loading, empty when the key is unknown or still loading
+	Handle find(const ResourceKey key) const {
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		auto entry = this->entries.find(key);
+		if (entry == this->entries.end() || !ready(entry->second.future)) return nullptr;
+		return entry->second.future.get();
+	}
+
+	void setCapacity(const size_t capacity) {
+		std::vector<Handle> evicted;
+
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->capacity = capacity;
+		this->evict(evicted);
+	}
+	// Resources in use are never evicted, so bytes may stay above budget until they are released
+	void setBudget(const size_t budget) {
+		std::vector<Handle> evicted;
+
+		std::lock_guard<std::mutex> lock(this->mutex);
+		this->budget = budget;
+		this->evict(evicted);
+	}
+	// Drops every entry nobody else holds, regardless of capacity
+	void trim() {
+		std::vector<Handle> evicted;
+
+		std::lock_guard<std::mutex> lock(this->mutex);
+		const size_t capacity = this->capacity;
+		this->capacity = 0;
+		this->evict(evicted);
+		this->capacity = capacity;
+	}
+
+	ResourceCacheStats getStats() const {
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		ResourceCacheStats stats = this->stats;
+		stats.resident = this->entries.size();
+		stats.bytes    = this->bytes;
+		stats.budget   = this->budget;
+		return stats;
+	}
+};
+
+// One cache per resource type the renderer creates
+struct ResourceManager {
+	ResourceCache<Mesh>    meshes;
+	ResourceCache<Shader>  shaders;
+	ResourceCache<Texture> textures;
+
+	void trim() {
+		this->meshes.trim();
+		this->shaders.trim();
+		this->textures.trim();
+	}
+
+	size_t residentBytes() const {
+		return this->meshes.getStats().bytes + this->shaders.getStats().bytes + this->textures.getStats().bytes;
+	}
+};
\ No newline at end of file
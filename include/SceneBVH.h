@@ -0,0 +1,103 @@
+#pragma once
+#include "framework.h"
+
+#include "Bounds.h"
+#include "Frustum.h"
+#include "ThreadPool.h"
+
+constexpr uint32_t RC_BVH_BINS      = 16;
+constexpr uint32_t RC_BVH_LEAF_SIZE = 4;
+// Subtrees at most this big are built as separate tasks when the build runs in parallel
+constexpr size_t   RC_BVH_TASK_SIZE = 4096;
+
+struct BVHNode {
+	DirectX::XMFLOAT3 boundsMin;
+	// Left child of an inner node, the right one follows it. Zero for leaves, the root is nobody's child
+	uint32_t          child = 0;
+	DirectX::XMFLOAT3 boundsMax;
+	// Range of the item list under the node, leaves and inner nodes alike
+	uint32_t          first = 0;
+	uint32_t          count = 0;
+
+	bool isLeaf() const noexcept { return this->child == 0; }
+};
+
+struct BVHTree {
+	std::vector<BVHNode>  nodes;
+	std::vector<uint32_t> parents;
+	std::vector<uint32_t> items;
+	// Leaf holding each item
+	std::vector<uint32_t> itemLeaf;
+};
+
+struct BVHRay {
+	DirectX::XMFLOAT3 origin;
+	DirectX::XMFLOAT3 direction;
+	float             maxDistance = FLT_MAX;
+};
+
+struct BVHStats {
+	size_t nodes         = 0;
+	size_t rebuilds      = 0;
+	// Leaves whose items moved during the last commit
+	size_t refitLeaves   = 0;
+
+	float buildMilliseconds = 0.0f;
+};
+
+// Bounding volume hierarchy over world space boxes, one per item index.
+// Items are updated in place and the tree is refit along the changed paths on commit, while a full
+// binned SAH rebuild runs in the background every rebuildInterval commits and replaces it once done.
+class SceneBVH {
+private:
+	ThreadPool* scheduler     = nullptr;
+	size_t      threadsAmount = 1;
+
+	BVHTree                        tree;
+	std::vector<DirectX::XMFLOAT3> itemMin;
+	std::vector<DirectX::XMFLOAT3> itemMax;
+
+	std::vector<uint32_t> dirtyLeaves;
+	std::vector<uint8_t>  leafDirty;
+	bool                  needsRebuild = true;
+
+	// Background rebuild, built from a copy of the boxes taken when it started
+	BVHTree                        pending;
+	std::vector<DirectX::XMFLOAT3> pendingMin;
+	std::vector<DirectX::XMFLOAT3> pendingMax;
+	ThreadGroup*                   pendingGroup = nullptr;
+	size_t                         commitsSinceRebuild = 0;
+
+	BVHStats stats;
+
+	void buildTree(BVHTree& target, const DirectX::XMFLOAT3* mins, const DirectX::XMFLOAT3* maxs, const size_t count, const bool parallel);
+	void refitAll();
+	void waitPending();
+
+public:
+	// Commits between background rebuilds, 0 only rebuilds when the item count changes
+	size_t rebuildInterval = 240;
+
+	~SceneBVH() { this->waitPending(); }
+
+	void build(ThreadPool* scheduler, const size_t threadsAmount) {
+		this->scheduler     = scheduler;
+		this->threadsAmount = std::max<size_t>(threadsAmount, 1);
+	}
+
+	// Changing the item count rebuilds the tree on the next commit
+	void resize(const size_t count);
+	void update(const uint32_t item, const Bounds& bounds);
+	// Applies the updates: refits the dirty paths, or rebuilds when needed, and swaps in a finished background build
+	void commit();
+
+	// Items whose box intersects the frustum, in tree order
+	void queryFrustum(const Frustum& frustum, std::vector<uint32_t>& out) const;
+	// Items whose box overlaps [boxMin, boxMax]
+	void queryBox(const DirectX::XMFLOAT3& boxMin, const DirectX::XMFLOAT3& boxMax, std::vector<uint32_t>& out) const;
+	// Nearest item box hit by the ray, boxes only, nothing is tested against triangles
+	bool raycast(const BVHRay& ray, uint32_t* item, float* distance) const;
+
+	size_t size() const noexcept { return this->itemMin.size(); }
+	const BVHStats& getStats() const noexcept { return this->stats; }
+};
\ No newline at end of file
@@ -0,0 +1,84 @@
+#pragma once
+#include "framework.h"
+
+#include "Hash.h"
+#include "FlatHashMap.h"
+
+#include <span>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <functional>
+#include <filesystem>
+#include <string_view>
+
+constexpr uint32_t RC_SHADER_CACHE_MAGIC   = 0x43534352; // "RCSC"
+constexpr uint32_t RC_SHADER_CACHE_VERSION = 1;
+
+struct ShaderDefine {
+	std::string name;
+	std::string value;
+};
+
+// Everything that changes the bytecode a compile produces, and so everything the cache key covers
+struct ShaderCompileRequest {
+	std::string_view              source;
+	std::string_view              entryPoint;
+	std::string_view              target;
+	std::span<const ShaderDefine> defines;
+	uint32_t                      flags = 0;
+};
+
+using ShaderBytecode = std::vector<uint8_t>;
+// Fills out and returns true on success, fills error otherwise
+using ShaderCompiler = std::function<bool(const ShaderCompileRequest& request, ShaderBytecode& out, std::string& error)>;
+
+// The compiler version is part of the key, bytecode from another compiler is never served
+uint64_t shaderCacheKey(const ShaderCompileRequest& request, const uint64_t compilerVersion = 0) noexcept;
+
+struct ShaderCacheStats {
+	size_t hits           = 0;
+	size_t misses         = 0;
+	size_t compileErrors  = 0;
+	// Blobs whose size or checksum did not match the index, they are compiled again
+	size_t corruptEntries = 0;
+};
+
+// Compiled bytecode kept on disk between runs, one blob per key and an append only index.
+// Lookups and stores are thread safe. Two threads missing on the same key both compile it, the last store wins.
+class ShaderCache {
+private:
+	struct IndexRecord {
+		uint64_t key;
+		uint64_t size;
+		uint64_t checksum;
+	};
+
+	std::filesystem::path directory;
+	ShaderCompiler        compiler;
+	uint64_t              compilerVersion = 0;
+
+	mutable std::mutex                 mutex;
+	FlatHashMap<uint64_t, IndexRecord> index;
+	ShaderCacheStats                   stats;
+
+	std::filesystem::path blobPath(const uint64_t key) const;
+	std::filesystem::path indexPath() const { return this->directory / "index.bin"; }
+
+	bool readBlob(const IndexRecord& record, ShaderBytecode& out) const;
+	void store(const uint64_t key, const ShaderBytecode& bytecode);
+
+public:
+	// An empty directory keeps nothing on disk, every request is compiled.
+	// Entries of a different compiler version are compiled again, so it has to change whenever the compiler does
+	bool build(const std::filesystem::path& directory, ShaderCompiler compiler, const uint64_t compilerVersion = 0);
+
+	// Bytecode for the request, read from disk when cached and compiled and stored otherwise
+	bool get(const ShaderCompileRequest& request, ShaderBytecode& out, std::string* error = nullptr);
+
+	// Removes every blob and the index
+	void clear();
+
+	size_t size() const;
+	ShaderCacheStats getStats() const;
+};
\ No newline at end of file
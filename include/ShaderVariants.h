@@ -0,0 +1,43 @@
+#pragma once
+#include "framework.h"
+
+#include "DirectX11Handler.h"
+#include "ResourceManager.h"
+
+#include <string>
+#include <vector>
+#include <initializer_list>
+
+using ShaderKeywordMask = uint32_t;
+
+constexpr size_t RC_MAX_SHADER_KEYWORDS = 32;
+
+// One pair of sources written with #if blocks per feature keyword, compiled into a variant per keyword combination.
+// Bit i of a mask turns on keywords[i]. Every keyword is defined for every variant, to 1 when on and 0 when off.
+// Variants are compiled the first time they are asked for, or ahead of time through precompile, never otherwise.
+class ShaderVariantSet {
+private:
+	DirectX11Handler* handler = nullptr;
+
+	std::string              vertexShaderSource;
+	std::string              pixelShaderSource;
+	std::vector<std::string> keywords;
+
+	// Keyed by mask, capacity is unbounded so compiled variants stay until the set goes away
+	ResourceCache<Shader> variants;
+
+public:
+	void build(DirectX11Handler* handler, std::string vertexShaderSource, std::string pixelShaderSource, std::initializer_list<const char*> keywords);
+
+	// 0 for a keyword the set does not declare
+	ShaderKeywordMask keyword(const std::string_view name) const;
+	ShaderKeywordMask mask(std::initializer_list<std::string_view> names) const;
+
+	std::vector<ShaderDefine> defines(const ShaderKeywordMask mask) const;
+
+	std::shared_ptr<Shader> get(ShaderKeywordMask mask);
+	void precompile(std::initializer_list<ShaderKeywordMask> masks);
+
+	size_t getKeywordCount() const noexcept { return this->keywords.size(); }
+	size_t getCompiledCount() const { return this->variants.getStats().resident; }
+};
\ No newline at end of file
@@ -0,0 +1,215 @@
+#pragma once
+#include "framework.h"
+
+#include "DirectX11Types.h"
+
+// Only the low slots are shadowed, binds past them always reach the context
+constexpr UINT RC_FILTERED_CONSTANT_SLOTS      = D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT;
+constexpr UINT RC_FILTERED_RESOURCE_SLOTS      = 16;
+constexpr UINT RC_FILTERED_SAMPLER_SLOTS       = D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT;
+constexpr UINT RC_FILTERED_VERTEX_BUFFER_SLOTS = 16;
+
+struct StateFilterStats {
+	uint64_t issued  = 0;
+	uint64_t skipped = 0;
+};
+
+// Shadow copy of what is bound on the context, set calls that would not change it are dropped.
+// Templated on the context so the filtering can be checked against a recording stub instead of a device.
+template <typename ContextType, typename Context1Type = ContextType>
+class StateFilter {
+private:
+	struct ConstantBinding {
+		ID3D11Buffer* buffer;
+		// Both zero for a plain bind of the whole buffer
+		UINT          firstConstant;
+		UINT          numConstants;
+	};
+	struct VertexBufferBinding {
+		ID3D11Buffer* buffer;
+		UINT          stride;
+		UINT          offset;
+	};
+	struct StageState {
+		ConstantBinding           constants[RC_FILTERED_CONSTANT_SLOTS];
+		ID3D11ShaderResourceView* resources[RC_FILTERED_RESOURCE_SLOTS];
+		ID3D11SamplerState*       samplers[RC_FILTERED_SAMPLER_SLOTS];
+	};
+	// Plain data only, invalidate() fills it with a pattern no real binding can match.
+	// Enums are kept as UINT, the pattern is not a valid value of the enum types
+	struct ShadowState {
+		ID3D11VertexShader* vertexShader;
+		ID3D11PixelShader*  pixelShader;
+		ID3D11InputLayout*  inputLayout;
+		UINT                topology;
+
+		VertexBufferBinding vertexBuffers[RC_FILTERED_VERTEX_BUFFER_SLOTS];
+
+		ID3D11Buffer* indexBuffer;
+		UINT          indexFormat;
+		UINT          indexOffset;
+
+		ID3D11RasterizerState*   rasterizerState;
+		ID3D11DepthStencilState* depthStencilState;
+		UINT                     stencilRef;
+		ID3D11BlendState*        blendState;
+		FLOAT                    blendFactor[4];
+		UINT                     sampleMask;
+
+		StageState vertexStage;
+		StageState pixelStage;
+	};
+
+	ContextType*  context  = nullptr;
+	Context1Type* context1 = nullptr;
+
+	ShadowState shadow;
+
+	StateFilterStats current;
+	StateFilterStats last;
+
+	bool changed(const bool redundant) {
+		if (redundant) {
+			this->current.skipped++;
+			return false;
+		}
+		this->current.issued++;
+		return true;
+	}
+
+	StageState& stageState(const PipelineStage stage) {
+		return stage == PipelineStage::VertexStage ? this->shadow.vertexStage : this->shadow.pixelStage;
+	}
+
+	// Updates the shadowed part of a slot range, returns true when any slot in it changes
+	template <typename BindingType, typename SlotType, size_t SlotCount>
+	bool updateRange(BindingType (&slots)[SlotCount], const UINT startSlot, const UINT count, const SlotType* values) {
+		bool dirty = startSlot + count > SlotCount;
+		for (UINT i = 0; i < count && startSlot + i < SlotCount; i++) {
+			if (memcmp(&slots[startSlot + i], &values[i], sizeof(BindingType)) != 0) {
+				memcpy(&slots[startSlot + i], &values[i], sizeof(BindingType));
+				dirty = true;
+			}
+		}
+		return dirty;
+	}
+
+public:
+	StateFilter() = default;
+
+	void build(ContextType* context, Context1Type* context1 = nullptr) {
+		this->context  = context;
+		this->context1 = context1;
+
+		this->current = {};
+		this->last    = {};
+		this->invalidate();
+	}
+
+	// Forgets the shadow state, needed whenever something else may have touched the context
+	void invalidate() {
+		memset(&this->shadow, 0xFF, sizeof(ShadowState));
+	}
+
+	// Publishes this frame's counters and starts over with an unknown state
+	void endFrame() {
+		this->last    = this->current;
+		this->current = {};
+		this->invalidate();
+	}
+
+	const StateFilterStats& getFrameStats() const noexcept { return this->last; }
+	const StateFilterStats& getCurrentStats() const noexcept { return this->current; }
+
+	void setVertexShader(ID3D11VertexShader* shader) {
+		if (!this->changed(this->shadow.vertexShader == shader)) return;
+		this->shadow.vertexShader = shader;
+		this->context->VSSetShader(shader, nullptr, 0);
+	}
+	void setPixelShader(ID3D11PixelShader* shader) {
+		if (!this->changed(this->shadow.pixelShader == shader)) return;
+		this->shadow.pixelShader = shader;
+		this->context->PSSetShader(shader, nullptr, 0);
+	}
+	void setInputLayout(ID3D11InputLayout* inputLayout) {
+		if (!this->changed(this->shadow.inputLayout == inputLayout)) return;
+		this->shadow.inputLayout = inputLayout;
+		this->context->IASetInputLayout(inputLayout);
+	}
+	void setPrimitiveTopology(const D3D11_PRIMITIVE_TOPOLOGY topology) {
+		if (!this->changed(this->shadow.topology == static_cast<UINT>(topology))) return;
+		this->shadow.topology = static_cast<UINT>(topology);
+		this->context->IASetPrimitiveTopology(topology);
+	}
+
+	void setVertexBuffer(const UINT slot, ID3D11Buffer* buffer, const UINT stride, const UINT offset) {
+		const VertexBufferBinding binding = { buffer, stride, offset };
+		if (!this->changed(!this->updateRange(this->shadow.vertexBuffers, slot, 1, &binding))) return;
+		this->context->IASetVertexBuffers(slot, 1, &buffer, &stride, &offset);
+	}
+	void setIndexBuffer(ID3D11Buffer* buffer, const DXGI_FORMAT format, const UINT offset) {
+		const bool redundant = this->shadow.indexBuffer == buffer && this->shadow.indexFormat == static_cast<UINT>(format) && this->shadow.indexOffset == offset;
+		if (!this->changed(redundant)) return;
+
+		this->shadow.indexBuffer = buffer;
+		this->shadow.indexFormat = static_cast<UINT>(format);
+		this->shadow.indexOffset = offset;
+		this->context->IASetIndexBuffer(buffer, format, offset);
+	}
+
+	void setRasterizerState(ID3D11RasterizerState* state) {
+		if (!this->changed(this->shadow.rasterizerState == state)) return;
+		this->shadow.rasterizerState = state;
+		this->context->RSSetState(state);
+	}
+	void setDepthStencilState(ID3D11DepthStencilState* state, const UINT stencilRef) {
+		if (!this->changed(this->shadow.depthStencilState == state && this->shadow.stencilRef == stencilRef)) return;
+		this->shadow.depthStencilState = state;
+		this->shadow.stencilRef        = stencilRef;
+		this->context->OMSetDepthStencilState(state, stencilRef);
+	}
+	void setBlendState(ID3D11BlendState* state, const FLOAT blendFactor[4], const UINT sampleMask) {
+		static const FLOAT defaultFactor[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		const FLOAT* factor = blendFactor ? blendFactor : defaultFactor;
+
+		const bool redundant = this->shadow.blendState == state && this->shadow.sampleMask == sampleMask &&
+							   memcmp(this->shadow.blendFactor, factor, sizeof(this->shadow.blendFactor)) == 0;
+		if (!this->changed(redundant)) return;
+
+		this->shadow.blendState = state;
+		this->shadow.sampleMask = sampleMask;
+		memcpy(this->shadow.blendFactor, factor, sizeof(this->shadow.blendFactor));
+		this->context->OMSetBlendState(state, blendFactor, sampleMask);
+	}
+
+	void setConstantBuffers(const PipelineStage stage, const UINT startSlot, const UINT count, ID3D11Buffer* const* buffers) {
+		ConstantBinding bindings[RC_FILTERED_CONSTANT_SLOTS] = {};
+		for (UINT i = 0; i < count && i < RC_FILTERED_CONSTANT_SLOTS; i++) bindings[i].buffer = buffers[i];
+
+		if (!this->changed(!this->updateRange(this->stageState(stage).constants, startSlot, count, bindings))) return;
+
+		if (stage == PipelineStage::VertexStage) this->context->VSSetConstantBuffers(startSlot, count, buffers);
+		else this->context->PSSetConstantBuffers(startSlot, count, buffers);
+	}
+	// Binds a 16 byte constant aligned window of the buffer, needs the 1.1 context
+	void setConstantBufferRange(const PipelineStage stage, const UINT slot, ID3D11Buffer* buffer, const UINT firstConstant, const UINT numConstants) {
+		const ConstantBinding binding = { buffer, firstConstant, numConstants };
+		if (!this->changed(!this->updateRange(this->stageState(stage).constants, slot, 1, &binding))) return;
+
+		if (stage == PipelineStage::VertexStage) this->context1->VSSetConstantBuffers1(slot, 1, &buffer, &firstConstant, &numConstants);
+		else this->context1->PSSetConstantBuffers1(slot, 1, &buffer, &firstConstant, &numConstants);
+	}
+
+	void setShaderResources(const PipelineStage stage, const UINT startSlot, const UINT count, ID3D11ShaderResourceView* const* views) {
+		if (!this->changed(!this->updateRange(this->stageState(stage).resources, startSlot, count, views))) return;
+
+		if (stage == PipelineStage::VertexStage) this->context->VSSetShaderResources(startSlot, count, views);
+		else this->context->PSSetShaderResources(startSlot, count, views);
+	}
+	void setSamplers(const PipelineStage stage, const UINT startSlot, const UINT count, ID3D11SamplerState* const* samplers) {
+		if (!this->changed(!this->updateRange(this->stageState(stage).samplers, startSlot, count, samplers))) return;
+
+		if (stage == PipelineStage::VertexStage) this->context->VSSetSamplers(startSlot, count, samplers);
+		else this->context->PSSetSamplers(startSlot, count, samplers);
+	}
+};
\ No newline at end of file
@@ -0,0 +1,44 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <shared_mutex>
+#include <string_view>
+
+#include "FlatHashMap.h"
+
+using StringID = uint32_t;
+
+constexpr StringID RC_EMPTY_STRING = 0;
+
+// Global interning table, every distinct string is stored once and referenced by a 32 bit ID.
+// IDs and the views returned for them stay valid for the whole run.
+class StringTable {
+private:
+	struct Entry {
+		std::string_view str;
+		uint64_t         hash;
+	};
+
+	static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+	static std::shared_mutex mutex;
+
+	static FlatHashMap<std::string_view, StringID, StringHash, StringEqual> ids;
+	static std::vector<Entry>                                               entries;
+	static std::vector<std::unique_ptr<char[]>>                             blocks;
+	static size_t                                                           blockUsed;
+
+	static std::string_view store(const std::string_view str);
+
+public:
+	static StringID intern(const std::string_view str);
+	// Does not insert, returns RC_EMPTY_STRING when the string was never interned
+	static StringID find(const std::string_view str);
+
+	static std::string_view view(const StringID id);
+	static const char* c_str(const StringID id);
+	static uint64_t hash(const StringID id);
+
+	static size_t size();
+};
\ No newline at end of file
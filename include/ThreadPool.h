@@ -4,8 +4,7 @@
 #include <atomic>
 #include <memory>
 #include <functional>
-
-#include <windows.h>
+#include <thread>
 
 #include "FlexibleVector.h"
 
@@ -25,7 +24,6 @@ public:
 
 class ThreadPool {
 private:
-	using WorkerThread = HANDLE;
 	using Callable = std::function<void()>;
 
 	FlexibleVector<> tasks;
@@ -38,9 +36,7 @@ private:
 
 	bool shouldExit;
 
-	static DWORD WINAPI ThreadProc(_In_ LPVOID lpParameter) {
-		auto pool = reinterpret_cast<ThreadPool*>(lpParameter);
-
+	static void threadProc(ThreadPool* pool) {
 		Callable task;
 		while (true) {
 			{
@@ -50,7 +46,7 @@ private:
 					pool->finishedThreads++;
 					lock.unlock();
 					pool->assignmentCv.notify_all();
-					return 14;
+					return;
 				}
 
 				task = std::move(*pool->tasks.at<Callable>(pool->tasks.size() - 1));
@@ -61,7 +57,8 @@ private:
 	}
 
 	void createThread() {
-		CreateThread(nullptr, 0, ThreadProc, this, NULL, NULL);
+		// Workers are never joined, the destructor waits until every one of them has counted itself out
+		std::thread(ThreadPool::threadProc, this).detach();
 	}
 
 	void scheduleWorkImpl(const Callable& task) {
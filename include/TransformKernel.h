@@ -0,0 +1,111 @@
+#pragma once
+#include "framework.h"
+
+#include "DirectX11Types.h"
+#include "ThreadPool.h"
+
+#include <array>
+
+// Below this many transforms a batch is composed on the calling thread
+constexpr size_t RC_TRANSFORM_CHUNK_SIZE = 8192;
+
+// Transform components in structure of arrays form, so one SIMD load reads the same component of several objects.
+// The renderer keeps one entry per queued model in column order and only writes the entries whose transform changed
+struct TransformStreams {
+	std::vector<float> positionX;
+	std::vector<float> positionY;
+	std::vector<float> positionZ;
+
+	std::vector<float> rotationX;
+	std::vector<float> rotationY;
+	std::vector<float> rotationZ;
+	std::vector<float> rotationW;
+
+	std::vector<float> scaleX;
+	std::vector<float> scaleY;
+	std::vector<float> scaleZ;
+
+	// Every component stream, structural edits apply to all of them alike
+	std::array<std::vector<float>*, 10> components() noexcept {
+		return { &this->positionX, &this->positionY, &this->positionZ,
+				 &this->rotationX, &this->rotationY, &this->rotationZ, &this->rotationW,
+				 &this->scaleX, &this->scaleY, &this->scaleZ };
+	}
+
+	void resize(const size_t count) {
+		for (auto stream : this->components()) stream->resize(count);
+	}
+	void push(const Transform& transform) {
+		this->resize(this->size() + 1);
+		this->set(this->size() - 1, transform);
+	}
+	// Shifts everything after i down by one, like the model column does
+	void erase(const size_t i) {
+		for (auto stream : this->components()) stream->erase(stream->begin() + i);
+	}
+	void swap(const size_t a, const size_t b) {
+		for (auto stream : this->components()) std::swap((*stream)[a], (*stream)[b]);
+	}
+
+	void set(const size_t i, const Transform& transform) {
+		DirectX::XMFLOAT4 position;
+		DirectX::XMFLOAT4 rotation;
+		DirectX::XMFLOAT4 scale;
+		DirectX::XMStoreFloat4(&position, transform.position);
+		DirectX::XMStoreFloat4(&rotation, transform.rotation);
+		DirectX::XMStoreFloat4(&scale, transform.scale);
+
+		this->positionX[i] = position.x;
+		this->positionY[i] = position.y;
+		this->positionZ[i] = position.z;
+
+		this->rotationX[i] = rotation.x;
+		this->rotationY[i] = rotation.y;
+		this->rotationZ[i] = rotation.z;
+		this->rotationW[i] = rotation.w;
+
+		this->scaleX[i] = scale.x;
+		this->scaleY[i] = scale.y;
+		this->scaleZ[i] = scale.z;
+	}
+
+	// Writes the entry only when it differs from the transform, returns whether it did
+	bool update(const size_t i, const Transform& transform) {
+		DirectX::XMFLOAT4 position;
+		DirectX::XMFLOAT4 rotation;
+		DirectX::XMFLOAT4 scale;
+		DirectX::XMStoreFloat4(&position, transform.position);
+		DirectX::XMStoreFloat4(&rotation, transform.rotation);
+		DirectX::XMStoreFloat4(&scale, transform.scale);
+
+		const bool same = this->positionX[i] == position.x && this->positionY[i] == position.y && this->positionZ[i] == position.z &&
+						  this->rotationX[i] == rotation.x && this->rotationY[i] == rotation.y && this->rotationZ[i] == rotation.z &&
+						  this->rotationW[i] == rotation.w &&
+						  this->scaleX[i] == scale.x && this->scaleY[i] == scale.y && this->scaleZ[i] == scale.z;
+		if (same) return false;
+
+		this->set(i, transform);
+		return true;
+	}
+
+	size_t size() const noexcept { return this->positionX.size(); }
+};
+
+// Composes scale * rotation * translation for the transforms in [begin, end), the same matrices the XMMatrix functions build.
+// world[i] gets them as XMStoreFloat4x4 stores them, transposed[i] in the column major layout HLSL constants read. Either may be null.
+void composeRange(const TransformStreams& streams, const size_t begin, const size_t end, DirectX::XMFLOAT4X4* world, DirectX::XMFLOAT4X4* transposed);
+
+class TransformKernel {
+private:
+	ThreadPool* scheduler     = nullptr;
+	size_t      threadsAmount = 1;
+
+public:
+	void build(ThreadPool* scheduler, const size_t threadsAmount) {
+		this->scheduler     = scheduler;
+		this->threadsAmount = std::max<size_t>(threadsAmount, 1);
+	}
+
+	// Composes every transform of the streams, split in contiguous chunks across the pool when there are enough
+	void compose(const TransformStreams& streams, DirectX::XMFLOAT4X4* world, DirectX::XMFLOAT4X4* transposed);
+};
\ No newline at end of file
@@ -0,0 +1,32 @@
+#pragma once
+#include "framework.h"
+
+#include "DirectX11Types.h"
+
+// Meshes with at most this many vertices get 16 bit indices on the GPU
+constexpr size_t RC_MAX_SHORT_INDEX_VERTICES = 65535;
+
+// Compact shaders declare "float2 normal : OCT_NORMAL" and decode it with this, positions need nothing
+// since the renderer folds the bounds back into the world matrix.
+// That matrix, per draw or per instance, starts with Mesh::dequantize, a non uniform scale to the bounds extents.
+// Decoded normals are already in mesh space and must not go through it, or they lean towards the long axes of the bounds
+constexpr const char* RC_COMPACT_VERTEX_HLSL = R"(
+	float3 decodeOctNormal(float2 encoded) {
+		float3 normal = float3(encoded.x, encoded.y, 1.0f - abs(encoded.x) - abs(encoded.y));
+		float  fold   = saturate(-normal.z);
+		normal.xy += normal.xy >= 0.0f ? -fold : fold;
+		return normalize(normal);
+	}
+)";
+
+DirectX::XMFLOAT2 encodeOctNormal(const DirectX::XMFLOAT3& normal);
+DirectX::XMFLOAT3 decodeOctNormal(const DirectX::XMFLOAT2& encoded);
+
+// Quantizes positions into bounds and writes the matrix taking the snorm positions back into mesh space
+void compactVertices(const std::vector<Vertex>&  vertices,
+					 const Bounds&               bounds,
+					 std::vector<CompactVertex>* outVertices,
+					 DirectX::XMFLOAT4X4*        outDequantize,
+					 VertexCompactionStats*      outStats);
+
+std::vector<uint16_t> shortIndices(const std::vector<uint32_t>& indices);
\ No newline at end of file
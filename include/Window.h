@@ -1,7 +1,9 @@
 #pragma once
 #include "framework.h"
 
+#ifndef RC_HEADLESS
 extern LRESULT ImGui_ImplWin32_WndProcHandler(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam);
+#endif
 
 class DirectX11Handler;
 class GuiManager;
@@ -9,18 +11,22 @@ class InputManager;
 
 class Window {
 private:
+#ifndef RC_HEADLESS
     static LRESULT CALLBACK DefWEWindowProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam);
 
     HWND hWnd;
+#endif
 
-    BOOL squit;
+    BOOL squit = FALSE;
 
 public:
     friend class DirectX11Handler;
     friend class GuiManager;
 	friend class InputManager;
 
+#ifndef RC_HEADLESS
     MSG msg;
+#endif
 
     int width;
     int height;
@@ -48,5 +54,8 @@ public:
 
     void setWIP(DirectX11Handler* dx11h);
 
+    // Asks the window to close, the main loop stops once the quit reaches the input manager
+    void close();
+
     bool shouldQuit() noexcept { return squit; }
 };
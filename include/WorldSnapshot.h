@@ -0,0 +1,57 @@
+#pragma once
+#include "framework.h"
+
+#include "ReObjects.h"
+#include "Renderer.h"
+
+#include <fstream>
+#include <tuple>
+#include <string_view>
+
+constexpr uint32_t RC_SNAPSHOT_MAGIC     = 0x53574352; // "RCWS"
+constexpr uint32_t RC_SNAPSHOT_VERSION   = 2;
+constexpr uint64_t RC_SNAPSHOT_ALIGNMENT = 16;
+
+struct SnapshotHeader {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t columnCount;
+	uint32_t modelCount;
+	uint64_t stringTableSize;
+};
+struct SnapshotColumnHeader {
+	uint64_t nameHash;
+	uint64_t itemSize;
+	uint64_t count;
+	uint64_t slotCount;
+};
+
+// Models hold GPU resources, so only their resource references and TRS are saved
+struct ModelRecord {
+	uint32_t entity;
+	uint32_t meshPath;
+	uint32_t texturePath;
+	uint32_t name;
+
+	DirectX::XMFLOAT3 position;
+	DirectX::XMFLOAT4 rotation;
+	DirectX::XMFLOAT3 scale;
+};
+
+using SnapshotResolver = std::function<Model(const std::string_view meshPath, const std::string_view texturePath)>;
+
+class WorldSnapshot {
+private:
+	std::vector<char>               strings;
+	FlatHashMap<StringID, uint32_t> offsets;
+
+	uint32_t addString(const StringID id);
+
+public:
+	WorldSnapshot() = default;
+
+	// Writes every registered component column and every queued model
+	bool write(const std::string& path, ObjectsManager* objectsManager);
+	// Replaces the registered component columns and queues the saved models through the resolver
+	bool read(const std::string& path, ObjectsManager* objectsManager, Renderer* renderer, const SnapshotResolver& resolver);
+};
\ No newline at end of file
@@ -1,4 +1,17 @@
 #pragma once
+// Headless builds run the engine without a window or a GPU, every Win32 and Direct3D call goes to null stand-ins.
+// They are the only option off Windows, and can be asked for on Windows by defining RC_HEADLESS.
+#if !defined(_WIN32) && !defined(RC_HEADLESS)
+#define RC_HEADLESS
+#endif
+
+#ifdef RC_HEADLESS
+#include "NullPlatform.h"
+
+#include "imgui.h"
+
+#include <DirectXMath.h>
+#else
 #include <intrin.h>
 
 #include <windows.h>
@@ -8,6 +21,8 @@
 #include "backends/imgui_impl_win32.h"
 
 #include <d3d11.h>
+#include <d3d11_1.h>
+#include <d3d11shader.h>
 #include <DirectXMath.h>
 #include <d3dcompiler.h>
 #include <DirectXColors.h>
@@ -16,6 +31,7 @@
 
 #pragma comment(lib, "d3d11.lib")
 #pragma comment(lib, "d3dcompiler.lib")
+#endif
 
 #include "stb_image.h"
 
@@ -0,0 +1,218 @@
+#include "Billboards.h"
+
+#include <bit>
+#include <chrono>
+
+namespace {
+	// Quads arrive already expanded in world space, the vertex shader only projects them
+	const char* BillboardVertexShaderSource = R"(
+	cbuffer FrameConstants : register(b1) {
+		matrix view;
+		matrix projection;
+		matrix viewProjection;
+	};
+
+	struct VSInput {
+		float3 position : POSITION;
+		float3 normal   : NORMAL;
+		float2 texCoords: TEXCOORD;
+	};
+
+	struct PSInput {
+		float4 position : SV_POSITION;
+		float2 texCoords: TEXCOORD;
+	};
+
+	PSInput VSMain(VSInput input) {
+		PSInput output;
+		output.position  = mul(float4(input.position, 1.0f), viewProjection);
+		output.texCoords = input.texCoords;
+		return output;
+	}
+	)";
+	const char* BillboardPixelShaderSource = R"(
+	Texture2D tex : register(t0);
+	SamplerState samplerState : register(s0);
+
+	struct PSInput {
+		float4 position : SV_POSITION;
+		float2 texCoords: TEXCOORD;
+	};
+
+	float4 PSMain(PSInput input) : SV_TARGET {
+		float4 texColor = tex.Sample(samplerState, input.texCoords);
+	#if ALPHA_CUTOUT
+		clip(texColor.a - 0.5f);
+	#endif
+		return texColor;
+	}
+	)";
+
+	template <typename Fn>
+	void runChunks(ThreadPool* scheduler, const size_t threadsAmount, const size_t count, Fn&& work) {
+		size_t chunks = 1;
+		if (scheduler && count >= RC_BILLBOARD_CHUNK_SIZE * 2) {
+			chunks = std::min(threadsAmount, count / RC_BILLBOARD_CHUNK_SIZE);
+		}
+
+		if (chunks == 1) {
+			work(0, count);
+			return;
+		}
+
+		auto job = [&](int chunk) {
+			work(chunk * count / chunks, (chunk + 1) * count / chunks);
+		};
+
+		ThreadGroup* group = scheduler->scheduleWorkIndexed(chunks, job);
+		group->join();
+		delete group;
+	}
+}
+
+void BillboardBatcher::build(DirectX11Handler* handler, ThreadPool* scheduler, const size_t threadsAmount) {
+	this->handler       = handler;
+	this->scheduler     = scheduler;
+	this->threadsAmount = std::max<size_t>(threadsAmount, 1);
+
+	this->sorter.build(scheduler, threadsAmount);
+	this->shaders.build(handler, BillboardVertexShaderSource, BillboardPixelShaderSource, { "ALPHA_CUTOUT" });
+}
+
+void BillboardBatcher::submit(const Texture* texture, const Billboard& billboard) {
+	this->submit(texture, &billboard, 1);
+}
+void BillboardBatcher::submit(const Texture* texture, const Billboard* billboards, const size_t count) {
+	if (!texture || count == 0) return;
+
+	auto found = this->textureIds.find(texture);
+	if (found == this->textureIds.end()) {
+		found = this->textureIds.emplace(texture, static_cast<uint32_t>(this->textures.size())).first;
+		this->textures.push_back(texture);
+	}
+
+	this->billboards.insert(this->billboards.end(), billboards, billboards + count);
+	this->textureOf.insert(this->textureOf.end(), count, found->second);
+}
+
+void BillboardBatcher::reserveQuads(const size_t count) {
+	if (count <= this->quadCapacity) return;
+
+	size_t capacity = std::max<size_t>(this->quadCapacity, 1024);
+	while (capacity < count) capacity *= 2;
+
+	std::vector<uint32_t> indices(capacity * 6);
+	for (uint32_t quad = 0; quad < capacity; quad++) {
+		const uint32_t base = quad * 4;
+		uint32_t*      at   = indices.data() + quad * 6;
+		at[0] = base;
+		at[1] = base + 1;
+		at[2] = base + 2;
+		at[3] = base + 2;
+		at[4] = base + 3;
+		at[5] = base;
+	}
+
+	this->handler->createIndexArrayBuffer(&this->quadIndexBuffer, indices);
+	this->quadCapacity = capacity;
+}
+
+void BillboardBatcher::record(CommandList& list, const DirectX::XMMATRIX& view, const DirectX::XMVECTOR& cameraPosition) {
+	const auto start = std::chrono::high_resolution_clock::now();
+
+	const size_t count = this->billboards.size();
+
+	this->stats            = {};
+	this->stats.billboards = count;
+	this->stats.textures   = this->textures.size();
+
+	if (count == 0) return;
+
+	// The camera basis is read once, the columns of the view rotation are its axes in world space
+	DirectX::XMFLOAT4X4 viewRows;
+	DirectX::XMStoreFloat4x4(&viewRows, view);
+	const DirectX::XMFLOAT3 right(viewRows.m[0][0], viewRows.m[1][0], viewRows.m[2][0]);
+	const DirectX::XMFLOAT3 up(viewRows.m[0][1], viewRows.m[1][1], viewRows.m[2][1]);
+	const DirectX::XMFLOAT3 forward(viewRows.m[0][2], viewRows.m[1][2], viewRows.m[2][2]);
+
+	DirectX::XMFLOAT3 eye;
+	DirectX::XMStoreFloat3(&eye, cameraPosition);
+
+	// Texture first so each one is a contiguous range, then farthest first inside it
+	this->keys.resize(count);
+	this->order.resize(count);
+	runChunks(this->scheduler, this->threadsAmount, count, [&](const size_t begin, const size_t end) {
+		for (size_t i = begin; i < end; i++) {
+			const DirectX::XMFLOAT3& position = this->billboards[i].position;
+
+			const float depth = (position.x - eye.x) * forward.x + (position.y - eye.y) * forward.y + (position.z - eye.z) * forward.z;
+			// Non negative floats order like their bits
+			const uint32_t depthBits = std::bit_cast<uint32_t>(std::max(depth, 0.0f));
+
+			this->keys[i]  = (static_cast<uint64_t>(this->textureOf[i]) << 32) | (UINT32_MAX - depthBits);
+			this->order[i] = static_cast<uint32_t>(i);
+		}
+	});
+	this->sorter.sort(this->keys.data(), this->order.data(), count);
+
+	Vertex* vertices = this->handler->beginDynamicVertices(static_cast<UINT>(count * 4));
+	if (!vertices) {
+		this->clear();
+		return;
+	}
+
+	runChunks(this->scheduler, this->threadsAmount, count, [&](const size_t begin, const size_t end) {
+		const DirectX::XMFLOAT3 normal(-forward.x, -forward.y, -forward.z);
+
+		for (size_t i = begin; i < end; i++) {
+			const Billboard& billboard = this->billboards[this->order[i]];
+
+			const float halfWidth  = billboard.size.x * 0.5f;
+			const float halfHeight = billboard.size.y * 0.5f;
+			const DirectX::XMFLOAT3 across(right.x * halfWidth, right.y * halfWidth, right.z * halfWidth);
+			const DirectX::XMFLOAT3 along(up.x * halfHeight, up.y * halfHeight, up.z * halfHeight);
+			const DirectX::XMFLOAT3& center = billboard.position;
+
+			// Written in order, the mapped buffer is write combined
+			Vertex* quad = vertices + i * 4;
+			quad[0] = { { center.x - across.x - along.x, center.y - across.y - along.y, center.z - across.z - along.z }, normal, { 0.0f, 1.0f } };
+			quad[1] = { { center.x - across.x + along.x, center.y - across.y + along.y, center.z - across.z + along.z }, normal, { 0.0f, 0.0f } };
+			quad[2] = { { center.x + across.x + along.x, center.y + across.y + along.y, center.z + across.z + along.z }, normal, { 1.0f, 0.0f } };
+			quad[3] = { { center.x + across.x - along.x, center.y + across.y - along.y, center.z + across.z - along.z }, normal, { 1.0f, 1.0f } };
+		}
+	});
+	this->handler->endDynamicVertices();
+
+	this->reserveQuads(count);
+
+	this->batches.clear();
+	for (size_t i = 0; i < count; i++) {
+		const uint32_t texture = static_cast<uint32_t>(this->keys[i] >> 32);
+		if (this->batches.empty() || this->batches.back().texture != this->textures[texture]) {
+			this->batches.push_back({ this->textures[texture], static_cast<uint32_t>(i), 0 });
+		}
+		this->batches.back().count++;
+	}
+
+	const auto shader = this->shaders.get(this->alphaCutout ? this->shaders.keyword("ALPHA_CUTOUT") : 0);
+
+	list.setBlend(!this->alphaCutout);
+	list.setPipeline(shader->vertexShader.Get(), shader->pixelShader.Get(), shader->inputLayout.Get());
+	list.setGeometry(this->handler->getDynamicVertexBuffer(), this->quadIndexBuffer.Get(), sizeof(Vertex), false);
+	for (const TextureBatch& batch : this->batches) {
+		list.setTexture(0, batch.texture->texture.Get());
+		list.draw(batch.count * 6, batch.first * 6);
+	}
+
+	this->stats.draws             = this->batches.size();
+	this->stats.buildMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+	this->clear();
+}
+
+void BillboardBatcher::clear() {
+	this->billboards.clear();
+	this->textureOf.clear();
+	this->textureIds.clear();
+	this->textures.clear();
+}
\ No newline at end of file
@@ -0,0 +1,77 @@
+#include "Bounds.h"
+
+Bounds computeBounds(const DirectX::XMFLOAT3* positions, const size_t count, const size_t stride) {
+	Bounds bounds = {};
+	if (count == 0) return bounds;
+
+	const auto* bytes = reinterpret_cast<const uint8_t*>(positions);
+	auto position = [&](const size_t i) { return reinterpret_cast<const float*>(bytes + i * stride); };
+
+	// A wide load reads one float past the position, which is only out of range for the last of packed positions
+	const size_t wide = stride >= sizeof(float) * 4 ? count : count - 1;
+
+	const float* last = position(count - 1);
+	__m128 minimum    = _mm_setr_ps(last[0], last[1], last[2], 0.0f);
+	__m128 maximum    = minimum;
+
+	size_t i = 0;
+	for (; i + 2 <= wide; i += 2) {
+		const __m128 a = _mm_loadu_ps(position(i));
+		const __m128 b = _mm_loadu_ps(position(i + 1));
+		minimum = _mm_min_ps(minimum, _mm_min_ps(a, b));
+		maximum = _mm_max_ps(maximum, _mm_max_ps(a, b));
+	}
+	for (; i < wide; i++) {
+		const __m128 a = _mm_loadu_ps(position(i));
+		minimum = _mm_min_ps(minimum, a);
+		maximum = _mm_max_ps(maximum, a);
+	}
+
+	const __m128 half    = _mm_set1_ps(0.5f);
+	const __m128 center  = _mm_mul_ps(_mm_add_ps(minimum, maximum), half);
+	const __m128 extents = _mm_mul_ps(_mm_sub_ps(maximum, minimum), half);
+
+	alignas(16) float centerLanes[4];
+	alignas(16) float extentLanes[4];
+	_mm_store_ps(centerLanes, center);
+	_mm_store_ps(extentLanes, extents);
+
+	bounds.center  = DirectX::XMFLOAT3(centerLanes[0], centerLanes[1], centerLanes[2]);
+	bounds.extents = DirectX::XMFLOAT3(extentLanes[0], extentLanes[1], extentLanes[2]);
+
+	// Farthest vertex from the box center, four vertices per step after transposing them into x, y and z rows
+	const __m128 centerX = _mm_set1_ps(centerLanes[0]);
+	const __m128 centerY = _mm_set1_ps(centerLanes[1]);
+	const __m128 centerZ = _mm_set1_ps(centerLanes[2]);
+
+	__m128 farthest = _mm_setzero_ps();
+
+	i = 0;
+	for (; i + 4 <= wide; i += 4) {
+		__m128 x = _mm_loadu_ps(position(i));
+		__m128 y = _mm_loadu_ps(position(i + 1));
+		__m128 z = _mm_loadu_ps(position(i + 2));
+		__m128 w = _mm_loadu_ps(position(i + 3));
+		_MM_TRANSPOSE4_PS(x, y, z, w);
+
+		const __m128 dx = _mm_sub_ps(x, centerX);
+		const __m128 dy = _mm_sub_ps(y, centerY);
+		const __m128 dz = _mm_sub_ps(z, centerZ);
+		farthest = _mm_max_ps(farthest, _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+	}
+
+	alignas(16) float farthestLanes[4];
+	_mm_store_ps(farthestLanes, farthest);
+
+	float radiusSquared = std::max(std::max(farthestLanes[0], farthestLanes[1]), std::max(farthestLanes[2], farthestLanes[3]));
+	for (; i < count; i++) {
+		const float* p  = position(i);
+		const float  dx = p[0] - centerLanes[0];
+		const float  dy = p[1] - centerLanes[1];
+		const float  dz = p[2] - centerLanes[2];
+		radiusSquared = std::max(radiusSquared, dx * dx + dy * dy + dz * dz);
+	}
+
+	bounds.radius = sqrtf(radiusSquared);
+	return bounds;
+}
\ No newline at end of file
@@ -0,0 +1,130 @@
+#include "Compression.h"
+
+#include <cstring>
+#include <algorithm>
+
+namespace {
+	constexpr uint32_t RC_LZ_HASH_BITS = 14;
+
+	// A sequence is a token, extended literal length, literals, offset, extended match length.
+	// The token holds the literal length in its high nibble and the match length past the minimum in its low one.
+	void writeLength(std::vector<uint8_t>& out, size_t length) {
+		while (length >= 255) {
+			out.push_back(255);
+			length -= 255;
+		}
+		out.push_back(static_cast<uint8_t>(length));
+	}
+
+	bool readLength(const uint8_t*& at, const uint8_t* end, size_t& length) {
+		uint8_t byte;
+		do {
+			if (at == end) return false;
+			byte    = *at++;
+			length += byte;
+		} while (byte == 255);
+		return true;
+	}
+
+	void writeSequence(std::vector<uint8_t>& out, const uint8_t* literals, const size_t literalLength, const size_t offset, const size_t matchLength) {
+		const size_t extraMatch = matchLength ? matchLength - RC_LZ_MIN_MATCH : 0;
+
+		out.push_back(static_cast<uint8_t>((std::min<size_t>(literalLength, 15) << 4) | std::min<size_t>(extraMatch, 15)));
+		if (literalLength >= 15) writeLength(out, literalLength - 15);
+		out.insert(out.end(), literals, literals + literalLength);
+
+		// The last sequence has literals only and ends the stream
+		if (!matchLength) return;
+
+		out.push_back(static_cast<uint8_t>(offset));
+		out.push_back(static_cast<uint8_t>(offset >> 8));
+		if (extraMatch >= 15) writeLength(out, extraMatch - 15);
+	}
+
+	uint32_t hashOf(const uint8_t* at) {
+		uint32_t word;
+		memcpy(&word, at, sizeof(uint32_t));
+		return (word * 2654435761u) >> (32 - RC_LZ_HASH_BITS);
+	}
+}
+
+std::vector<uint8_t> lzCompress(const void* data, const size_t size) {
+	const uint8_t* input = static_cast<const uint8_t*>(data);
+
+	std::vector<uint8_t> out;
+	out.reserve(size / 2 + 16);
+
+	// Last position each hash was seen at, plus one so zero means never
+	std::vector<uint32_t> table(size_t(1) << RC_LZ_HASH_BITS, 0);
+
+	size_t literalStart = 0;
+	size_t at           = 0;
+	while (at + RC_LZ_MIN_MATCH <= size) {
+		const uint32_t hash      = hashOf(input + at);
+		const size_t   candidate = table[hash];
+		table[hash] = static_cast<uint32_t>(at + 1);
+
+		if (candidate == 0 || at - (candidate - 1) > RC_LZ_WINDOW || memcmp(input + candidate - 1, input + at, RC_LZ_MIN_MATCH) != 0) {
+			at++;
+			continue;
+		}
+
+		const size_t from   = candidate - 1;
+		size_t       length = RC_LZ_MIN_MATCH;
+		while (at + length < size && input[from + length] == input[at + length]) length++;
+
+		writeSequence(out, input + literalStart, at - literalStart, at - from, length);
+
+		// Index a few positions inside the match so the next ones can refer to it
+		const size_t next = at + length;
+		for (size_t i = at + 1; i + RC_LZ_MIN_MATCH <= size && i < next; i += 2) table[hashOf(input + i)] = static_cast<uint32_t>(i + 1);
+
+		at           = next;
+		literalStart = next;
+	}
+
+	writeSequence(out, input + literalStart, size - literalStart, 0, 0);
+	out.shrink_to_fit();
+	return out;
+}
+
+bool lzDecompress(const uint8_t* data, const size_t compressedSize, void* out, const size_t size) {
+	const uint8_t* at       = data;
+	const uint8_t* end      = data + compressedSize;
+	uint8_t*       output   = static_cast<uint8_t*>(out);
+	size_t         produced = 0;
+
+	while (at < end) {
+		const uint8_t token = *at++;
+
+		size_t literalLength = token >> 4;
+		if (literalLength == 15 && !readLength(at, end, literalLength)) return false;
+		if (literalLength > static_cast<size_t>(end - at) || literalLength > size - produced) return false;
+
+		memcpy(output + produced, at, literalLength);
+		at       += literalLength;
+		produced += literalLength;
+
+		if (at == end) break;
+
+		if (end - at < 2) return false;
+		const size_t offset = at[0] | (static_cast<size_t>(at[1]) << 8);
+		at += 2;
+
+		size_t matchLength = token & 15;
+		if (matchLength == 15 && !readLength(at, end, matchLength)) return false;
+		matchLength += RC_LZ_MIN_MATCH;
+
+		if (offset == 0 || offset > produced || matchLength > size - produced) return false;
+
+		// A match may overlap the bytes it produces, so it is copied at most offset bytes at a time
+		for (size_t left = matchLength; left > 0;) {
+			const size_t step = std::min(left, offset);
+			memcpy(output + produced, output + produced - offset, step);
+			produced += step;
+			left     -= step;
+		}
+	}
+
+	return produced == size;
+}
\ No newline at end of file
@@ -0,0 +1,71 @@
+#include "DrawSort.h"
+
+void DrawSorter::sort(uint64_t* keys, uint32_t* values, const size_t count) {
+	if (count < 2) return;
+
+	this->keysScratch.resize(count);
+	this->valuesScratch.resize(count);
+
+	size_t chunks = 1;
+	if (this->scheduler && count >= RC_PARALLEL_SORT_THRESHOLD) {
+		chunks = std::min(this->threadsAmount, count / (RC_PARALLEL_SORT_THRESHOLD / 4));
+		chunks = std::max<size_t>(chunks, 1);
+	}
+	this->histograms.resize(chunks);
+
+	uint64_t* sourceKeys        = keys;
+	uint32_t* sourceValues      = values;
+	uint64_t* destinationKeys   = this->keysScratch.data();
+	uint32_t* destinationValues = this->valuesScratch.data();
+
+	auto chunkBegin = [count, chunks](const size_t chunk) { return chunk * count / chunks; };
+
+	for (uint32_t shift = 0; shift < 64; shift += 8) {
+		auto countDigits = [&](int chunk) {
+			Histogram& histogram = this->histograms[chunk];
+			histogram.fill(0);
+
+			const size_t end = chunkBegin(chunk + 1);
+			for (size_t i = chunkBegin(chunk); i < end; i++) {
+				histogram[(sourceKeys[i] >> shift) & 0xFF]++;
+			}
+		};
+		this->run(chunks, countDigits);
+
+		// Turn the counts into each chunk's first write position per digit, chunks of one digit stay in order
+		uint32_t offset    = 0;
+		bool     sameDigit = false;
+		for (uint32_t digit = 0; digit < 256; digit++) {
+			const uint32_t digitStart = offset;
+			for (auto& histogram : this->histograms) {
+				const uint32_t amount = histogram[digit];
+				histogram[digit]      = offset;
+				offset               += amount;
+			}
+			if (offset - digitStart == count) sameDigit = true;
+		}
+		// Every key has the same digit here, the pass would only copy
+		if (sameDigit) continue;
+
+		auto scatter = [&](int chunk) {
+			Histogram& histogram = this->histograms[chunk];
+
+			const size_t end = chunkBegin(chunk + 1);
+			for (size_t i = chunkBegin(chunk); i < end; i++) {
+				const uint32_t position = histogram[(sourceKeys[i] >> shift) & 0xFF]++;
+
+				destinationKeys[position]   = sourceKeys[i];
+				destinationValues[position] = sourceValues[i];
+			}
+		};
+		this->run(chunks, scatter);
+
+		std::swap(sourceKeys, destinationKeys);
+		std::swap(sourceValues, destinationValues);
+	}
+
+	if (sourceKeys != keys) {
+		memcpy(keys, sourceKeys, count * sizeof(uint64_t));
+		memcpy(values, sourceValues, count * sizeof(uint32_t));
+	}
+}
\ No newline at end of file
@@ -0,0 +1,193 @@
+#include "Frustum.h"
+
+#include <bit>
+
+namespace {
+	bool sphereVisible(const Frustum& frustum, const CullBounds& bounds, const size_t i) {
+		for (const auto& plane : frustum.planes) {
+			const float distance = plane.x * bounds.centerX[i] + plane.y * bounds.centerY[i] + plane.z * bounds.centerZ[i] + plane.w;
+			if (distance < -bounds.radius[i]) return false;
+		}
+		return true;
+	}
+	bool boxVisible(const Frustum& frustum, const CullBounds& bounds, const size_t i) {
+		for (const auto& plane : frustum.planes) {
+			const float distance = plane.x * bounds.centerX[i] + plane.y * bounds.centerY[i] + plane.z * bounds.centerZ[i] + plane.w;
+			const float reach    = fabsf(plane.x) * bounds.extentX[i] + fabsf(plane.y) * bounds.extentY[i] + fabsf(plane.z) * bounds.extentZ[i];
+			if (distance < -reach) return false;
+		}
+		return true;
+	}
+
+	size_t cullTail(const Frustum& frustum, const CullBounds& bounds, const size_t begin, const size_t end, uint32_t* out) {
+		const bool boxes = bounds.hasBoxes();
+
+		size_t count = 0;
+		for (size_t i = begin; i < end; i++) {
+			if (!sphereVisible(frustum, bounds, i)) continue;
+			if (boxes && !boxVisible(frustum, bounds, i)) continue;
+			out[count++] = static_cast<uint32_t>(i);
+		}
+		return count;
+	}
+
+	// Appends the lanes set in mask, lowest first
+	size_t emitLanes(unsigned int mask, const size_t base, uint32_t* out) {
+		size_t count = 0;
+		while (mask) {
+			out[count++] = static_cast<uint32_t>(base + std::countr_zero(mask));
+			mask &= mask - 1;
+		}
+		return count;
+	}
+
+#if defined(__AVX2__)
+	size_t cullWide(const Frustum& frustum, const CullBounds& bounds, const size_t begin, const size_t end, uint32_t* out, size_t* processedEnd) {
+		const bool boxes = bounds.hasBoxes();
+
+		__m256 planeX[6], planeY[6], planeZ[6], planeW[6];
+		__m256 absX[6], absY[6], absZ[6];
+		for (int p = 0; p < 6; p++) {
+			planeX[p] = _mm256_set1_ps(frustum.planes[p].x);
+			planeY[p] = _mm256_set1_ps(frustum.planes[p].y);
+			planeZ[p] = _mm256_set1_ps(frustum.planes[p].z);
+			planeW[p] = _mm256_set1_ps(frustum.planes[p].w);
+			absX[p]   = _mm256_set1_ps(fabsf(frustum.planes[p].x));
+			absY[p]   = _mm256_set1_ps(fabsf(frustum.planes[p].y));
+			absZ[p]   = _mm256_set1_ps(fabsf(frustum.planes[p].z));
+		}
+		const __m256 zero = _mm256_setzero_ps();
+
+		size_t count = 0;
+		size_t i     = begin;
+		for (; i + 8 <= end; i += 8) {
+			const __m256 x         = _mm256_loadu_ps(bounds.centerX.data() + i);
+			const __m256 y         = _mm256_loadu_ps(bounds.centerY.data() + i);
+			const __m256 z         = _mm256_loadu_ps(bounds.centerZ.data() + i);
+			const __m256 negRadius = _mm256_sub_ps(zero, _mm256_loadu_ps(bounds.radius.data() + i));
+
+			__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+			for (int p = 0; p < 6; p++) {
+				const __m256 distance = _mm256_fmadd_ps(x, planeX[p], _mm256_fmadd_ps(y, planeY[p], _mm256_fmadd_ps(z, planeZ[p], planeW[p])));
+				inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negRadius, _CMP_GE_OQ));
+			}
+
+			if (boxes && _mm256_movemask_ps(inside)) {
+				const __m256 ex = _mm256_loadu_ps(bounds.extentX.data() + i);
+				const __m256 ey = _mm256_loadu_ps(bounds.extentY.data() + i);
+				const __m256 ez = _mm256_loadu_ps(bounds.extentZ.data() + i);
+
+				for (int p = 0; p < 6; p++) {
+					const __m256 distance = _mm256_fmadd_ps(x, planeX[p], _mm256_fmadd_ps(y, planeY[p], _mm256_fmadd_ps(z, planeZ[p], planeW[p])));
+					const __m256 reach    = _mm256_fmadd_ps(ex, absX[p], _mm256_fmadd_ps(ey, absY[p], _mm256_mul_ps(ez, absZ[p])));
+					inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, reach), zero, _CMP_GE_OQ));
+				}
+			}
+
+			count += emitLanes(static_cast<unsigned int>(_mm256_movemask_ps(inside)), i, out + count);
+		}
+
+		*processedEnd = i;
+		return count;
+	}
+#else
+	size_t cullWide(const Frustum& frustum, const CullBounds& bounds, const size_t begin, const size_t end, uint32_t* out, size_t* processedEnd) {
+		const bool boxes = bounds.hasBoxes();
+
+		__m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+		__m128 absX[6], absY[6], absZ[6];
+		for (int p = 0; p < 6; p++) {
+			planeX[p] = _mm_set1_ps(frustum.planes[p].x);
+			planeY[p] = _mm_set1_ps(frustum.planes[p].y);
+			planeZ[p] = _mm_set1_ps(frustum.planes[p].z);
+			planeW[p] = _mm_set1_ps(frustum.planes[p].w);
+			absX[p]   = _mm_set1_ps(fabsf(frustum.planes[p].x));
+			absY[p]   = _mm_set1_ps(fabsf(frustum.planes[p].y));
+			absZ[p]   = _mm_set1_ps(fabsf(frustum.planes[p].z));
+		}
+		const __m128 zero = _mm_setzero_ps();
+
+		size_t count = 0;
+		size_t i     = begin;
+		for (; i + 4 <= end; i += 4) {
+			const __m128 x         = _mm_loadu_ps(bounds.centerX.data() + i);
+			const __m128 y         = _mm_loadu_ps(bounds.centerY.data() + i);
+			const __m128 z         = _mm_loadu_ps(bounds.centerZ.data() + i);
+			const __m128 negRadius = _mm_sub_ps(zero, _mm_loadu_ps(bounds.radius.data() + i));
+
+			__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (int p = 0; p < 6; p++) {
+				const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, planeX[p]), _mm_mul_ps(y, planeY[p])),
+												   _mm_add_ps(_mm_mul_ps(z, planeZ[p]), planeW[p]));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+			}
+
+			if (boxes && _mm_movemask_ps(inside)) {
+				const __m128 ex = _mm_loadu_ps(bounds.extentX.data() + i);
+				const __m128 ey = _mm_loadu_ps(bounds.extentY.data() + i);
+				const __m128 ez = _mm_loadu_ps(bounds.extentZ.data() + i);
+
+				for (int p = 0; p < 6; p++) {
+					const __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, planeX[p]), _mm_mul_ps(y, planeY[p])),
+													   _mm_add_ps(_mm_mul_ps(z, planeZ[p]), planeW[p]));
+					const __m128 reach    = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ex, absX[p]), _mm_mul_ps(ey, absY[p])), _mm_mul_ps(ez, absZ[p]));
+					inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, reach), zero));
+				}
+			}
+
+			count += emitLanes(static_cast<unsigned int>(_mm_movemask_ps(inside)), i, out + count);
+		}
+
+		*processedEnd = i;
+		return count;
+	}
+#endif
+}
+
+size_t cullRange(const Frustum& frustum, const CullBounds& bounds, const size_t begin, const size_t end, uint32_t* out) {
+	size_t processedEnd = begin;
+	size_t count        = cullWide(frustum, bounds, begin, end, out, &processedEnd);
+
+	return count + cullTail(frustum, bounds, processedEnd, end, out + count);
+}
+
+const std::vector<uint32_t>& FrustumCuller::cull(const Frustum& frustum, const CullBounds& bounds) {
+	const size_t count = bounds.size();
+	this->visible.resize(count);
+
+	size_t chunks = 1;
+	if (this->scheduler && count >= RC_CULL_CHUNK_SIZE * 2) {
+		chunks = std::min(this->threadsAmount, count / RC_CULL_CHUNK_SIZE);
+	}
+
+	if (chunks == 1) {
+		this->visible.resize(cullRange(frustum, bounds, 0, count, this->visible.data()));
+		return this->visible;
+	}
+
+	// Chunks cull into their own lists, which are then joined in order
+	this->chunkVisible.resize(chunks);
+	this->chunkCounts.resize(chunks);
+
+	auto work = [&](int chunk) {
+		const size_t begin = chunk * count / chunks;
+		const size_t end   = (chunk + 1) * count / chunks;
+
+		auto& list = this->chunkVisible[chunk];
+		list.resize(end - begin);
+		this->chunkCounts[chunk] = cullRange(frustum, bounds, begin, end, list.data());
+	};
+
+	ThreadGroup* group = this->scheduler->scheduleWorkIndexed(chunks, work);
+	group->join();
+	delete group;
+
+	size_t written = 0;
+	for (size_t chunk = 0; chunk < chunks; chunk++) {
+		memcpy(this->visible.data() + written, this->chunkVisible[chunk].data(), this->chunkCounts[chunk] * sizeof(uint32_t));
+		written += this->chunkCounts[chunk];
+	}
+	this->visible.resize(written);
+
+	return this->visible;
+}
\ No newline at end of file
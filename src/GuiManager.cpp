@@ -3,6 +3,9 @@
 #include "Window.h"
 #include "DirectX11Handler.h"
 
+#include <algorithm>
+
+#ifndef RC_HEADLESS
 GuiManager::~GuiManager() {
     // Cleanup ImGui
     if (ImGui::GetCurrentContext()) {
@@ -53,4 +56,40 @@ void GuiManager::render() {
     if (drawData) {
         ImGui_ImplDX11_RenderDrawData(drawData);
     }
-}
\ No newline at end of file
+}
+#else
+// ImGui itself runs, so the interface code keeps its CPU cost, but there is no platform or renderer backend
+GuiManager::~GuiManager() {
+    if (ImGui::GetCurrentContext()) ImGui::DestroyContext();
+}
+
+void GuiManager::build(Window* window, DirectX11Handler*) {
+    this->window = window;
+
+    IMGUI_CHECKVERSION();
+    ImGui::CreateContext();
+    ImGui::StyleColorsDark();
+
+    // A backend would upload the font atlas, building it is enough for NewFrame
+    unsigned char* pixels;
+    int            width;
+    int            height;
+    ImGui::GetIO().Fonts->AddFontDefault();
+    ImGui::GetIO().Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+}
+
+void GuiManager::createNewFrame(std::function<void(void*)> function, void* param) {
+    ImGuiIO& io    = ImGui::GetIO();
+    io.DisplaySize = ImVec2(static_cast<float>(this->window->width), static_cast<float>(this->window->height));
+    io.DeltaTime   = std::max(RCTime::deltaTime(), 1.0f / 1000.0f);
+
+    ImGui::NewFrame();
+
+    function(param);
+
+    ImGui::Render();
+}
+
+// The draw data is dropped
+void GuiManager::render() {}
+#endif
\ No newline at end of file
@@ -6,6 +6,7 @@ void InputManager::build(Window* window) {
 	this->window = window;
 }
 
+#ifndef RC_HEADLESS
 void InputManager::update() {
 	MSG msg;
 	while (PeekMessage(&msg, this->window->hWnd, 0, 0, PM_REMOVE)) {
@@ -26,4 +27,13 @@ BOOL InputManager::poolEvents() {
 		DispatchMessage(&this->msg);
 	}
 	return returnValue;
-}
\ No newline at end of file
+}
+#else
+void InputManager::update() {}
+
+// The only event without a window is the quit requested through Window::close
+BOOL InputManager::poolEvents() {
+	if (this->window->shouldQuit()) this->squit = true;
+	return FALSE;
+}
+#endif
\ No newline at end of file
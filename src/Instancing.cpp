@@ -0,0 +1,47 @@
+#include "Instancing.h"
+
+namespace {
+	bool canMerge(const InstanceGroupKey& a, const InstanceGroupKey& b) {
+		return a.instanced && b.instanced && a.mergeable && b.mergeable &&
+			   a.shader == b.shader && a.texture == b.texture && a.mesh == b.mesh && a.pass == b.pass && a.lod == b.lod;
+	}
+}
+
+const std::vector<DrawBatch>& InstanceBatcher::build(const uint32_t* order, const size_t count, const InstanceGroupKey* groups) {
+	this->batches.clear();
+	this->instanceCount = 0;
+
+	size_t i = 0;
+	while (i < count) {
+		const InstanceGroupKey& group = groups[order[i]];
+
+		DrawBatch batch = {};
+		batch.first     = static_cast<uint32_t>(i);
+		batch.count     = 1;
+		batch.instanced = group.instanced;
+
+		while (i + batch.count < count && batch.count < this->maxBatchSize && canMerge(group, groups[order[i + batch.count]])) {
+			batch.count++;
+		}
+
+		if (batch.instanced) {
+			batch.instanceOffset = this->instanceCount;
+			this->instanceCount += batch.count;
+		}
+
+		this->batches.push_back(batch);
+		i += batch.count;
+	}
+
+	return this->batches;
+}
+
+void InstanceBatcher::pack(const uint32_t* order, const InstanceData* drawInstances, InstanceData* out) const {
+	for (const auto& batch : this->batches) {
+		if (!batch.instanced) continue;
+
+		for (uint32_t i = 0; i < batch.count; i++) {
+			out[batch.instanceOffset + i] = drawInstances[order[batch.first + i]];
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,283 @@
+#include "MeshSimplifier.h"
+
+#include <numeric>
+
+namespace {
+	uint64_t edgeKey(const uint32_t a, const uint32_t b) { return (static_cast<uint64_t>(a) << 32) | b; }
+
+	DirectX::XMFLOAT3 faceNormal(const DirectX::XMFLOAT3& p0, const DirectX::XMFLOAT3& p1, const DirectX::XMFLOAT3& p2) {
+		const float ux = p1.x - p0.x, uy = p1.y - p0.y, uz = p1.z - p0.z;
+		const float vx = p2.x - p0.x, vy = p2.y - p0.y, vz = p2.z - p0.z;
+		return DirectX::XMFLOAT3(uy * vz - uz * vy, uz * vx - ux * vz, ux * vy - uy * vx);
+	}
+}
+
+void MeshSimplifier::prepare(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices) {
+	const size_t vertexCount = vertices.size();
+
+	// An edge walked in only one direction is an open border, or a seam where the vertices were split for their attributes
+	this->edges.clear();
+	for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+		this->edges.push_back(edgeKey(indices[i], indices[i + 1]));
+		this->edges.push_back(edgeKey(indices[i + 1], indices[i + 2]));
+		this->edges.push_back(edgeKey(indices[i + 2], indices[i]));
+	}
+	std::sort(this->edges.begin(), this->edges.end());
+
+	this->locked.assign(vertexCount, 0);
+	for (const uint64_t key : this->edges) {
+		const uint32_t a = static_cast<uint32_t>(key >> 32);
+		const uint32_t b = static_cast<uint32_t>(key);
+		if (!std::binary_search(this->edges.begin(), this->edges.end(), edgeKey(b, a))) {
+			this->locked[a] = 1;
+			this->locked[b] = 1;
+		}
+	}
+
+	// Every vertex starts with the planes of the faces around it
+	this->quadrics.assign(vertexCount, Quadric{});
+	for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+		const auto& p0 = vertices[indices[i]].position;
+		const auto& p1 = vertices[indices[i + 1]].position;
+		const auto& p2 = vertices[indices[i + 2]].position;
+
+		const DirectX::XMFLOAT3 normal = faceNormal(p0, p1, p2);
+		const double length = sqrt(static_cast<double>(normal.x) * normal.x + static_cast<double>(normal.y) * normal.y + static_cast<double>(normal.z) * normal.z);
+		if (length == 0.0) continue;
+
+		const double a = normal.x / length;
+		const double b = normal.y / length;
+		const double c = normal.z / length;
+		const double d = -(a * p0.x + b * p0.y + c * p0.z);
+
+		const Quadric plane = { a * a, a * b, a * c, a * d, b * b, b * c, b * d, c * c, c * d, d * d };
+		for (int v = 0; v < 3; v++) {
+			Quadric& q = this->quadrics[indices[i + v]];
+			q.a2 += plane.a2; q.ab += plane.ab; q.ac += plane.ac; q.ad += plane.ad;
+			q.b2 += plane.b2; q.bc += plane.bc; q.bd += plane.bd;
+			q.c2 += plane.c2; q.cd += plane.cd;
+			q.d2 += plane.d2;
+		}
+	}
+
+	this->remap.resize(vertexCount);
+	std::iota(this->remap.begin(), this->remap.end(), 0u);
+
+	this->neighbourMarks.assign(vertexCount, 0);
+	this->neighbourMark = 0;
+}
+
+void MeshSimplifier::buildAdjacency(const std::vector<uint32_t>& indices, const size_t vertexCount) {
+	this->adjacencyOffsets.assign(vertexCount + 1, 0);
+	for (const uint32_t index : indices) this->adjacencyOffsets[index + 1]++;
+	for (size_t v = 0; v < vertexCount; v++) this->adjacencyOffsets[v + 1] += this->adjacencyOffsets[v];
+
+	this->adjacency.resize(indices.size());
+	std::vector<uint32_t> cursor(this->adjacencyOffsets.begin(), this->adjacencyOffsets.end() - 1);
+	for (size_t i = 0; i < indices.size(); i++) {
+		this->adjacency[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+	}
+}
+
+bool MeshSimplifier::canCollapse(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const uint32_t from, const uint32_t to) {
+	// More than two shared neighbours means the collapse would fold the surface onto itself
+	this->neighbourMark++;
+	for (uint32_t j = this->adjacencyOffsets[from]; j < this->adjacencyOffsets[from + 1]; j++) {
+		const uint32_t* triangle = indices.data() + this->adjacency[j] * 3;
+		for (int v = 0; v < 3; v++) this->neighbourMarks[triangle[v]] = this->neighbourMark;
+	}
+
+	uint32_t shared = 0;
+	this->neighbourMark++;
+	for (uint32_t j = this->adjacencyOffsets[to]; j < this->adjacencyOffsets[to + 1]; j++) {
+		const uint32_t* triangle = indices.data() + this->adjacency[j] * 3;
+		for (int v = 0; v < 3; v++) {
+			const uint32_t vertex = triangle[v];
+			if (vertex == from || vertex == to || this->neighbourMarks[vertex] != this->neighbourMark - 1) continue;
+
+			this->neighbourMarks[vertex] = this->neighbourMark;
+			shared++;
+		}
+	}
+	if (shared > 2) return false;
+
+	for (uint32_t j = this->adjacencyOffsets[from]; j < this->adjacencyOffsets[from + 1]; j++) {
+		const uint32_t* triangle = indices.data() + this->adjacency[j] * 3;
+		if (triangle[0] == to || triangle[1] == to || triangle[2] == to) continue;
+
+		DirectX::XMFLOAT3 before[3];
+		DirectX::XMFLOAT3 after[3];
+		for (int v = 0; v < 3; v++) {
+			before[v] = vertices[triangle[v]].position;
+			after[v]  = triangle[v] == from ? vertices[to].position : before[v];
+		}
+
+		// Turning a face by more than about 75 degrees counts as a flip, slivers close to flipping are no better
+		const DirectX::XMFLOAT3 n0 = faceNormal(before[0], before[1], before[2]);
+		const DirectX::XMFLOAT3 n1 = faceNormal(after[0], after[1], after[2]);
+
+		const double dot     = static_cast<double>(n0.x) * n1.x + static_cast<double>(n0.y) * n1.y + static_cast<double>(n0.z) * n1.z;
+		const double length0 = static_cast<double>(n0.x) * n0.x + static_cast<double>(n0.y) * n0.y + static_cast<double>(n0.z) * n0.z;
+		const double length1 = static_cast<double>(n1.x) * n1.x + static_cast<double>(n1.y) * n1.y + static_cast<double>(n1.z) * n1.z;
+		if (dot <= 0.25 * sqrt(length0 * length1)) return false;
+	}
+	return true;
+}
+
+void MeshSimplifier::simplify(const std::vector<Vertex>&          vertices,
+							  const std::vector<uint32_t>&        indices,
+							  const std::vector<size_t>&          targets,
+							  std::vector<std::vector<uint32_t>>* outLevels,
+							  std::vector<float>*                 outErrors)
+{
+	outLevels->clear();
+	outErrors->clear();
+	if (targets.empty() || indices.size() < 3) return;
+
+	const size_t vertexCount = vertices.size();
+	this->prepare(vertices, indices);
+
+	auto evaluate = [](const Quadric& q, const DirectX::XMFLOAT3& p) {
+		const double x = p.x, y = p.y, z = p.z;
+		const double error = q.a2 * x * x + 2.0 * q.ab * x * y + 2.0 * q.ac * x * z + 2.0 * q.ad * x
+						   + q.b2 * y * y + 2.0 * q.bc * y * z + 2.0 * q.bd * y
+						   + q.c2 * z * z + 2.0 * q.cd * z
+						   + q.d2;
+		return static_cast<float>(std::max(error, 0.0));
+	};
+
+	std::vector<uint32_t> current = indices;
+	float                 maxError = 0.0f;
+	size_t                target   = 0;
+
+	while (target < targets.size()) {
+		// Each pass collapses the cheapest edges whose neighbourhoods do not overlap, then rewrites the triangles
+		if (current.size() > targets[target]) {
+			this->edges.clear();
+			for (size_t i = 0; i + 2 < current.size(); i += 3) {
+				for (int e = 0; e < 3; e++) {
+					const uint32_t a = current[i + e];
+					const uint32_t b = current[i + (e + 1) % 3];
+					this->edges.push_back(edgeKey(std::min(a, b), std::max(a, b)));
+				}
+			}
+			std::sort(this->edges.begin(), this->edges.end());
+			this->edges.erase(std::unique(this->edges.begin(), this->edges.end()), this->edges.end());
+
+			this->collapses.clear();
+			for (const uint64_t key : this->edges) {
+				const uint32_t a = static_cast<uint32_t>(key >> 32);
+				const uint32_t b = static_cast<uint32_t>(key);
+				if (this->locked[a] && this->locked[b]) continue;
+
+				Quadric q = this->quadrics[a];
+				const Quadric& qb = this->quadrics[b];
+				q.a2 += qb.a2; q.ab += qb.ab; q.ac += qb.ac; q.ad += qb.ad;
+				q.b2 += qb.b2; q.bc += qb.bc; q.bd += qb.bd;
+				q.c2 += qb.c2; q.cd += qb.cd;
+				q.d2 += qb.d2;
+
+				const float ontoB = this->locked[a] ? FLT_MAX : evaluate(q, vertices[b].position);
+				const float ontoA = this->locked[b] ? FLT_MAX : evaluate(q, vertices[a].position);
+
+				if (ontoB <= ontoA) this->collapses.push_back({ a, b, ontoB });
+				else this->collapses.push_back({ b, a, ontoA });
+			}
+			std::sort(this->collapses.begin(), this->collapses.end(), [](const Collapse& l, const Collapse& r) { return l.error < r.error; });
+
+			this->buildAdjacency(current, vertexCount);
+			this->touched.assign(vertexCount, 0);
+
+			const size_t trianglesToRemove = (current.size() - targets[target]) / 3 + 1;
+			size_t       removed           = 0;
+			size_t       applied           = 0;
+
+			for (const auto& collapse : this->collapses) {
+				if (removed >= trianglesToRemove) break;
+				if (this->touched[collapse.from] || this->touched[collapse.to]) continue;
+				if (!this->canCollapse(vertices, current, collapse.from, collapse.to)) continue;
+
+				// The whole ring around the moved vertex is frozen for the pass, its flip test assumed it stays put
+				for (uint32_t j = this->adjacencyOffsets[collapse.from]; j < this->adjacencyOffsets[collapse.from + 1]; j++) {
+					const uint32_t* triangle = current.data() + this->adjacency[j] * 3;
+					this->touched[triangle[0]] = 1;
+					this->touched[triangle[1]] = 1;
+					this->touched[triangle[2]] = 1;
+
+					if (triangle[0] == collapse.to || triangle[1] == collapse.to || triangle[2] == collapse.to) removed++;
+				}
+
+				this->remap[collapse.from] = collapse.to;
+
+				Quadric&       q  = this->quadrics[collapse.to];
+				const Quadric& qf = this->quadrics[collapse.from];
+				q.a2 += qf.a2; q.ab += qf.ab; q.ac += qf.ac; q.ad += qf.ad;
+				q.b2 += qf.b2; q.bc += qf.bc; q.bd += qf.bd;
+				q.c2 += qf.c2; q.cd += qf.cd;
+				q.d2 += qf.d2;
+
+				maxError = std::max(maxError, collapse.error);
+				applied++;
+			}
+
+			if (applied == 0) {
+				// Stuck above the target, what was reached still makes a last level
+				const size_t previous = outLevels->empty() ? indices.size() : outLevels->back().size();
+				if (current.size() < previous) {
+					outLevels->push_back(current);
+					outErrors->push_back(sqrtf(maxError));
+				}
+				break;
+			}
+
+			size_t written = 0;
+			for (size_t i = 0; i + 2 < current.size(); i += 3) {
+				const uint32_t a = this->remap[current[i]];
+				const uint32_t b = this->remap[current[i + 1]];
+				const uint32_t c = this->remap[current[i + 2]];
+				if (a == b || b == c || c == a) continue;
+
+				current[written++] = a;
+				current[written++] = b;
+				current[written++] = c;
+			}
+			current.resize(written);
+			continue;
+		}
+
+		outLevels->push_back(current);
+		outErrors->push_back(sqrtf(maxError));
+		target++;
+	}
+}
+
+std::vector<uint32_t> buildLodChain(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, std::vector<MeshLod>* outLods) {
+	std::vector<uint32_t> chain = indices;
+
+	outLods->clear();
+	outLods->push_back({ 0, static_cast<uint32_t>(indices.size()), 0.0f });
+
+	std::vector<size_t> targets;
+	for (const float ratio : RC_LOD_RATIOS) {
+		const size_t target = static_cast<size_t>(indices.size() / 3 * ratio) * 3;
+		if (target / 3 < RC_LOD_MIN_TRIANGLES) break;
+		targets.push_back(target);
+	}
+	if (targets.empty()) return chain;
+
+	std::vector<std::vector<uint32_t>> levels;
+	std::vector<float>                 errors;
+
+	MeshSimplifier simplifier;
+	simplifier.simplify(vertices, indices, targets, &levels, &errors);
+
+	for (size_t level = 0; level < levels.size(); level++) {
+		// A level that barely shrank is not worth its memory, the ones after it would not shrink either
+		if (levels[level].size() * 10 > outLods->back().indexCount * 9) break;
+
+		outLods->push_back({ static_cast<uint32_t>(chain.size()), static_cast<uint32_t>(levels[level].size()), errors[level] });
+		chain.insert(chain.end(), levels[level].begin(), levels[level].end());
+	}
+
+	return chain;
+}
\ No newline at end of file
@@ -0,0 +1,335 @@
+#include "Occlusion.h"
+
+#include <chrono>
+
+namespace {
+	constexpr float nearW = 1e-4f;
+
+	float edge(const float ax, const float ay, const float bx, const float by, const float px, const float py) {
+		return (bx - ax) * (py - ay) - (by - ay) * (px - ax);
+	}
+}
+
+void OcclusionCuller::build(ThreadPool* scheduler, const size_t threadsAmount, const uint32_t width, const uint32_t height) {
+	this->scheduler     = scheduler;
+	this->threadsAmount = std::max<size_t>(threadsAmount, 1);
+
+	this->width  = (std::max<uint32_t>(width, 4) + 3) & ~3u;
+	this->height = std::max<uint32_t>(height, 1);
+
+	this->pyramid.clear();
+	this->levelSizes.clear();
+
+	uint32_t levelWidth  = this->width;
+	uint32_t levelHeight = this->height;
+	while (true) {
+		this->levelSizes.emplace_back(levelWidth, levelHeight);
+		this->pyramid.emplace_back(static_cast<size_t>(levelWidth) * levelHeight, 1.0f);
+
+		if (levelWidth == 1 && levelHeight == 1) break;
+		levelWidth  = std::max<uint32_t>(levelWidth / 2, 1);
+		levelHeight = std::max<uint32_t>(levelHeight / 2, 1);
+	}
+}
+
+void OcclusionCuller::begin(const DirectX::XMMATRIX& viewProjection) {
+	DirectX::XMStoreFloat4x4(&this->viewProjection, viewProjection);
+	this->triangles.clear();
+
+	this->stats = {};
+}
+
+void OcclusionCuller::addOccluder(const Mesh& mesh, const DirectX::XMMATRIX& world) {
+	if (this->pyramid.empty()) {
+		RC_DBG_ERROR("Occlusion culler used before build");
+		return;
+	}
+
+	// Meshes whose CPU copy was dropped or compressed after upload have nothing to rasterize
+	if (mesh.vertices.empty() || mesh.indices.size() < mesh.indexCount) {
+		this->stats.skippedOccluders++;
+		return;
+	}
+
+	const DirectX::XMMATRIX transform = world * DirectX::XMLoadFloat4x4(&this->viewProjection);
+
+	const float halfWidth  = this->width * 0.5f;
+	const float halfHeight = this->height * 0.5f;
+
+	// Only the full mesh, simplified levels can poke out of the real surface
+	const MeshLod lod = mesh.getLod(0);
+	for (size_t i = lod.firstIndex; i + 2 < lod.firstIndex + lod.indexCount; i += 3) {
+		OccluderTriangle triangle = {};
+
+		bool behind = false;
+		for (int v = 0; v < 3; v++) {
+			const uint32_t index = mesh.indices[i + v];
+			if (index >= mesh.vertices.size()) {
+				behind = true;
+				break;
+			}
+
+			DirectX::XMFLOAT4 clip;
+			DirectX::XMStoreFloat4(&clip, DirectX::XMVector3Transform(DirectX::XMLoadFloat3(&mesh.vertices[index].position), transform));
+			if (clip.w < nearW || clip.z < 0.0f) {
+				behind = true;
+				break;
+			}
+
+			const float inverseW = 1.0f / clip.w;
+			triangle.x[v] = (clip.x * inverseW + 1.0f) * halfWidth;
+			triangle.y[v] = (1.0f - clip.y * inverseW) * halfHeight;
+			triangle.z[v] = clip.z * inverseW;
+		}
+		if (behind) continue;
+
+		const float top    = std::min({ triangle.y[0], triangle.y[1], triangle.y[2] });
+		const float bottom = std::max({ triangle.y[0], triangle.y[1], triangle.y[2] });
+		const float left   = std::min({ triangle.x[0], triangle.x[1], triangle.x[2] });
+		const float right  = std::max({ triangle.x[0], triangle.x[1], triangle.x[2] });
+		if (bottom < 0.0f || top >= this->height || right < 0.0f || left >= this->width) continue;
+
+		triangle.rowMin = std::max(static_cast<int>(top), 0);
+		triangle.rowMax = std::min(static_cast<int>(bottom), static_cast<int>(this->height) - 1);
+
+		this->triangles.push_back(triangle);
+	}
+
+	this->stats.occluderTriangles = this->triangles.size();
+}
+
+void OcclusionCuller::rasterizeBand(const int rowBegin, const int rowEnd) {
+	float* depth = this->pyramid[0].data();
+	std::fill(depth + static_cast<size_t>(rowBegin) * this->width, depth + static_cast<size_t>(rowEnd) * this->width, 1.0f);
+
+	const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128 zero        = _mm_setzero_ps();
+
+	for (const auto& triangle : this->triangles) {
+		if (triangle.rowMax < rowBegin || triangle.rowMin >= rowEnd) continue;
+
+		float x0 = triangle.x[0], y0 = triangle.y[0], z0 = triangle.z[0];
+		float x1 = triangle.x[1], y1 = triangle.y[1], z1 = triangle.z[1];
+		float x2 = triangle.x[2], y2 = triangle.y[2], z2 = triangle.z[2];
+
+		// Both windings are drawn, flipping one makes the edge functions positive inside
+		float area = edge(x0, y0, x1, y1, x2, y2);
+		if (area == 0.0f) continue;
+		if (area < 0.0f) {
+			std::swap(x1, x2);
+			std::swap(y1, y2);
+			std::swap(z1, z2);
+			area = -area;
+		}
+
+		// Edge function i is zero on the edge opposite vertex i, stepping one pixel right adds its x slope
+		const float stepX0 = y1 - y2;
+		const float stepX1 = y2 - y0;
+		const float stepX2 = y0 - y1;
+
+		const float inverseArea = 1.0f / area;
+		const float depthX      = (stepX0 * z0 + stepX1 * z1 + stepX2 * z2) * inverseArea;
+
+		const int columnBegin = std::max(static_cast<int>(std::min({ x0, x1, x2 })), 0) & ~3;
+		const int columnEnd   = std::min(static_cast<int>(std::max({ x0, x1, x2 })) + 1, static_cast<int>(this->width));
+		const int rowFirst    = std::max(triangle.rowMin, rowBegin);
+		const int rowLast     = std::min(triangle.rowMax + 1, rowEnd);
+
+		const __m128 stepX0s = _mm_set1_ps(stepX0), stepX1s = _mm_set1_ps(stepX1), stepX2s = _mm_set1_ps(stepX2);
+		const __m128 depthXs = _mm_set1_ps(depthX);
+		const __m128 step4   = _mm_set1_ps(4.0f);
+
+		for (int row = rowFirst; row < rowLast; row++) {
+			const float py = row + 0.5f;
+			const float px = columnBegin + 0.0f;
+
+			const float w0 = edge(x1, y1, x2, y2, px, py);
+			const float w1 = edge(x2, y2, x0, y0, px, py);
+			const float w2 = edge(x0, y0, x1, y1, px, py);
+			const float zRow = (w0 * z0 + w1 * z1 + w2 * z2) * inverseArea;
+
+			// Values at the centers of the first four pixels, the scalar start sits on their left edge
+			__m128 e0 = _mm_add_ps(_mm_set1_ps(w0), _mm_mul_ps(laneOffsets, stepX0s));
+			__m128 e1 = _mm_add_ps(_mm_set1_ps(w1), _mm_mul_ps(laneOffsets, stepX1s));
+			__m128 e2 = _mm_add_ps(_mm_set1_ps(w2), _mm_mul_ps(laneOffsets, stepX2s));
+			__m128 z  = _mm_add_ps(_mm_set1_ps(zRow), _mm_mul_ps(laneOffsets, depthXs));
+
+			const __m128 e0Step = _mm_mul_ps(step4, stepX0s);
+			const __m128 e1Step = _mm_mul_ps(step4, stepX1s);
+			const __m128 e2Step = _mm_mul_ps(step4, stepX2s);
+			const __m128 zStep  = _mm_mul_ps(step4, depthXs);
+
+			float* depthRow = depth + static_cast<size_t>(row) * this->width;
+			for (int column = columnBegin; column < columnEnd; column += 4) {
+				const __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+
+				if (_mm_movemask_ps(inside)) {
+					const __m128 current = _mm_loadu_ps(depthRow + column);
+					const __m128 nearer  = _mm_min_ps(current, z);
+					_mm_storeu_ps(depthRow + column, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, current)));
+				}
+
+				e0 = _mm_add_ps(e0, e0Step);
+				e1 = _mm_add_ps(e1, e1Step);
+				e2 = _mm_add_ps(e2, e2Step);
+				z  = _mm_add_ps(z, zStep);
+			}
+		}
+	}
+}
+
+void OcclusionCuller::buildPyramid() {
+	for (size_t level = 1; level < this->pyramid.size(); level++) {
+		const auto& below     = this->pyramid[level - 1];
+		const auto  belowSize = this->levelSizes[level - 1];
+		auto&       current   = this->pyramid[level];
+		const auto  size      = this->levelSizes[level];
+
+		for (uint32_t y = 0; y < size.y; y++) {
+			const uint32_t y0 = std::min(y * 2, belowSize.y - 1);
+			const uint32_t y1 = std::min(y * 2 + 1, belowSize.y - 1);
+
+			for (uint32_t x = 0; x < size.x; x++) {
+				const uint32_t x0 = std::min(x * 2, belowSize.x - 1);
+				const uint32_t x1 = std::min(x * 2 + 1, belowSize.x - 1);
+
+				current[y * size.x + x] = std::max(std::max(below[y0 * belowSize.x + x0], below[y0 * belowSize.x + x1]),
+												   std::max(below[y1 * belowSize.x + x0], below[y1 * belowSize.x + x1]));
+			}
+		}
+	}
+}
+
+void OcclusionCuller::rasterize() {
+	if (this->pyramid.empty()) {
+		RC_DBG_ERROR("Occlusion culler used before build");
+		return;
+	}
+
+	const auto rasterStart = std::chrono::high_resolution_clock::now();
+
+	size_t bands = 1;
+	if (this->scheduler && this->triangles.size() > 64) {
+		bands = std::min<size_t>(this->threadsAmount * 2, this->height / 4);
+		bands = std::max<size_t>(bands, 1);
+	}
+
+	// Bands own disjoint rows, so no two threads write the same pixel
+	auto work = [&](int band) {
+		this->rasterizeBand(static_cast<int>(band * this->height / bands), static_cast<int>((band + 1) * this->height / bands));
+	};
+	this->run(bands, work);
+
+	this->buildPyramid();
+
+	this->stats.rasterMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - rasterStart).count();
+}
+
+bool OcclusionCuller::visible(const DirectX::XMFLOAT3& center, const DirectX::XMFLOAT3& extents) const {
+	if (this->pyramid.empty()) return true;
+
+	const DirectX::XMMATRIX viewProjection = DirectX::XMLoadFloat4x4(&this->viewProjection);
+
+	float left   = FLT_MAX, right  = -FLT_MAX;
+	float top    = FLT_MAX, bottom = -FLT_MAX;
+	float nearest = FLT_MAX;
+
+	for (int corner = 0; corner < 8; corner++) {
+		const DirectX::XMVECTOR point = DirectX::XMVectorSet(center.x + (corner & 1 ? extents.x : -extents.x),
+															 center.y + (corner & 2 ? extents.y : -extents.y),
+															 center.z + (corner & 4 ? extents.z : -extents.z), 1.0f);
+
+		DirectX::XMFLOAT4 clip;
+		DirectX::XMStoreFloat4(&clip, DirectX::XMVector4Transform(point, viewProjection));
+
+		// Reaches behind the camera, the screen rectangle is unbounded
+		if (clip.w < nearW) return true;
+
+		const float inverseW = 1.0f / clip.w;
+		const float x        = (clip.x * inverseW + 1.0f) * this->width * 0.5f;
+		const float y        = (1.0f - clip.y * inverseW) * this->height * 0.5f;
+
+		left    = std::min(left, x);
+		right   = std::max(right, x);
+		top     = std::min(top, y);
+		bottom  = std::max(bottom, y);
+		nearest = std::min(nearest, clip.z * inverseW);
+	}
+
+	if (nearest <= 0.0f) return true;
+	if (right < 0.0f || bottom < 0.0f || left >= this->width || top >= this->height) return true;
+
+	int x0 = std::max(static_cast<int>(left), 0);
+	int y0 = std::max(static_cast<int>(top), 0);
+	int x1 = std::min(static_cast<int>(right), static_cast<int>(this->width) - 1);
+	int y1 = std::min(static_cast<int>(bottom), static_cast<int>(this->height) - 1);
+
+	// Coarsest level where the rectangle still spans no more than two texels each way
+	size_t level = 0;
+	while (level + 1 < this->pyramid.size() && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1)) level++;
+
+	const auto& depth = this->pyramid[level];
+	const auto  size  = this->levelSizes[level];
+
+	x0 = std::min<int>(x0 >> level, size.x - 1);
+	x1 = std::min<int>(x1 >> level, size.x - 1);
+	y0 = std::min<int>(y0 >> level, size.y - 1);
+	y1 = std::min<int>(y1 >> level, size.y - 1);
+
+	for (int y = y0; y <= y1; y++) {
+		for (int x = x0; x <= x1; x++) {
+			if (depth[y * size.x + x] >= nearest) return true;
+		}
+	}
+	return false;
+}
+
+size_t OcclusionCuller::cull(const CullBounds& bounds, const uint32_t* candidates, const size_t count, uint32_t* out) {
+	auto test = [&](const size_t begin, const size_t end, uint32_t* list) {
+		size_t kept = 0;
+		for (size_t i = begin; i < end; i++) {
+			const uint32_t index = candidates[i];
+			const DirectX::XMFLOAT3 center(bounds.centerX[index], bounds.centerY[index], bounds.centerZ[index]);
+			const DirectX::XMFLOAT3 extents = bounds.hasBoxes() ? DirectX::XMFLOAT3(bounds.extentX[index], bounds.extentY[index], bounds.extentZ[index])
+																: DirectX::XMFLOAT3(bounds.radius[index], bounds.radius[index], bounds.radius[index]);
+
+			if (this->visible(center, extents)) list[kept++] = index;
+		}
+		return kept;
+	};
+
+	size_t chunks = 1;
+	if (this->scheduler && count >= RC_CULL_CHUNK_SIZE / 4) {
+		chunks = std::min(this->threadsAmount, count / (RC_CULL_CHUNK_SIZE / 8));
+		chunks = std::max<size_t>(chunks, 1);
+	}
+
+	size_t written = 0;
+	if (chunks == 1) {
+		written = test(0, count, out);
+	}
+	else {
+		// Chunks test into their own lists, which are then joined in order
+		this->chunkVisible.resize(chunks);
+		this->chunkCounts.resize(chunks);
+
+		auto work = [&](int chunk) {
+			const size_t begin = chunk * count / chunks;
+			const size_t end   = (chunk + 1) * count / chunks;
+
+			auto& list = this->chunkVisible[chunk];
+			list.resize(end - begin);
+			this->chunkCounts[chunk] = test(begin, end, list.data());
+		};
+		this->run(chunks, work);
+
+		for (size_t chunk = 0; chunk < chunks; chunk++) {
+			memcpy(out + written, this->chunkVisible[chunk].data(), this->chunkCounts[chunk] * sizeof(uint32_t));
+			written += this->chunkCounts[chunk];
+		}
+	}
+
+	this->stats.tested   += count;
+	this->stats.occluded += count - written;
+	return written;
+}
\ No newline at end of file
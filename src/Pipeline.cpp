@@ -1 +1,143 @@
+// The state cache only exists for the Direct3D backend
+#include "framework.h"
+
+#ifndef RC_HEADLESS
 #include "Pipeline.h"
+
+void PipelineStateCache::normalize(const D3D11_DEPTH_STENCIL_DESC& description, D3D11_DEPTH_STENCIL_DESC* out) {
+	out->DepthEnable      = description.DepthEnable;
+	out->DepthWriteMask   = description.DepthWriteMask;
+	out->DepthFunc        = description.DepthFunc;
+	out->StencilEnable    = description.StencilEnable;
+	out->StencilReadMask  = description.StencilReadMask;
+	out->StencilWriteMask = description.StencilWriteMask;
+	out->FrontFace        = description.FrontFace;
+	out->BackFace         = description.BackFace;
+}
+void PipelineStateCache::normalize(const D3D11_BLEND_DESC& description, D3D11_BLEND_DESC* out) {
+	out->AlphaToCoverageEnable  = description.AlphaToCoverageEnable;
+	out->IndependentBlendEnable = description.IndependentBlendEnable;
+
+	for (UINT i = 0; i < D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT; i++) {
+		const auto& target = description.RenderTarget[i];
+		auto&       result = out->RenderTarget[i];
+
+		result.BlendEnable           = target.BlendEnable;
+		result.SrcBlend              = target.SrcBlend;
+		result.DestBlend             = target.DestBlend;
+		result.BlendOp               = target.BlendOp;
+		result.SrcBlendAlpha         = target.SrcBlendAlpha;
+		result.DestBlendAlpha        = target.DestBlendAlpha;
+		result.BlendOpAlpha          = target.BlendOpAlpha;
+		result.RenderTargetWriteMask = target.RenderTargetWriteMask;
+	}
+}
+
+bool PipelineStateCache::matches(const InputLayoutEntry& entry, const uint8_t* signature, const size_t signatureSize,
+								 const D3D11_INPUT_ELEMENT_DESC* elements, const UINT elementCount)
+{
+	if (entry.elements.size() != elementCount || entry.signature.size() != signatureSize) return false;
+	if (memcmp(entry.signature.data(), signature, signatureSize) != 0) return false;
+
+	for (UINT i = 0; i < elementCount; i++) {
+		const InputElement&             cached  = entry.elements[i];
+		const D3D11_INPUT_ELEMENT_DESC& element = elements[i];
+
+		if (cached.semanticName != element.SemanticName || cached.semanticIndex != element.SemanticIndex ||
+			cached.format != element.Format || cached.inputSlot != element.InputSlot ||
+			cached.alignedByteOffset != element.AlignedByteOffset || cached.inputSlotClass != element.InputSlotClass ||
+			cached.instanceDataStepRate != element.InstanceDataStepRate) return false;
+	}
+	return true;
+}
+
+void PipelineStateCache::build(Microsoft::WRL::ComPtr<ID3D11Device> device) {
+	this->device = device;
+	this->clear();
+	this->resetStats();
+}
+
+ID3D11RasterizerState* PipelineStateCache::getRasterizerState(const D3D11_RASTERIZER_DESC& description) {
+	return this->findOrCreate(this->rasterizerStates, description, [this](const D3D11_RASTERIZER_DESC* desc, ID3D11RasterizerState** out) {
+		return this->device->CreateRasterizerState(desc, out);
+	});
+}
+ID3D11SamplerState* PipelineStateCache::getSamplerState(const D3D11_SAMPLER_DESC& description) {
+	return this->findOrCreate(this->samplerStates, description, [this](const D3D11_SAMPLER_DESC* desc, ID3D11SamplerState** out) {
+		return this->device->CreateSamplerState(desc, out);
+	});
+}
+ID3D11DepthStencilState* PipelineStateCache::getDepthStencilState(const D3D11_DEPTH_STENCIL_DESC& description) {
+	return this->findOrCreate(this->depthStencilStates, description, [this](const D3D11_DEPTH_STENCIL_DESC* desc, ID3D11DepthStencilState** out) {
+		return this->device->CreateDepthStencilState(desc, out);
+	});
+}
+ID3D11BlendState* PipelineStateCache::getBlendState(const D3D11_BLEND_DESC& description) {
+	return this->findOrCreate(this->blendStates, description, [this](const D3D11_BLEND_DESC* desc, ID3D11BlendState** out) {
+		return this->device->CreateBlendState(desc, out);
+	});
+}
+
+ID3D11InputLayout* PipelineStateCache::getInputLayout(const D3D11_INPUT_ELEMENT_DESC* elements, const UINT elementCount,
+													  const void* vertexShaderBytecode, const size_t bytecodeSize)
+{
+	// Two shaders with the same input signature can share a layout
+	Microsoft::WRL::ComPtr<ID3DBlob> signature;
+	HRESULT hr = D3DGetInputSignatureBlob(vertexShaderBytecode, bytecodeSize, signature.GetAddressOf());
+
+	const uint8_t* signatureBytes = static_cast<const uint8_t*>(SUCCEEDED(hr) ? signature->GetBufferPointer() : vertexShaderBytecode);
+	const size_t   signatureSize  = SUCCEEDED(hr) ? signature->GetBufferSize() : bytecodeSize;
+
+	uint64_t key = fnv1a64(signatureBytes, signatureSize);
+	for (UINT i = 0; i < elementCount; i++) {
+		const auto& element = elements[i];
+
+		key = hashField(key, element.SemanticName);
+		key = hashCombine(key, element.SemanticIndex);
+		key = hashCombine(key, element.Format);
+		key = hashCombine(key, element.InputSlot);
+		key = hashCombine(key, element.AlignedByteOffset);
+		key = hashCombine(key, element.InputSlotClass);
+		key = hashCombine(key, element.InstanceDataStepRate);
+	}
+
+	auto it = this->inputLayouts.find(key);
+	if (it != this->inputLayouts.end()) {
+		if (matches(it->second, signatureBytes, signatureSize, elements, elementCount)) {
+			this->stats.hits++;
+			return it->second.inputLayout.Get();
+		}
+		RC_DBG_WARN("Input layout hash collision, replacing the cached layout.");
+		this->retired.push_back(it->second.inputLayout);
+	}
+
+	this->stats.misses++;
+
+	Microsoft::WRL::ComPtr<ID3D11InputLayout> inputLayout;
+	hr = this->device->CreateInputLayout(elements, elementCount, vertexShaderBytecode, bytecodeSize, inputLayout.GetAddressOf());
+	if (FAILED(hr)) {
+		RC_DBG_ERROR("Failed to create input layout.");
+		return nullptr;
+	}
+
+	auto& entry = this->inputLayouts[key];
+	entry.signature.assign(signatureBytes, signatureBytes + signatureSize);
+	entry.elements.clear();
+	for (UINT i = 0; i < elementCount; i++) {
+		const auto& element = elements[i];
+		entry.elements.push_back({ element.SemanticName, element.SemanticIndex, element.Format, element.InputSlot,
+								   element.AlignedByteOffset, element.InputSlotClass, element.InstanceDataStepRate });
+	}
+	entry.inputLayout = inputLayout;
+	return entry.inputLayout.Get();
+}
+
+void PipelineStateCache::clear() {
+	this->rasterizerStates.clear();
+	this->samplerStates.clear();
+	this->depthStencilStates.clear();
+	this->blendStates.clear();
+	this->inputLayouts.clear();
+	this->retired.clear();
+}
+#endif
\ No newline at end of file
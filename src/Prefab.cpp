@@ -0,0 +1,72 @@
+#include "Prefab.h"
+
+void PrefabManager::build(Renderer* renderer) {
+	this->renderer = renderer;
+}
+
+PrefabID PrefabManager::registerPrefab(const std::string& name, const PrefabDescription& description) {
+	auto it = this->names.find(std::string_view(name));
+	if (it != this->names.end()) {
+		RC_DBG_WARN("Prefab " << name << " is already registered, returning the existing one.");
+		return it->second;
+	}
+
+	Model prototype = {};
+	if (description.modelPath) {
+		prototype = this->renderer->createModel(description.modelPath, 
+												description.vertexShaderSource, description.pixelShaderSource,
+												description.texturePath);
+	}
+	else {
+		prototype = this->renderer->createModel(description.vertices, description.indices, 
+												description.vertexShaderSource, description.pixelShaderSource,
+												description.texturePath);
+	}
+	prototype.transform = description.transform;
+	prototype.name      = StringTable::intern(name);
+
+	const PrefabID id = static_cast<PrefabID>(this->prefabs.size());
+	this->prefabs.push_back(std::move(prototype));
+	this->names.emplace(name, id);
+
+	return id;
+}
+PrefabID PrefabManager::find(const std::string_view name) const {
+	auto it = this->names.find(name);
+	if (it == this->names.end()) return RC_INVALID_PREFAB;
+
+	return it->second;
+}
+
+const Model* PrefabManager::getPrefab(const PrefabID id) const {
+	if (id >= this->prefabs.size()) return nullptr;
+	return &this->prefabs[id];
+}
+
+Model PrefabManager::instantiate(const PrefabID id) const {
+	if (id >= this->prefabs.size()) {
+		RC_DBG_ERROR("Tried to instantiate an unknown prefab: " << id);
+		return {};
+	}
+
+	// Only reference counts are touched, the resources stay shared. Buffers are written in place, so they are not
+	Model model = this->prefabs[id];
+	if (!model.buffers.empty()) this->renderer->copyBuffers(&model);
+
+	return model;
+}
+Model PrefabManager::instantiate(const PrefabID id, const Transform& transform) const {
+	Model model     = this->instantiate(id);
+	model.transform = transform;
+
+	return model;
+}
+
+void PrefabManager::spawn(const PrefabID id, const Transform& transform) {
+	this->renderer->toQueue(this->instantiate(id, transform));
+}
+void PrefabManager::spawn(const PrefabID id, const std::vector<Transform>& transforms) {
+	for (auto& transform : transforms) {
+		this->renderer->toQueue(this->instantiate(id, transform));
+	}
+}
\ No newline at end of file
@@ -1,10 +1,12 @@
 #include "RCTime.h"
 
+#include <chrono>
+
 size_t RCTime::currentTime = 0.0f;
 size_t RCTime::lastTime    = 0.0f;
 
 void RCTime::startUpdate() {
-	RCTime::currentTime = GetTickCount64();
+	RCTime::currentTime = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
 }
 void RCTime::endUpdate() {
 	RCTime::lastTime = RCTime::currentTime;
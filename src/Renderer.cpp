@@ -1,6 +1,9 @@
 #include "Renderer.h"
 
+#include <chrono>
+
 Renderer::~Renderer() {
+	delete this->camera;
 	delete Renderer::handler;
 }
 
@@ -16,21 +19,66 @@ void Renderer::build(ObjectsManager* objectsManager, Window* window, GuiManager*
 	this->handler = new DirectX11Handler(this->window, handlerDescription);
 	this->window->setWIP(this->handler);
 	this->scheduler.build(threadsAmount);
+	this->threadsAmount = std::max<size_t>(threadsAmount, 1);
+	this->localityPass.build(this->objectsManager, [this](const size_t a, const size_t b) {
+		if (a < this->transformStreams.size() && b < this->transformStreams.size()) this->transformStreams.swap(a, b);
+	});
+
+	this->drawSorter.build(&this->scheduler, threadsAmount);
+	this->transformKernel.build(&this->scheduler, threadsAmount);
+	this->frustumCuller.build(&this->scheduler, threadsAmount);
+	this->sceneBVH.build(&this->scheduler, threadsAmount);
+	this->occlusionCuller.build(&this->scheduler, threadsAmount);
+	this->shaderIds.build(RC_SORT_SHADER_BITS);
+	this->textureIds.build(RC_SORT_TEXTURE_BITS);
+	this->meshIds.build(RC_SORT_MESH_BITS);
 
 	this->handler->prepare();
+	this->billboardBatcher.build(this->handler, &this->scheduler, threadsAmount);
 
 	this->camera = new Camera(this->window);
 }
 
-Mesh Renderer::createMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices) {
-	Mesh mesh = {};
-	this->handler->createVertexArrayBuffer(&mesh.vertexArrayBuffer, &mesh.vertices, &mesh.vertexInitData, vertices);
-	this->handler->createIndexArrayBuffer(&mesh.indexArrayBuffer, &mesh.indices, &mesh.indexInitData, indices);
+Mesh Renderer::createMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const VertexFormat format) {
+	Mesh mesh     = {};
+	mesh.vertices = vertices;
+	mesh.indices  = this->generateLods ? buildLodChain(vertices, indices, &mesh.lods) : indices;
+
+	mesh.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+	mesh.indexCount  = static_cast<uint32_t>(mesh.indices.size());
+
+	if (!vertices.empty()) mesh.bounds = computeBounds(&vertices.front().position, vertices.size(), sizeof(Vertex));
+
+	// Quantized inside the bounds, so they have to be known first
+	if (format == VertexFormat::Compact) {
+		std::vector<CompactVertex> compact;
+		compactVertices(mesh.vertices, mesh.bounds, &compact, &mesh.dequantize, &mesh.compaction);
+
+		mesh.format       = VertexFormat::Compact;
+		mesh.vertexStride = sizeof(CompactVertex);
+		this->handler->createVertexArrayBuffer(&mesh.vertexArrayBuffer, compact);
+	}
+	else {
+		mesh.compaction.fullBytes    = mesh.vertices.size() * sizeof(Vertex);
+		mesh.compaction.compactBytes = mesh.compaction.fullBytes;
+		this->handler->createVertexArrayBuffer(&mesh.vertexArrayBuffer, mesh.vertices);
+	}
+
+	if (mesh.vertexCount <= RC_MAX_SHORT_INDEX_VERTICES) {
+		mesh.indexBytes = sizeof(uint16_t);
+		this->handler->createIndexArrayBuffer(&mesh.indexArrayBuffer, shortIndices(mesh.indices));
+	}
+	else this->handler->createIndexArrayBuffer(&mesh.indexArrayBuffer, mesh.indices);
+
+	mesh.compaction.fullBytes    += mesh.indices.size() * sizeof(uint32_t);
+	mesh.compaction.compactBytes += mesh.indices.size() * mesh.indexBytes;
 	
 	return mesh;
 }
-Mesh Renderer::createMesh(const char* path) {
-	const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_GenSmoothNormals);
+Mesh Renderer::createMesh(const char* path, const VertexFormat format) {
+	// Importers are not thread safe, cached loads may run on several threads
+	Assimp::Importer importer;
+	const aiScene*   scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_GenSmoothNormals);
 	RC_EI_ASSERT(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode,
 		"ERROR::ASSIMP::" << importer.GetErrorString()
 	);
@@ -71,8 +119,8 @@ Mesh Renderer::createMesh(const char* path) {
 	verticesThread.join();
 	indicesThread.join();
 
-	Mesh retVal = this->createMesh(vertices, indices);
-	retVal.path = path;
+	Mesh retVal = this->createMesh(vertices, indices, format);
+	retVal.path = StringTable::intern(path);
 
 	return retVal;
 }
@@ -90,26 +138,69 @@ Texture Renderer::createTexture(const char* path) {
 	this->handler->createTexture2D(&texture2D, &imageData, path, DXGI_FORMAT_R8G8B8A8_UNORM_SRGB);
 
 	this->handler->createShaderResourceView(&texture.texture, texture2D);
-	texture.image = std::move(imageData);
-	texture.path  = path;
+
+	D3D11_TEXTURE2D_DESC textureDescription = {};
+	texture2D->GetDesc(&textureDescription);
+
+	texture.image  = std::move(imageData);
+	texture.width  = textureDescription.Width;
+	texture.height = textureDescription.Height;
+	texture.path   = StringTable::intern(path);
 
 	return texture;
 }
 
+std::shared_ptr<Mesh> Renderer::loadMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices, const ResidencyPolicy residency, const VertexFormat format) {
+	// LOD generation changes the index buffer, so it is part of the key
+	ResourceKey key = contentKey("mesh", vertices.data(), vertices.size() * sizeof(Vertex));
+	key             = fnv1a64(indices.data(), indices.size() * sizeof(uint32_t), key);
+	key             = hashCombine(key, this->generateLods);
+	key             = hashCombine(key, residency);
+	key             = hashCombine(key, format);
+
+	return this->resources.meshes.acquire(key, [&]() {
+		Mesh mesh = this->createMesh(vertices, indices, format);
+		applyResidency(mesh, residency);
+		return mesh;
+	});
+}
+std::shared_ptr<Mesh> Renderer::loadMesh(const char* path, const ResidencyPolicy residency, const VertexFormat format) {
+	const ResourceKey key = hashCombine(hashCombine(hashCombine(pathKey("mesh", path), this->generateLods), residency), format);
+	return this->resources.meshes.acquire(key, [&]() {
+		Mesh mesh = this->createMesh(path, format);
+		applyResidency(mesh, residency);
+		return mesh;
+	});
+}
+
+std::shared_ptr<Shader> Renderer::loadShaderFromSource(const char* vertexShaderSource, const char* pixelShaderSource) {
+	const ResourceKey key = hashField(hashField(fnv1a64(std::string_view("shader")), vertexShaderSource), pixelShaderSource);
+	return this->resources.shaders.acquire(key, [&]() { return this->createShaderFromSource(vertexShaderSource, pixelShaderSource); });
+}
+
+std::shared_ptr<Texture> Renderer::loadTexture(const char* path, const ResidencyPolicy residency) {
+	return this->resources.textures.acquire(hashCombine(pathKey("texture", path), residency), [&]() {
+		Texture texture = this->createTexture(path);
+		applyResidency(texture, residency);
+		return texture;
+	});
+}
+
+void Renderer::createShaderVariants(ShaderVariantSet* out, const char* vertexShaderSource, const char* pixelShaderSource, std::initializer_list<const char*> keywords) {
+	out->build(this->handler, vertexShaderSource, pixelShaderSource, keywords);
+}
+
 Model Renderer::createModel(const std::vector<Vertex>&   vertices,
 							const std::vector<uint32_t>& indices,
 							const char*					 vertexShaderSource,
 							const char*					 pixelShaderSource,
 							const char*					 texturePath)
 {
-	Shader  shader = this->handler->createShadersFromSource(vertexShaderSource, pixelShaderSource);
-	Mesh    mesh   = this->createMesh(vertices, indices);
-	Texture tex    = this->createTexture(texturePath);
-
+	// Shader first, its inputs decide the vertex format of the mesh
 	Model model   = {};
-	model.mesh    = std::make_unique<Mesh>(std::move(mesh));
-	model.shader  = std::make_unique<Shader>(std::move(shader));
-	model.texture = std::make_unique<Texture>(std::move(tex));
+	model.shader  = this->loadShaderFromSource(vertexShaderSource, pixelShaderSource);
+	model.mesh    = this->loadMesh(vertices, indices, this->meshResidency, model.shader->format);
+	model.texture = this->loadTexture(texturePath);
 
 	return model;
 }
@@ -118,14 +209,10 @@ Model Renderer::createModel(const char* path,
 							const char* pixelShaderSource,
 							const char* texturePath)
 {
-	Shader  shader = this->handler->createShadersFromSource(vertexShaderSource, pixelShaderSource);
-	Mesh    mesh   = this->createMesh(path);
-	Texture tex    = this->createTexture(texturePath);
-
 	Model model   = {};
-	model.mesh    = std::make_unique<Mesh>(std::move(mesh));
-	model.shader  = std::make_unique<Shader>(std::move(shader));
-	model.texture = std::make_unique<Texture>(std::move(tex));
+	model.shader  = this->loadShaderFromSource(vertexShaderSource, pixelShaderSource);
+	model.mesh    = this->loadMesh(path, this->meshResidency, model.shader->format);
+	model.texture = this->loadTexture(texturePath);
 
 	return model;
 }
@@ -136,19 +223,19 @@ Model Renderer::getTemplate(const ModelTemplate t, void* params) {
 	case ModelTemplate::Billboard: { 
 		const char* BillboardVertexShaderSource = R"(
 		// Some code i got from chatgpt
-		cbuffer FrameData : register(b0) {
-			matrix model;
+		cbuffer FrameConstants : register(b1) {
 			matrix view;
 			matrix projection;
-		};
-		cbuffer CameraRotation : register(b1) {
+			matrix viewProjection;
+			float4 cameraPosition;
 			float4 qCameraRotation;
 		};
 
 		struct VSInput {
-			float3 position : POSITION;
-			float3 normal   : NORMAL;
-			float2 texCoords: TEXCOORD;
+			float3   position : POSITION;
+			float3   normal   : NORMAL;
+			float2   texCoords: TEXCOORD;
+			float4x4 world    : INSTANCE_WORLD;
 		};
 
 		struct PSInput {
@@ -160,8 +247,8 @@ Model Renderer::getTemplate(const ModelTemplate t, void* params) {
 		PSInput VSMain(VSInput input) {
 			PSInput output;
 
-			// The billboard center is assumed to be stored in model[3].xyz.
-			float3 billboardCenter = model[3].xyz;
+			// The billboard center is the translation row of the instance world matrix.
+			float3 billboardCenter = input.world[3].xyz;
 
 			// Convert the camera rotation quaternion into right and up vectors.
 			// Note: Ensure the quaternion is normalized.
@@ -187,12 +274,18 @@ Model Renderer::getTemplate(const ModelTemplate t, void* params) {
 			// Calculate the local offset using the scale (assumed to be set to the billboard half-size)
 			float3 localOffset = input.position;
 
+		#if AXIS_LOCKED
+			// Only turn around the world up axis, for trees, grass and the like.
+			camUp    = float3(0.0f, 1.0f, 0.0f);
+			camRight = normalize(float3(camRight.x, 0.0f, camRight.z));
+		#endif
+
 			// Construct the billboard world position by offsetting the center along camera axes.
 			float3 billboardPos = billboardCenter + camRight * localOffset.x + camUp * localOffset.y;
 
 			// Transform the billboard position to clip space.
 			float4 worldPos = float4(billboardPos, 1.0f);
-			output.position = mul(mul(worldPos, view), projection);
+			output.position = mul(worldPos, viewProjection);
 
 			output.normal    = input.normal;
 			output.texCoords = input.texCoords;
@@ -203,19 +296,6 @@ Model Renderer::getTemplate(const ModelTemplate t, void* params) {
 			Texture2D tex : register(t0);
 			SamplerState samplerState : register(s0);
 
-			cbuffer LightBuffer : register(b0) {
-			float3 direction;
-
-			float4 ambient;
-			float4 lightColor;
-
-			float intensity;
-		}
-
-		cbuffer Scale : register(b1) {
-			float3 scale;
-		}
-
 		struct PSInput {
 			float4 position : SV_POSITION;
 			float3 normal : NORMAL;
@@ -224,21 +304,27 @@ Model Renderer::getTemplate(const ModelTemplate t, void* params) {
 
 		float4 PSMain(PSInput input) : SV_TARGET {
 			float4 texColor = tex.Sample(samplerState, input.texCoords);
+		#if ALPHA_CUTOUT
+			clip(texColor.a - 0.5f);
+		#endif
 			return texColor;
 		}
 		)";
 
-		BillboardDescription* desc = reinterpret_cast<BillboardDescription*>(params);
-		Model model = {};
-		if (desc->modelPath) {
-			model = this->createModel(desc->modelPath, BillboardVertexShaderSource, BillboardPixelShaderSource, desc->texturePath);
-		}
-		else {
-			model = this->createModel(desc->vertices, desc->indices, BillboardVertexShaderSource, BillboardPixelShaderSource, desc->texturePath);
+		if (this->billboardShaders.getKeywordCount() == 0) {
+			this->createShaderVariants(&this->billboardShaders, BillboardVertexShaderSource, BillboardPixelShaderSource, { "ALPHA_CUTOUT", "AXIS_LOCKED" });
 		}
 
-		auto& p = this->camera->transform.rotation;
-		this->createBuffer<DirectX::XMVECTOR>(&model, PipelineStage::VertexStage, p, "cameraRotation");
+		BillboardDescription* desc = reinterpret_cast<BillboardDescription*>(params);
+
+		ShaderKeywordMask features = 0;
+		if (desc->alphaCutout) features |= this->billboardShaders.keyword("ALPHA_CUTOUT");
+		if (desc->axisLocked)  features |= this->billboardShaders.keyword("AXIS_LOCKED");
+
+		Model model   = {};
+		model.mesh    = desc->modelPath ? this->loadMesh(desc->modelPath) : this->loadMesh(desc->vertices, desc->indices);
+		model.shader  = this->billboardShaders.get(features);
+		model.texture = this->loadTexture(desc->texturePath);
 
 		return model;
 	}
@@ -250,6 +336,14 @@ Model Renderer::getTemplate(const ModelTemplate t, void* params) {
 	}
 }
 
+void Renderer::copyBuffers(Model* model) {
+	for (auto& buffer : model->buffers) {
+		Microsoft::WRL::ComPtr<ID3D11Buffer> copy;
+		this->handler->createConstantBuffer(&copy, buffer.contents.data(), static_cast<UINT>(buffer.contents.size()));
+		buffer.buffer = copy;
+	}
+}
+
 void Renderer::createGlobalLight() {
 	GlobalLight globalLight = {};
 	globalLight.ambient     = DirectX::XMFLOAT4(0.2f, 0.2f, 0.2f, 1.0f);
@@ -258,7 +352,6 @@ void Renderer::createGlobalLight() {
 	globalLight.intensity   = 1.0f;
 
 	this->scene.globalLightData = globalLight;
-	this->handler->createConstantBuffer<GlobalLight>(&this->scene.globalLightBuffer.buffer, this->scene.globalLightData);
 }
 
 void Renderer::clearScreen() {
@@ -268,91 +361,383 @@ void Renderer::clearScreen() {
 void Renderer::render() {
 	this->handler->prepare();
 
-	this->objectsManager->get<std::unique_ptr<Model>>()
-		.for_each([this](std::unique_ptr<Model>& model) {
-		auto* modelPtr = model.get();
+	this->localityPass.step(this->localityBudget);
 
-		DirectX::XMFLOAT3 position;
-		DirectX::XMFLOAT4 rotation;
-		DirectX::XMFLOAT3 scale;
+	FlexibleVector<>* column = this->objectsManager->getColumn(typeid(std::unique_ptr<Model>));
+	if (!column) {
+		this->billboardBatcher.clear();
+		guiManager->render();
+		return;
+	}
 
-		DirectX::XMStoreFloat3(&position, modelPtr->transform.position);
-		DirectX::XMStoreFloat4(&rotation, modelPtr->transform.rotation);
-		DirectX::XMStoreFloat3(&scale, modelPtr->transform.scale);
+	auto models = this->objectsManager->get<std::unique_ptr<Model>>();
 
-		auto& transform = modelPtr->transform;
+	FrameConstants frame = {};
+	frame.view           = DirectX::XMMatrixTranspose(this->camera->viewMatrix);
+	frame.projection     = DirectX::XMMatrixTranspose(this->camera->projectionMatrix);
+	frame.viewProjection = DirectX::XMMatrixTranspose(this->camera->viewMatrix * this->camera->projectionMatrix);
+	frame.light          = this->scene.globalLightData;
+	DirectX::XMStoreFloat4(&frame.cameraPosition, this->camera->transform.position);
+	DirectX::XMStoreFloat4(&frame.cameraRotation, this->camera->transform.rotation);
 
-		DirectX::XMMATRIX scaleMatrix    = DirectX::XMMatrixScalingFromVector(transform.scale);
-		DirectX::XMMATRIX rotationMatrix = DirectX::XMMatrixRotationQuaternion(transform.rotation);
-		DirectX::XMMATRIX positionMatrix = DirectX::XMMatrixTranslationFromVector(transform.position);
+	if (!this->sceneDescription.globalLightsEnabled) frame.light.intensity = 0.0f;
 
-		transform.model = scaleMatrix * rotationMatrix * positionMatrix;
+	const size_t modelCount = models.size();
+	this->drawGroups.resize(modelCount);
+	this->drawInstances.resize(modelCount);
+	this->cullBounds.resize(modelCount, true);
+	this->sceneBVH.resize(modelCount);
+	this->occluderModels.clear();
 
-		FrameData fm  = {};
-		fm.model      = DirectX::XMMatrixTranspose(transform.model);
-		fm.projection = DirectX::XMMatrixTranspose(this->camera->projectionMatrix);
-		fm.view       = DirectX::XMMatrixTranspose(this->camera->viewMatrix);
+	this->worldTransposed.resize(modelCount);
 
-		Buffer cbuffer; 
-		Renderer::handler->createConstantBuffer<FrameData>(&cbuffer.buffer, fm);
+	// Model::transform stays the source, the streams only take the entries that differ from it.
+	// That catches direct writes, setTransform and any reordering of the column alike
+	this->transformStreams.resize(modelCount);
+	models.for_indexed([this](int i, std::unique_ptr<Model>& model) {
+		this->transformStreams.update(i, model->transform);
+	});
 
-		struct AlignedScale {
-			DirectX::XMFLOAT3 scale;
-			float             padding = 0.0f;
-		} ascale;
-		DirectX::XMStoreFloat3(&ascale.scale, modelPtr->transform.scale);
+	// Instance data is exactly one row major matrix, so the kernel writes it in place next to the transposed copy draws upload
+	static_assert(sizeof(InstanceData) == sizeof(DirectX::XMFLOAT4X4));
+	this->transformKernel.compose(this->transformStreams, reinterpret_cast<DirectX::XMFLOAT4X4*>(this->drawInstances.data()), this->worldTransposed.data());
 
-		Buffer scaleBuffer;
-		Renderer::handler->createConstantBuffer<AlignedScale>(&scaleBuffer.buffer, ascale);
+	// World matrices and bounds come first, culling needs all of them before any draw is recorded
+	models.for_indexed([this](int i, std::unique_ptr<Model>& model) {
+		auto& transform = model->transform;
 
-		std::vector<Microsoft::WRL::ComPtr<ID3D11Buffer>> VSBuffers = { cbuffer.buffer };
-		std::vector<Microsoft::WRL::ComPtr<ID3D11Buffer>> PSBuffers = { this->scene.globalLightBuffer.buffer, scaleBuffer.buffer };
+		transform.model = DirectX::XMLoadFloat4x4(&this->drawInstances[i].world);
 
-		for (uint32_t i = 0; i < modelPtr->buffers.size(); i++) {
-			if (modelPtr->buffers[i].stage == PipelineStage::VertexStage) VSBuffers.push_back(modelPtr->buffers[i].buffer);
-			else PSBuffers.push_back(modelPtr->buffers[i].buffer);
+		// Compact positions are snorm inside the mesh bounds, the GPU scales them back with the matrix it already applies
+		if (model->mesh && model->mesh->format == VertexFormat::Compact) {
+			const DirectX::XMMATRIX world = DirectX::XMLoadFloat4x4(&model->mesh->dequantize) * transform.model;
+			DirectX::XMStoreFloat4x4(&this->drawInstances[i].world, world);
+			DirectX::XMStoreFloat4x4(&this->worldTransposed[i], DirectX::XMMatrixTranspose(world));
 		}
-		this->handler->VSBindBuffers(VSBuffers);
-		this->handler->PSBindBuffers(PSBuffers);
 
-		this->handler->bindShaderResource(modelPtr->texture.get()->texture);
+		// Derived from the local bounds and the new matrix, the vertices are never scanned again
+		model->bounds = model->mesh ? transformBounds(model->mesh->bounds, transform.model) : Bounds{};
+
+		const Bounds& bounds = model->bounds;
+		this->cullBounds.centerX[i] = bounds.center.x;
+		this->cullBounds.centerY[i] = bounds.center.y;
+		this->cullBounds.centerZ[i] = bounds.center.z;
+		this->cullBounds.radius[i]  = bounds.radius;
+		this->cullBounds.extentX[i] = bounds.extents.x;
+		this->cullBounds.extentY[i] = bounds.extents.y;
+		this->cullBounds.extentZ[i] = bounds.extents.z;
 
-		Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState;
-		this->handler->createSamplerState(&samplerState);
-		this->handler->bindSamplerState(samplerState);
+		// Models the locality pass swapped look like moved boxes to the tree
+		this->sceneBVH.update(i, bounds);
 
-		auto* shader = modelPtr->shader.get();
-		auto* mesh   = modelPtr->mesh.get();
-		this->handler->render(shader->vertexShader, shader->pixelShader, shader->inputLayout,
-							  mesh->vertexArrayBuffer, mesh->indexArrayBuffer, mesh->indices.size());
+		if (model->occluder) this->occluderModels.push_back(i);
 	});
+	this->sceneBVH.commit();
+
+	const Frustum frustum = extractFrustum(this->camera->viewMatrix, this->camera->projectionMatrix);
+
+	const std::vector<uint32_t>* visible = &this->allModels;
+	if (this->cullingMode == CullingMode::Hierarchy) {
+		this->sceneBVH.queryFrustum(frustum, this->hierarchyVisible);
+		visible = &this->hierarchyVisible;
+	}
+	else if (this->cullingMode == CullingMode::Linear) {
+		visible = &this->frustumCuller.cull(frustum, this->cullBounds);
+	}
+	else if (this->allModels.size() != modelCount) {
+		this->allModels.resize(modelCount);
+		std::iota(this->allModels.begin(), this->allModels.end(), 0u);
+	}
+
+	// Occluders are drawn into a small CPU depth buffer, then whatever passed the frustum is tested against it
+	if (this->occlusionCulling && !this->occluderModels.empty()) {
+		this->occlusionCuller.begin(this->camera->viewMatrix * this->camera->projectionMatrix);
+		for (const uint32_t i : this->occluderModels) {
+			auto& model = *column->at<std::unique_ptr<Model>>(i);
+			this->occlusionCuller.addOccluder(*model->occluder, model->transform.model);
+		}
+		this->occlusionCuller.rasterize();
+
+		this->unoccluded.resize(visible->size());
+		this->unoccluded.resize(this->occlusionCuller.cull(this->cullBounds, visible->data(), visible->size(), this->unoccluded.data()));
+		visible = &this->unoccluded;
+	}
+	this->visibleModels = visible->size();
+
+	// Second pass builds the sort keys and picks levels of detail, the last one records the draws in key order
+	const size_t drawCount = visible->size();
+	this->drawKeys.resize(drawCount);
+	this->drawOrder.resize(drawCount);
+
+	const DirectX::XMMATRIX view       = this->camera->viewMatrix;
+	const float             nearPlane  = this->camera->nearPlane;
+	const float             depthRange = std::max(this->camera->farPlane - nearPlane, FLT_EPSILON);
+
+	// Pixels per world unit at distance 1, from the vertical field of view
+	const DirectX::XMVECTOR cameraPosition = this->camera->transform.position;
+	const float             lodScale       = this->window->height * 0.5f * DirectX::XMVectorGetY(this->camera->projectionMatrix.r[1]);
+
+	for (size_t draw = 0; draw < drawCount; draw++) {
+		const uint32_t i     = (*visible)[draw];
+		auto&          model = *column->at<std::unique_ptr<Model>>(i);
+
+		const auto& transform = model->transform;
+
+		const float viewDepth = DirectX::XMVectorGetZ(DirectX::XMVector3TransformCoord(transform.position, view));
+
+		if (model->mesh && model->mesh->lods.size() > 1) {
+			const Bounds& bounds   = model->bounds;
+			const float   distance = DirectX::XMVectorGetX(DirectX::XMVector3Length(DirectX::XMVectorSubtract(DirectX::XMLoadFloat3(&bounds.center), cameraPosition)));
+
+			DirectX::XMFLOAT3 scale;
+			DirectX::XMStoreFloat3(&scale, DirectX::XMVectorAbs(transform.scale));
+
+			// Mesh errors are in mesh units, the largest axis scale brings them to world units
+			const float pixelsPerUnit = lodScale * std::max({ scale.x, scale.y, scale.z }) / std::max(distance - bounds.radius, nearPlane);
+			model->lod = selectLod(*model->mesh, pixelsPerUnit, model->lod, this->lodErrorPixels, this->lodHysteresis);
+		}
+
+		this->drawKeys[draw] = drawSortKey(model->pass,
+										   this->shaderIds.get(model->shader ? model->shader->vertexShader.Get() : nullptr),
+										   this->textureIds.get(model->texture ? model->texture->texture.Get() : nullptr),
+										   this->meshIds.get(model->mesh ? model->mesh->vertexArrayBuffer.Get() : nullptr),
+										   model->lod,
+										   (viewDepth - nearPlane) / depthRange);
+		this->drawOrder[draw] = i;
+
+		auto& group     = this->drawGroups[i];
+		group.shader    = model->shader.get() ? model->shader->vertexShader.Get() : nullptr;
+		group.texture   = model->texture.get() ? model->texture->texture.Get() : nullptr;
+		group.mesh      = model->mesh.get() ? model->mesh->vertexArrayBuffer.Get() : nullptr;
+		group.pass      = model->pass;
+		group.lod       = model->lod;
+		group.instanced = model->shader && model->shader->instanced;
+		group.mergeable = model->buffers.empty();
+	}
+
+	this->drawSortStats.draws                = drawCount;
+	this->drawSortStats.stateChangesUnsorted = countStateChanges(this->drawKeys.data(), drawCount);
+
+	const auto sortStart = std::chrono::high_resolution_clock::now();
+	this->drawSorter.sort(this->drawKeys.data(), this->drawOrder.data(), drawCount);
+	this->drawSortStats.sortMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - sortStart).count();
+
+	this->drawSortStats.stateChangesSorted = countStateChanges(this->drawKeys.data(), drawCount);
+
+	// Every model samples with the same state, bound once for the whole pass
+	Microsoft::WRL::ComPtr<ID3D11SamplerState> samplerState;
+	this->handler->createSamplerState(&samplerState);
+	this->handler->bindSamplerState(samplerState);
+
+	// Adjacent draws of one instanced shader, mesh and texture become a single call
+	const auto& batches = this->instanceBatcher.build(this->drawOrder.data(), drawCount, this->drawGroups.data());
+
+	const uint32_t instanceCount = this->instanceBatcher.getInstanceCount();
+	InstanceData*  instances     = this->handler->beginInstances(instanceCount);
+	if (instances) {
+		this->instanceBatcher.pack(this->drawOrder.data(), this->drawInstances.data(), instances);
+		this->handler->endInstances();
+	}
+	else if (instanceCount > 0) {
+		RC_DBG_ERROR("Could not map the instance buffer, " << instanceCount << " instances are not drawn this frame");
+	}
+
+	// Batches are recorded in contiguous chunks on the pool, playing the lists back in order keeps the sorted order
+	const size_t batchCount = batches.size();
+	const size_t chunks     = std::clamp<size_t>(batchCount / RC_RECORD_CHUNK_SIZE, 1, this->threadsAmount);
+	const size_t chunkSize  = (batchCount + chunks - 1) / chunks;
+
+	this->commandLists.resize(chunks + 2);
+	for (auto& list : this->commandLists) list.reset();
+
+	// Bound once, nothing else uses the frame slot
+	this->commandLists[0].setConstants(RC_COMMAND_ALL_STAGES, RC_FRAME_CONSTANTS_SLOT, frame);
+
+	const bool instancesReady = instances != nullptr;
+	auto record = [this, column, &batches, batchCount, chunkSize, instancesReady](int chunk) {
+		const size_t first = std::min(chunk * chunkSize, batchCount);
+		const size_t last  = std::min(first + chunkSize, batchCount);
+		this->recordBatches(this->commandLists[chunk + 1], column, batches.data() + first, last - first, instancesReady);
+	};
+
+	if (chunks == 1) {
+		record(0);
+	}
+	else {
+		ThreadGroup* group = this->scheduler.scheduleWorkIndexed(chunks, record);
+		group->join();
+		delete group;
+	}
+
+	this->billboardBatcher.record(this->commandLists.back(), this->camera->viewMatrix, this->camera->transform.position);
+
+	this->handler->execute(this->commandLists);
 
 	guiManager->render();
 }
+void Renderer::recordBatches(CommandList& list, FlexibleVector<>* column, const DrawBatch* batches, const size_t count, const bool instancesReady) {
+	std::vector<GpuHandle> VSModelBuffers;
+	std::vector<GpuHandle> PSModelBuffers;
+
+	// Each chunk states its own blend mode, it cannot know where the previous chunk left it
+	bool       first       = true;
+	RenderPass currentPass = RenderPass::Opaque;
+
+	for (size_t b = 0; b < count; b++) {
+		const DrawBatch& batch = batches[b];
+
+		// Instanced shaders read the world matrix from the instance stream, without it there is nothing to draw them with
+		if (batch.instanced && !instancesReady) continue;
+
+		const uint32_t index    = this->drawOrder[batch.first];
+		auto*          modelPtr = column->at<std::unique_ptr<Model>>(index)->get();
+
+		if (first || modelPtr->pass != currentPass) {
+			first       = false;
+			currentPass = modelPtr->pass;
+			list.setBlend(currentPass == RenderPass::Transparent);
+		}
+
+		ObjectConstants object = {};
+		object.model           = DirectX::XMLoadFloat4x4(&this->worldTransposed[index]);
+		DirectX::XMStoreFloat4(&object.scale, modelPtr->transform.scale);
+		list.setConstants(RC_COMMAND_ALL_STAGES, RC_OBJECT_CONSTANTS_SLOT, object);
+
+		VSModelBuffers.clear();
+		PSModelBuffers.clear();
+		for (auto& buffer : modelPtr->buffers) {
+			if (buffer.stage == PipelineStage::VertexStage) VSModelBuffers.push_back(buffer.buffer.Get());
+			else PSModelBuffers.push_back(buffer.buffer.Get());
+		}
+		list.setBuffers(RC_COMMAND_VERTEX_STAGE, RC_MODEL_BUFFERS_SLOT, VSModelBuffers.data(), static_cast<uint32_t>(VSModelBuffers.size()));
+		list.setBuffers(RC_COMMAND_PIXEL_STAGE, RC_MODEL_BUFFERS_SLOT, PSModelBuffers.data(), static_cast<uint32_t>(PSModelBuffers.size()));
+
+		list.setTexture(0, modelPtr->texture->texture.Get());
+
+		auto*         shader = modelPtr->shader.get();
+		auto*         mesh   = modelPtr->mesh.get();
+		const MeshLod lod    = mesh->getLod(modelPtr->lod);
+
+		list.setPipeline(shader->vertexShader.Get(), shader->pixelShader.Get(), shader->inputLayout.Get());
+		list.setGeometry(mesh->vertexArrayBuffer.Get(), mesh->indexArrayBuffer.Get(), mesh->vertexStride, batch.instanced, mesh->indexBytes);
+
+		if (batch.instanced) list.drawInstanced(lod.indexCount, lod.firstIndex, batch.count, batch.instanceOffset);
+		else list.draw(lod.indexCount, lod.firstIndex);
+	}
+}
+
 void Renderer::present() {
 	this->handler->present();
 }
 
-void Renderer::toQueue(Model&& model) {
-	std::unique_ptr<Model> ptr = std::make_unique<Model>(std::move(model));
-	this->objectsManager->createEntity(std::move(ptr));
+void Renderer::reorderModels(const LocalityKey key) {
+	switch (key) {
+	case LocalityKey::RenderState: {
+		// Shader first since it is the most expensive state change, then texture and mesh
+		this->localityPass.begin([](const std::unique_ptr<Model>& model) {
+			auto fold = [](const void* ptr) { return (reinterpret_cast<uintptr_t>(ptr) >> 4) & 0x1fffff; };
+			return (static_cast<uint64_t>(fold(model->shader.get())) << 42)
+				 | (static_cast<uint64_t>(fold(model->texture.get())) << 21)
+				 | static_cast<uint64_t>(fold(model->mesh.get()));
+		});
+		break;
+	}
+	case LocalityKey::Position: {
+		FlexibleVector<>* column = this->objectsManager->getColumn(typeid(std::unique_ptr<Model>));
+		if (!column) return;
+
+		DirectX::XMVECTOR boundsMin = DirectX::XMVectorReplicate(FLT_MAX);
+		DirectX::XMVECTOR boundsMax = DirectX::XMVectorReplicate(-FLT_MAX);
+		for (size_t i = 0; i < column->size(); i++) {
+			const auto& position = (*column->at<std::unique_ptr<Model>>(i))->transform.position;
+			boundsMin = DirectX::XMVectorMin(boundsMin, position);
+			boundsMax = DirectX::XMVectorMax(boundsMax, position);
+		}
+
+		DirectX::XMFLOAT3 min;
+		DirectX::XMFLOAT3 max;
+		DirectX::XMStoreFloat3(&min, boundsMin);
+		DirectX::XMStoreFloat3(&max, boundsMax);
+
+		this->localityPass.begin([min, max](const std::unique_ptr<Model>& model) {
+			DirectX::XMFLOAT3 position;
+			DirectX::XMStoreFloat3(&position, model->transform.position);
+			return mortonKey(position, min, max);
+		});
+		break;
+	}
+
+	default:
+		break;
+	}
+}
+void Renderer::reorderModels(const std::function<uint64_t(const Model&)>& key) {
+	this->localityPass.begin([key](const std::unique_ptr<Model>& model) { return key(*model); });
+}
+
+EntityHandle Renderer::toQueue(Model&& model) {
+	const StringID name = model.name;
+
+	std::unique_ptr<Model> ptr    = std::make_unique<Model>(std::move(model));
+	EntityHandle           handle = this->objectsManager->createEntity(std::move(ptr));
+
+	if (name != RC_EMPTY_STRING) this->modelsByName.insert_or_assign(name, handle);
+
+	return handle;
 }
+
+Model* Renderer::findModel(const std::string_view name) {
+	auto it = this->modelsByName.find(StringTable::find(name));
+	if (it == this->modelsByName.end()) return nullptr;
+
+	std::unique_ptr<Model>* model = this->objectsManager->resolve<std::unique_ptr<Model>>(it->second);
+	return model ? model->get() : nullptr;
+}
+
+void Renderer::setTransform(const EntityHandle handle, const Transform& transform) {
+	const uint32_t index = this->objectsManager->indexOf<std::unique_ptr<Model>>(handle);
+	if (index == RC_INVALID_ENTITY) return;
+
+	(*this->objectsManager->resolve<std::unique_ptr<Model>>(handle))->transform = transform;
+	if (index < this->transformStreams.size()) this->transformStreams.set(index, transform);
+}
+void Renderer::setTransform(const std::string_view name, const Transform& transform) {
+	auto it = this->modelsByName.find(StringTable::find(name));
+	if (it == this->modelsByName.end()) return;
+
+	this->setTransform(it->second, transform);
+}
+
 void Renderer::removeModel(const size_t index) {
-	this->objectsManager->destroyEntity<Model>(index);
+	FlexibleVector<>* column = this->objectsManager->getColumn(typeid(std::unique_ptr<Model>));
+	if (!column || index >= column->size()) return;
+
+	std::unique_ptr<Model>* model = column->at<std::unique_ptr<Model>>(index);
+
+	auto it = this->modelsByName.find((*model)->name);
+	if (it != this->modelsByName.end() && this->objectsManager->indexOf<std::unique_ptr<Model>>(it->second) == index) {
+		this->modelsByName.erase(it);
+	}
+
+	this->objectsManager->destroyEntity<std::unique_ptr<Model>>(index);
+	if (index < this->transformStreams.size()) this->transformStreams.erase(index);
 }
-void Renderer::removeModel(const std::string& name) {
-	this->objectsManager->get<Model>()
-		.for_indexed([&](int i, Model& model) {
-		if (model.name == name) {
-			this->objectsManager->destroyEntity<Model>(i);
-		}
-		});
+void Renderer::removeModel(const std::string_view name) {
+	auto it = this->modelsByName.find(StringTable::find(name));
+	if (it == this->modelsByName.end()) return;
+
+	const uint32_t index = this->objectsManager->indexOf<std::unique_ptr<Model>>(it->second);
+	this->modelsByName.erase(it);
+	if (index != RC_INVALID_ENTITY) this->removeModel(static_cast<size_t>(index));
 }
 void Renderer::removeModel(const Model* ptr) {
-	this->objectsManager->get<std::unique_ptr<Model>>()
-		.for_indexed([&](int i, std::unique_ptr<Model>& model) {
-		if (model.get() == ptr) {
-			this->objectsManager->destroyEntity<std::unique_ptr<Model>>(i);
+	FlexibleVector<>* column = this->objectsManager->getColumn(typeid(std::unique_ptr<Model>));
+	if (!column) return;
+
+	for (size_t i = 0; i < column->size(); i++) {
+		if (column->at<std::unique_ptr<Model>>(i)->get() == ptr) {
+			this->removeModel(i);
+			return;
 		}
-		});
+	}
 }
\ No newline at end of file
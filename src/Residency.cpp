@@ -0,0 +1,102 @@
+#include "Residency.h"
+
+#include <cstring>
+
+namespace {
+	template <typename Ty>
+	void release(std::vector<Ty>& data) {
+		std::vector<Ty>().swap(data);
+	}
+
+	size_t textureBytes(const Texture& texture) {
+		return static_cast<size_t>(texture.width) * texture.height * 4;
+	}
+}
+
+size_t residentBytes(const Mesh& mesh) {
+	return mesh.vertices.capacity() * sizeof(Vertex) + mesh.indices.capacity() * sizeof(uint32_t) + mesh.compressed.capacity();
+}
+size_t residentBytes(const Texture& texture) {
+	return (texture.image ? textureBytes(texture) : 0) + texture.compressed.capacity();
+}
+
+void applyResidency(Mesh& mesh, const ResidencyPolicy policy) {
+	mesh.residency = policy;
+	if (policy == ResidencyPolicy::KeepForQueries) {
+		release(mesh.compressed);
+		return;
+	}
+
+	if (policy == ResidencyPolicy::KeepCompressed && !mesh.vertices.empty()) {
+		const size_t vertexBytes = mesh.vertices.size() * sizeof(Vertex);
+		const size_t indexBytes  = mesh.indices.size() * sizeof(uint32_t);
+
+		std::vector<uint8_t> raw(vertexBytes + indexBytes);
+		memcpy(raw.data(), mesh.vertices.data(), vertexBytes);
+		if (indexBytes) memcpy(raw.data() + vertexBytes, mesh.indices.data(), indexBytes);
+
+		mesh.compressed = lzCompress(raw.data(), raw.size());
+	}
+
+	release(mesh.vertices);
+	release(mesh.indices);
+}
+void applyResidency(Texture& texture, const ResidencyPolicy policy) {
+	texture.residency = policy;
+	if (policy == ResidencyPolicy::KeepForQueries) {
+		release(texture.compressed);
+		return;
+	}
+
+	if (policy == ResidencyPolicy::KeepCompressed && texture.image) {
+		texture.compressed = lzCompress(texture.image.get(), textureBytes(texture));
+	}
+
+	texture.image.reset();
+}
+
+bool readCpuCopy(const Mesh& mesh, std::vector<Vertex>* outVertices, std::vector<uint32_t>* outIndices) {
+	if (mesh.residency == ResidencyPolicy::KeepForQueries) {
+		if (outVertices) *outVertices = mesh.vertices;
+		if (outIndices)  *outIndices  = mesh.indices;
+		return !mesh.vertices.empty();
+	}
+	if (mesh.compressed.empty()) return false;
+
+	const size_t vertexBytes = static_cast<size_t>(mesh.vertexCount) * sizeof(Vertex);
+	const size_t indexBytes  = static_cast<size_t>(mesh.indexCount) * sizeof(uint32_t);
+
+	std::vector<uint8_t> raw(vertexBytes + indexBytes);
+	if (!lzDecompress(mesh.compressed.data(), mesh.compressed.size(), raw.data(), raw.size())) {
+		RC_DBG_ERROR("The compressed copy of a mesh is corrupt.");
+		return false;
+	}
+
+	if (outVertices) {
+		outVertices->resize(mesh.vertexCount);
+		memcpy(outVertices->data(), raw.data(), vertexBytes);
+	}
+	if (outIndices) {
+		outIndices->resize(mesh.indexCount);
+		if (indexBytes) memcpy(outIndices->data(), raw.data() + vertexBytes, indexBytes);
+	}
+	return true;
+}
+bool readCpuCopy(const Texture& texture, std::vector<uint8_t>* outPixels) {
+	const size_t bytes = textureBytes(texture);
+
+	if (texture.residency == ResidencyPolicy::KeepForQueries) {
+		if (!texture.image) return false;
+		if (outPixels) outPixels->assign(texture.image.get(), texture.image.get() + bytes);
+		return true;
+	}
+	if (texture.compressed.empty()) return false;
+	if (!outPixels) return true;
+
+	outPixels->resize(bytes);
+	if (!lzDecompress(texture.compressed.data(), texture.compressed.size(), outPixels->data(), bytes)) {
+		RC_DBG_ERROR("The compressed copy of a texture is corrupt.");
+		return false;
+	}
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,526 @@
+#include "SceneBVH.h"
+
+#include <chrono>
+
+namespace {
+	constexpr DirectX::XMFLOAT3 emptyMin = { FLT_MAX, FLT_MAX, FLT_MAX };
+	constexpr DirectX::XMFLOAT3 emptyMax = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+	float axis(const DirectX::XMFLOAT3& v, const int a) { return (&v.x)[a]; }
+
+	void grow(DirectX::XMFLOAT3& boundsMin, DirectX::XMFLOAT3& boundsMax, const DirectX::XMFLOAT3& pointMin, const DirectX::XMFLOAT3& pointMax) {
+		boundsMin.x = std::min(boundsMin.x, pointMin.x);
+		boundsMin.y = std::min(boundsMin.y, pointMin.y);
+		boundsMin.z = std::min(boundsMin.z, pointMin.z);
+		boundsMax.x = std::max(boundsMax.x, pointMax.x);
+		boundsMax.y = std::max(boundsMax.y, pointMax.y);
+		boundsMax.z = std::max(boundsMax.z, pointMax.z);
+	}
+	float halfArea(const DirectX::XMFLOAT3& boundsMin, const DirectX::XMFLOAT3& boundsMax) {
+		const float x = std::max(boundsMax.x - boundsMin.x, 0.0f);
+		const float y = std::max(boundsMax.y - boundsMin.y, 0.0f);
+		const float z = std::max(boundsMax.z - boundsMin.z, 0.0f);
+		return x * y + y * z + z * x;
+	}
+	bool sameBox(const DirectX::XMFLOAT3& aMin, const DirectX::XMFLOAT3& aMax, const DirectX::XMFLOAT3& bMin, const DirectX::XMFLOAT3& bMax) {
+		return aMin.x == bMin.x && aMin.y == bMin.y && aMin.z == bMin.z && aMax.x == bMax.x && aMax.y == bMax.y && aMax.z == bMax.z;
+	}
+	bool overlaps(const DirectX::XMFLOAT3& aMin, const DirectX::XMFLOAT3& aMax, const DirectX::XMFLOAT3& bMin, const DirectX::XMFLOAT3& bMax) {
+		return aMin.x <= bMax.x && aMax.x >= bMin.x && aMin.y <= bMax.y && aMax.y >= bMin.y && aMin.z <= bMax.z && aMax.z >= bMin.z;
+	}
+	bool contains(const DirectX::XMFLOAT3& outerMin, const DirectX::XMFLOAT3& outerMax, const DirectX::XMFLOAT3& innerMin, const DirectX::XMFLOAT3& innerMax) {
+		return outerMin.x <= innerMin.x && outerMin.y <= innerMin.y && outerMin.z <= innerMin.z &&
+			   outerMax.x >= innerMax.x && outerMax.y >= innerMax.y && outerMax.z >= innerMax.z;
+	}
+
+	enum class Containment { Outside, Intersects, Inside };
+
+	Containment classify(const Frustum& frustum, const DirectX::XMFLOAT3& boxMin, const DirectX::XMFLOAT3& boxMax) {
+		const float cx = (boxMin.x + boxMax.x) * 0.5f, ex = (boxMax.x - boxMin.x) * 0.5f;
+		const float cy = (boxMin.y + boxMax.y) * 0.5f, ey = (boxMax.y - boxMin.y) * 0.5f;
+		const float cz = (boxMin.z + boxMax.z) * 0.5f, ez = (boxMax.z - boxMin.z) * 0.5f;
+
+		Containment result = Containment::Inside;
+		for (const auto& plane : frustum.planes) {
+			const float distance = plane.x * cx + plane.y * cy + plane.z * cz + plane.w;
+			const float reach    = fabsf(plane.x) * ex + fabsf(plane.y) * ey + fabsf(plane.z) * ez;
+
+			if (distance < -reach) return Containment::Outside;
+			if (distance < reach) result = Containment::Intersects;
+		}
+		return result;
+	}
+
+	// Distance along the ray to the box, FLT_MAX when it misses or starts beyond limit
+	float rayBox(const DirectX::XMFLOAT3& origin, const DirectX::XMFLOAT3& inverse, const DirectX::XMFLOAT3& boxMin, const DirectX::XMFLOAT3& boxMax, const float limit) {
+		float tMin = 0.0f;
+		float tMax = limit;
+		for (int a = 0; a < 3; a++) {
+			float t0 = (axis(boxMin, a) - axis(origin, a)) * axis(inverse, a);
+			float t1 = (axis(boxMax, a) - axis(origin, a)) * axis(inverse, a);
+			if (t0 > t1) std::swap(t0, t1);
+
+			// NaN from a zero direction on the slab plane leaves the interval as it was
+			tMin = t0 > tMin ? t0 : tMin;
+			tMax = t1 < tMax ? t1 : tMax;
+			if (tMin > tMax) return FLT_MAX;
+		}
+		return tMin;
+	}
+
+	struct BuildTask {
+		uint32_t node;
+		uint32_t first;
+		uint32_t count;
+	};
+
+	struct Bin {
+		DirectX::XMFLOAT3 boundsMin = emptyMin;
+		DirectX::XMFLOAT3 boundsMax = emptyMax;
+		uint32_t          count     = 0;
+	};
+
+	// Boxes travel with their item through the partitions, so every pass over a node reads memory in order
+	struct BuildRef {
+		DirectX::XMFLOAT3 boundsMin;
+		uint32_t          item;
+		DirectX::XMFLOAT3 boundsMax;
+		float             padding;
+
+		float centroid(const int a) const { return (axis(this->boundsMin, a) + axis(this->boundsMax, a)) * 0.5f; }
+	};
+
+	class TreeBuilder {
+	private:
+		BVHTree&              tree;
+		std::vector<BuildRef> refs;
+
+		void makeLeaf(const BuildTask& task) {
+			for (uint32_t i = 0; i < task.count; i++) {
+				const uint32_t item = this->refs[task.first + i].item;
+				this->tree.items[task.first + i] = item;
+				this->tree.itemLeaf[item]        = task.node;
+			}
+		}
+
+	public:
+		std::atomic<uint32_t> used = 1;
+
+		TreeBuilder(BVHTree& tree, const DirectX::XMFLOAT3* mins, const DirectX::XMFLOAT3* maxs, const size_t count) :
+			tree(tree), refs(count)
+		{
+			for (size_t i = 0; i < count; i++) {
+				this->refs[i] = { mins[i], static_cast<uint32_t>(i), maxs[i], 0.0f };
+			}
+		}
+
+		// Builds the subtree of root. With deferred given, subtrees of at most deferSize items are handed back instead
+		void run(const BuildTask root, std::vector<BuildTask>* deferred, const size_t deferSize) {
+			std::vector<BuildTask> stack = { root };
+
+			while (!stack.empty()) {
+				const BuildTask task = stack.back();
+				stack.pop_back();
+
+				if (deferred && task.count <= deferSize) {
+					deferred->push_back(task);
+					continue;
+				}
+
+				BuildRef* refs = this->refs.data() + task.first;
+
+				BVHNode& node  = this->tree.nodes[task.node];
+				node.boundsMin = emptyMin;
+				node.boundsMax = emptyMax;
+				node.first     = task.first;
+				node.count     = task.count;
+				node.child     = 0;
+
+				DirectX::XMFLOAT3 centroidMin = emptyMin;
+				DirectX::XMFLOAT3 centroidMax = emptyMax;
+				for (uint32_t i = 0; i < task.count; i++) {
+					const DirectX::XMFLOAT3 centroid(refs[i].centroid(0), refs[i].centroid(1), refs[i].centroid(2));
+					grow(node.boundsMin, node.boundsMax, refs[i].boundsMin, refs[i].boundsMax);
+					grow(centroidMin, centroidMax, centroid, centroid);
+				}
+
+				if (task.count <= RC_BVH_LEAF_SIZE) {
+					this->makeLeaf(task);
+					continue;
+				}
+
+				// Binned SAH, one pass fills the bins of all three axes
+				float scale[3];
+				for (int a = 0; a < 3; a++) {
+					const float extent = axis(centroidMax, a) - axis(centroidMin, a);
+					scale[a] = extent > 0.0f ? RC_BVH_BINS / extent : 0.0f;
+				}
+
+				Bin bins[3][RC_BVH_BINS];
+				for (uint32_t i = 0; i < task.count; i++) {
+					for (int a = 0; a < 3; a++) {
+						const uint32_t bin = std::min(RC_BVH_BINS - 1, static_cast<uint32_t>((refs[i].centroid(a) - axis(centroidMin, a)) * scale[a]));
+						bins[a][bin].count++;
+						grow(bins[a][bin].boundsMin, bins[a][bin].boundsMax, refs[i].boundsMin, refs[i].boundsMax);
+					}
+				}
+
+				// Cost of a split is items times half area on each side
+				float bestCost  = FLT_MAX;
+				int   bestAxis  = -1;
+				int   bestSplit = 0;
+				for (int a = 0; a < 3; a++) {
+					if (scale[a] == 0.0f) continue;
+
+					float    leftArea[RC_BVH_BINS - 1];
+					uint32_t leftCount[RC_BVH_BINS - 1];
+
+					DirectX::XMFLOAT3 sweepMin   = emptyMin;
+					DirectX::XMFLOAT3 sweepMax   = emptyMax;
+					uint32_t          sweepCount = 0;
+					for (uint32_t b = 0; b < RC_BVH_BINS - 1; b++) {
+						sweepCount += bins[a][b].count;
+						grow(sweepMin, sweepMax, bins[a][b].boundsMin, bins[a][b].boundsMax);
+						leftArea[b]  = halfArea(sweepMin, sweepMax);
+						leftCount[b] = sweepCount;
+					}
+
+					sweepMin   = emptyMin;
+					sweepMax   = emptyMax;
+					sweepCount = 0;
+					for (uint32_t b = RC_BVH_BINS - 1; b > 0; b--) {
+						sweepCount += bins[a][b].count;
+						grow(sweepMin, sweepMax, bins[a][b].boundsMin, bins[a][b].boundsMax);
+
+						if (leftCount[b - 1] == 0 || sweepCount == 0) continue;
+
+						const float cost = leftCount[b - 1] * leftArea[b - 1] + sweepCount * halfArea(sweepMin, sweepMax);
+						if (cost < bestCost) {
+							bestCost  = cost;
+							bestAxis  = a;
+							bestSplit = b;
+						}
+					}
+				}
+
+				const float leafCost = task.count * halfArea(node.boundsMin, node.boundsMax);
+				if (bestCost >= leafCost && task.count <= RC_BVH_LEAF_SIZE * 4) {
+					this->makeLeaf(task);
+					continue;
+				}
+
+				uint32_t splitCount = task.count / 2;
+				if (bestAxis >= 0) {
+					auto* middle = std::partition(refs, refs + task.count, [&](const BuildRef& ref) {
+						const uint32_t bin = std::min(RC_BVH_BINS - 1, static_cast<uint32_t>((ref.centroid(bestAxis) - axis(centroidMin, bestAxis)) * scale[bestAxis]));
+						return bin < static_cast<uint32_t>(bestSplit);
+					});
+					splitCount = static_cast<uint32_t>(middle - refs);
+				}
+				// Every centroid in one spot, any half is as good as another
+				if (splitCount == 0 || splitCount == task.count) splitCount = task.count / 2;
+
+				const uint32_t child = this->used.fetch_add(2, std::memory_order_relaxed);
+				node.child = child;
+				this->tree.parents[child]     = task.node;
+				this->tree.parents[child + 1] = task.node;
+
+				stack.push_back({ child + 1, task.first + splitCount, task.count - splitCount });
+				stack.push_back({ child, task.first, splitCount });
+			}
+		}
+	};
+}
+
+void SceneBVH::buildTree(BVHTree& target, const DirectX::XMFLOAT3* mins, const DirectX::XMFLOAT3* maxs, const size_t count, const bool parallel) {
+	target.items.resize(count);
+	target.itemLeaf.resize(count);
+
+	if (count == 0) {
+		target.nodes.clear();
+		target.parents.clear();
+		return;
+	}
+
+	target.nodes.resize(count * 2 - 1);
+	target.parents.resize(count * 2 - 1);
+	target.parents[0] = 0;
+
+	TreeBuilder builder(target, mins, maxs, count);
+	const BuildTask root = { 0, 0, static_cast<uint32_t>(count) };
+
+	if (!parallel || !this->scheduler || this->threadsAmount == 1 || count <= RC_BVH_TASK_SIZE) {
+		builder.run(root, nullptr, 0);
+	}
+	else {
+		// The top of the tree is split here, the subtrees below it are built on the pool
+		std::vector<BuildTask> deferred;
+		builder.run(root, &deferred, RC_BVH_TASK_SIZE);
+
+		std::atomic<size_t> next = 0;
+		auto work = [&](int) {
+			for (size_t task = next.fetch_add(1); task < deferred.size(); task = next.fetch_add(1)) {
+				builder.run(deferred[task], nullptr, 0);
+			}
+		};
+
+		ThreadGroup* group = this->scheduler->scheduleWorkIndexed(std::min(this->threadsAmount, deferred.size()), work);
+		group->join();
+		delete group;
+	}
+
+	target.nodes.resize(builder.used.load());
+	target.parents.resize(target.nodes.size());
+}
+
+void SceneBVH::refitAll() {
+	// Children are always allocated after their parent, so walking backwards visits them first
+	for (size_t i = this->tree.nodes.size(); i-- > 0;) {
+		BVHNode& node = this->tree.nodes[i];
+		node.boundsMin = emptyMin;
+		node.boundsMax = emptyMax;
+
+		if (node.isLeaf()) {
+			for (uint32_t j = 0; j < node.count; j++) {
+				const uint32_t item = this->tree.items[node.first + j];
+				grow(node.boundsMin, node.boundsMax, this->itemMin[item], this->itemMax[item]);
+			}
+		}
+		else {
+			const BVHNode& left  = this->tree.nodes[node.child];
+			const BVHNode& right = this->tree.nodes[node.child + 1];
+			grow(node.boundsMin, node.boundsMax, left.boundsMin, left.boundsMax);
+			grow(node.boundsMin, node.boundsMax, right.boundsMin, right.boundsMax);
+		}
+	}
+}
+
+void SceneBVH::waitPending() {
+	if (!this->pendingGroup) return;
+
+	this->pendingGroup->join();
+	delete this->pendingGroup;
+	this->pendingGroup = nullptr;
+}
+
+void SceneBVH::resize(const size_t count) {
+	if (count == this->itemMin.size()) return;
+
+	this->itemMin.resize(count);
+	this->itemMax.resize(count);
+	this->needsRebuild = true;
+}
+
+void SceneBVH::update(const uint32_t item, const Bounds& bounds) {
+	if (item >= this->itemMin.size()) {
+		RC_DBG_ERROR("BVH item " << item << " is out of range, resize first");
+		return;
+	}
+
+	const DirectX::XMFLOAT3 boxMin(bounds.center.x - bounds.extents.x, bounds.center.y - bounds.extents.y, bounds.center.z - bounds.extents.z);
+	const DirectX::XMFLOAT3 boxMax(bounds.center.x + bounds.extents.x, bounds.center.y + bounds.extents.y, bounds.center.z + bounds.extents.z);
+	if (sameBox(boxMin, boxMax, this->itemMin[item], this->itemMax[item])) return;
+
+	this->itemMin[item] = boxMin;
+	this->itemMax[item] = boxMax;
+
+	if (this->needsRebuild) return;
+
+	const uint32_t leaf = this->tree.itemLeaf[item];
+	if (!this->leafDirty[leaf]) {
+		this->leafDirty[leaf] = 1;
+		this->dirtyLeaves.push_back(leaf);
+	}
+}
+
+void SceneBVH::commit() {
+	const size_t count = this->itemMin.size();
+	this->stats.refitLeaves = 0;
+
+	// A finished background build replaces the tree, one full refit catches up with what moved while it ran
+	if (this->pendingGroup && this->pendingGroup->finishedThreads.load(std::memory_order_acquire) >= this->pendingGroup->neededThreads) {
+		this->waitPending();
+
+		if (!this->needsRebuild && this->pending.items.size() == count) {
+			std::swap(this->tree, this->pending);
+			this->refitAll();
+
+			this->leafDirty.assign(this->tree.nodes.size(), 0);
+			this->dirtyLeaves.clear();
+			this->stats.rebuilds++;
+		}
+	}
+
+	if (this->needsRebuild) {
+		this->waitPending();
+
+		const auto buildStart = std::chrono::high_resolution_clock::now();
+		this->buildTree(this->tree, this->itemMin.data(), this->itemMax.data(), count, true);
+		this->stats.buildMilliseconds = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - buildStart).count();
+
+		this->leafDirty.assign(this->tree.nodes.size(), 0);
+		this->dirtyLeaves.clear();
+		this->needsRebuild        = false;
+		this->commitsSinceRebuild = 0;
+		this->stats.nodes         = this->tree.nodes.size();
+		this->stats.rebuilds++;
+		return;
+	}
+
+	// Refit only up the paths of leaves that moved, stopping where a parent box comes out the same
+	for (const uint32_t leaf : this->dirtyLeaves) {
+		this->leafDirty[leaf] = 0;
+
+		BVHNode& node = this->tree.nodes[leaf];
+		node.boundsMin = emptyMin;
+		node.boundsMax = emptyMax;
+		for (uint32_t j = 0; j < node.count; j++) {
+			const uint32_t item = this->tree.items[node.first + j];
+			grow(node.boundsMin, node.boundsMax, this->itemMin[item], this->itemMax[item]);
+		}
+
+		uint32_t current = leaf;
+		while (current != 0) {
+			BVHNode&       parent = this->tree.nodes[this->tree.parents[current]];
+			const BVHNode& left   = this->tree.nodes[parent.child];
+			const BVHNode& right  = this->tree.nodes[parent.child + 1];
+
+			DirectX::XMFLOAT3 boundsMin = left.boundsMin;
+			DirectX::XMFLOAT3 boundsMax = left.boundsMax;
+			grow(boundsMin, boundsMax, right.boundsMin, right.boundsMax);
+			if (sameBox(boundsMin, boundsMax, parent.boundsMin, parent.boundsMax)) break;
+
+			parent.boundsMin = boundsMin;
+			parent.boundsMax = boundsMax;
+			current          = this->tree.parents[current];
+		}
+	}
+	this->stats.refitLeaves = this->dirtyLeaves.size();
+	this->dirtyLeaves.clear();
+	this->stats.nodes = this->tree.nodes.size();
+
+	// Refitting keeps the tree correct but not good, a fresh one is built off the frame every so often
+	if (this->rebuildInterval && ++this->commitsSinceRebuild >= this->rebuildInterval && !this->pendingGroup && this->scheduler) {
+		this->commitsSinceRebuild = 0;
+		this->pendingMin          = this->itemMin;
+		this->pendingMax          = this->itemMax;
+
+		auto work = [this]() {
+			this->buildTree(this->pending, this->pendingMin.data(), this->pendingMax.data(), this->pendingMin.size(), false);
+		};
+		this->pendingGroup = this->scheduler->scheduleWork(1, work);
+	}
+}
+
+void SceneBVH::queryFrustum(const Frustum& frustum, std::vector<uint32_t>& out) const {
+	out.clear();
+	if (this->tree.nodes.empty()) return;
+
+	std::vector<uint32_t> stack = { 0 };
+	while (!stack.empty()) {
+		const uint32_t index = stack.back();
+		stack.pop_back();
+
+		const BVHNode&    node        = this->tree.nodes[index];
+		const Containment containment = classify(frustum, node.boundsMin, node.boundsMax);
+		if (containment == Containment::Outside) continue;
+
+		// Fully inside, everything under the node is visible without further tests
+		if (containment == Containment::Inside) {
+			out.insert(out.end(), this->tree.items.begin() + node.first, this->tree.items.begin() + node.first + node.count);
+			continue;
+		}
+
+		if (node.isLeaf()) {
+			for (uint32_t j = 0; j < node.count; j++) {
+				const uint32_t item = this->tree.items[node.first + j];
+				if (classify(frustum, this->itemMin[item], this->itemMax[item]) != Containment::Outside) out.push_back(item);
+			}
+			continue;
+		}
+
+		stack.push_back(node.child + 1);
+		stack.push_back(node.child);
+	}
+}
+
+void SceneBVH::queryBox(const DirectX::XMFLOAT3& boxMin, const DirectX::XMFLOAT3& boxMax, std::vector<uint32_t>& out) const {
+	out.clear();
+	if (this->tree.nodes.empty()) return;
+
+	std::vector<uint32_t> stack = { 0 };
+	while (!stack.empty()) {
+		const BVHNode& node = this->tree.nodes[stack.back()];
+		stack.pop_back();
+
+		if (!overlaps(node.boundsMin, node.boundsMax, boxMin, boxMax)) continue;
+
+		if (contains(boxMin, boxMax, node.boundsMin, node.boundsMax)) {
+			out.insert(out.end(), this->tree.items.begin() + node.first, this->tree.items.begin() + node.first + node.count);
+			continue;
+		}
+
+		if (node.isLeaf()) {
+			for (uint32_t j = 0; j < node.count; j++) {
+				const uint32_t item = this->tree.items[node.first + j];
+				if (overlaps(this->itemMin[item], this->itemMax[item], boxMin, boxMax)) out.push_back(item);
+			}
+			continue;
+		}
+
+		stack.push_back(node.child + 1);
+		stack.push_back(node.child);
+	}
+}
+
+bool SceneBVH::raycast(const BVHRay& ray, uint32_t* item, float* distance) const {
+	if (this->tree.nodes.empty()) return false;
+
+	const DirectX::XMFLOAT3 inverse(1.0f / ray.direction.x, 1.0f / ray.direction.y, 1.0f / ray.direction.z);
+
+	float    nearest = ray.maxDistance;
+	uint32_t hit     = UINT32_MAX;
+
+	std::vector<std::pair<uint32_t, float>> stack;
+	stack.emplace_back(0, rayBox(ray.origin, inverse, this->tree.nodes[0].boundsMin, this->tree.nodes[0].boundsMax, nearest));
+
+	while (!stack.empty()) {
+		const auto [index, entry] = stack.back();
+		stack.pop_back();
+
+		// A closer hit was found after this node was pushed
+		if (entry >= nearest) continue;
+
+		const BVHNode& node = this->tree.nodes[index];
+		if (node.isLeaf()) {
+			for (uint32_t j = 0; j < node.count; j++) {
+				const uint32_t candidate = this->tree.items[node.first + j];
+				const float    t         = rayBox(ray.origin, inverse, this->itemMin[candidate], this->itemMax[candidate], nearest);
+				if (t < nearest) {
+					nearest = t;
+					hit     = candidate;
+				}
+			}
+			continue;
+		}
+
+		const float left  = rayBox(ray.origin, inverse, this->tree.nodes[node.child].boundsMin, this->tree.nodes[node.child].boundsMax, nearest);
+		const float right = rayBox(ray.origin, inverse, this->tree.nodes[node.child + 1].boundsMin, this->tree.nodes[node.child + 1].boundsMax, nearest);
+
+		// Nearer child goes on top so it is opened first
+		if (left <= right) {
+			if (right < nearest) stack.emplace_back(node.child + 1, right);
+			if (left < nearest) stack.emplace_back(node.child, left);
+		}
+		else {
+			if (left < nearest) stack.emplace_back(node.child, left);
+			if (right < nearest) stack.emplace_back(node.child + 1, right);
+		}
+	}
+
+	if (hit == UINT32_MAX) return false;
+
+	if (item) *item = hit;
+	if (distance) *distance = nearest;
+	return true;
+}
\ No newline at end of file
@@ -0,0 +1,173 @@
+#include "ShaderCache.h"
+
+#include <fstream>
+
+namespace {
+	struct ShaderCacheHeader {
+		uint32_t magic;
+		uint32_t version;
+	};
+
+	bool writeHeader(const std::filesystem::path& path) {
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+
+		const ShaderCacheHeader header = { RC_SHADER_CACHE_MAGIC, RC_SHADER_CACHE_VERSION };
+		file.write(reinterpret_cast<const char*>(&header), sizeof(ShaderCacheHeader));
+		return file.good();
+	}
+}
+
+uint64_t shaderCacheKey(const ShaderCompileRequest& request, const uint64_t compilerVersion) noexcept {
+	uint64_t key = hashCombine(RC_FNV_OFFSET, RC_SHADER_CACHE_VERSION);
+	key = hashCombine(key, compilerVersion);
+	key = hashField(key, request.source);
+	key = hashField(key, request.entryPoint);
+	key = hashField(key, request.target);
+	key = hashCombine(key, request.flags);
+
+	key = hashCombine(key, static_cast<uint64_t>(request.defines.size()));
+	for (const ShaderDefine& define : request.defines) {
+		key = hashField(key, define.name);
+		key = hashField(key, define.value);
+	}
+	return key;
+}
+
+std::filesystem::path ShaderCache::blobPath(const uint64_t key) const {
+	char name[32];
+	snprintf(name, sizeof(name), "%016llx.cso", static_cast<unsigned long long>(key));
+	return this->directory / name;
+}
+
+bool ShaderCache::build(const std::filesystem::path& directory, ShaderCompiler compiler, const uint64_t compilerVersion) {
+	std::lock_guard<std::mutex> lock(this->mutex);
+
+	this->directory       = directory;
+	this->compiler        = std::move(compiler);
+	this->compilerVersion = compilerVersion;
+	this->index.clear();
+
+	if (this->directory.empty()) return true;
+
+	std::error_code error;
+	std::filesystem::create_directories(this->directory, error);
+	if (error) {
+		RC_DBG_ERROR("Failed to create the shader cache directory, shaders will not be cached! Path: " << this->directory.string());
+		this->directory.clear();
+		return false;
+	}
+
+	std::ifstream file(this->indexPath(), std::ios::binary);
+	if (!file.is_open()) return writeHeader(this->indexPath());
+
+	ShaderCacheHeader header = {};
+	file.read(reinterpret_cast<char*>(&header), sizeof(ShaderCacheHeader));
+	if (!file || header.magic != RC_SHADER_CACHE_MAGIC || header.version != RC_SHADER_CACHE_VERSION) {
+		RC_DBG_WARN("Shader cache index has an unknown format, starting an empty one. Path: " << this->indexPath().string());
+		file.close();
+		return writeHeader(this->indexPath());
+	}
+
+	// Records are appended as shaders get compiled, a later record for a key replaces the earlier one
+	IndexRecord record = {};
+	while (file.read(reinterpret_cast<char*>(&record), sizeof(IndexRecord))) {
+		this->index.insert_or_assign(record.key, record);
+	}
+	return true;
+}
+
+bool ShaderCache::readBlob(const IndexRecord& record, ShaderBytecode& out) const {
+	std::ifstream file(this->blobPath(record.key), std::ios::binary | std::ios::ate);
+	if (!file.is_open() || static_cast<uint64_t>(file.tellg()) != record.size) return false;
+
+	out.resize(record.size);
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(out.data()), record.size);
+
+	return file.good() && fnv1a64(out.data(), out.size()) == record.checksum;
+}
+
+void ShaderCache::store(const uint64_t key, const ShaderBytecode& bytecode) {
+	IndexRecord record = {};
+	record.key         = key;
+	record.size        = bytecode.size();
+	record.checksum    = fnv1a64(bytecode.data(), bytecode.size());
+
+	std::ofstream blob(this->blobPath(key), std::ios::binary | std::ios::trunc);
+	blob.write(reinterpret_cast<const char*>(bytecode.data()), bytecode.size());
+	if (!blob.good()) {
+		RC_DBG_ERROR("Failed to write a shader cache blob! Path: " << this->blobPath(key).string());
+		return;
+	}
+
+	std::ofstream file(this->indexPath(), std::ios::binary | std::ios::app);
+	file.write(reinterpret_cast<const char*>(&record), sizeof(IndexRecord));
+	if (!file.good()) {
+		RC_DBG_ERROR("Failed to append to the shader cache index! Path: " << this->indexPath().string());
+		return;
+	}
+
+	this->index.insert_or_assign(key, record);
+}
+
+bool ShaderCache::get(const ShaderCompileRequest& request, ShaderBytecode& out, std::string* error) {
+	const uint64_t key = shaderCacheKey(request, this->compilerVersion);
+
+	IndexRecord record = {};
+	bool        cached = false;
+	{
+		std::lock_guard<std::mutex> lock(this->mutex);
+
+		auto found = this->index.find(key);
+		if (found != this->index.end()) {
+			record = found->second;
+			cached = true;
+		}
+	}
+
+	if (cached) {
+		const bool valid = this->readBlob(record, out);
+
+		std::lock_guard<std::mutex> lock(this->mutex);
+		if (valid) {
+			this->stats.hits++;
+			return true;
+		}
+		this->stats.corruptEntries++;
+	}
+
+	std::string compileError;
+	const bool  compiled = this->compiler && this->compiler(request, out, compileError);
+
+	std::lock_guard<std::mutex> lock(this->mutex);
+	if (!compiled) {
+		this->stats.compileErrors++;
+		if (error) *error = this->compiler ? std::move(compileError) : "No shader compiler is set.";
+		return false;
+	}
+
+	this->stats.misses++;
+	if (!this->directory.empty()) this->store(key, out);
+	return true;
+}
+
+void ShaderCache::clear() {
+	std::lock_guard<std::mutex> lock(this->mutex);
+	if (this->directory.empty()) return;
+
+	std::error_code error;
+	for (auto& [key, record] : this->index) std::filesystem::remove(this->blobPath(key), error);
+	this->index.clear();
+
+	writeHeader(this->indexPath());
+}
+
+size_t ShaderCache::size() const {
+	std::lock_guard<std::mutex> lock(this->mutex);
+	return this->index.size();
+}
+
+ShaderCacheStats ShaderCache::getStats() const {
+	std::lock_guard<std::mutex> lock(this->mutex);
+	return this->stats;
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#include "ShaderVariants.h"
+
+void ShaderVariantSet::build(DirectX11Handler* handler, std::string vertexShaderSource, std::string pixelShaderSource, std::initializer_list<const char*> keywords) {
+	this->handler            = handler;
+	this->vertexShaderSource = std::move(vertexShaderSource);
+	this->pixelShaderSource  = std::move(pixelShaderSource);
+
+	this->keywords.clear();
+	for (const char* keyword : keywords) {
+		if (this->keywords.size() == RC_MAX_SHADER_KEYWORDS) {
+			RC_DBG_ERROR("Shader variant sets take at most " << RC_MAX_SHADER_KEYWORDS << " keywords, ignoring " << keyword << '.');
+			continue;
+		}
+		this->keywords.emplace_back(keyword);
+	}
+
+	this->variants.setCapacity(SIZE_MAX);
+}
+
+ShaderKeywordMask ShaderVariantSet::keyword(const std::string_view name) const {
+	for (size_t i = 0; i < this->keywords.size(); i++) {
+		if (this->keywords[i] == name) return ShaderKeywordMask(1) << i;
+	}
+	return 0;
+}
+ShaderKeywordMask ShaderVariantSet::mask(std::initializer_list<std::string_view> names) const {
+	ShaderKeywordMask mask = 0;
+	for (const std::string_view name : names) {
+		const ShaderKeywordMask bit = this->keyword(name);
+		RC_EI_ASSERT(bit == 0, "Unknown shader keyword " << name << '.');
+		mask |= bit;
+	}
+	return mask;
+}
+
+std::vector<ShaderDefine> ShaderVariantSet::defines(const ShaderKeywordMask mask) const {
+	std::vector<ShaderDefine> defines(this->keywords.size());
+	for (size_t i = 0; i < this->keywords.size(); i++) {
+		defines[i].name  = this->keywords[i];
+		defines[i].value = mask & (ShaderKeywordMask(1) << i) ? "1" : "0";
+	}
+	return defines;
+}
+
+std::shared_ptr<Shader> ShaderVariantSet::get(ShaderKeywordMask mask) {
+	// Bits past the declared keywords would compile the same variant under another key
+	const ShaderKeywordMask declared = this->keywords.size() >= RC_MAX_SHADER_KEYWORDS ? ~ShaderKeywordMask(0) : (ShaderKeywordMask(1) << this->keywords.size()) - 1;
+	RC_EI_ASSERT(mask & ~declared, "Shader variant mask " << mask << " uses undeclared keywords, they are ignored.");
+	mask &= declared;
+
+	return this->variants.acquire(mask, [&]() {
+		const std::vector<ShaderDefine> defines = this->defines(mask);
+		return this->handler->createShadersFromSource(this->vertexShaderSource, this->pixelShaderSource, defines);
+	});
+}
+
+void ShaderVariantSet::precompile(std::initializer_list<ShaderKeywordMask> masks) {
+	for (const ShaderKeywordMask mask : masks) this->get(mask);
+}
\ No newline at end of file
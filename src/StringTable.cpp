@@ -0,0 +1,95 @@
+#include "StringTable.h"
+
+#include <mutex>
+
+std::shared_mutex StringTable::mutex;
+
+FlatHashMap<std::string_view, StringID, StringHash, StringEqual> StringTable::ids;
+std::vector<StringTable::Entry>                                  StringTable::entries = { { std::string_view("", 0), fnv1a64(std::string_view()) } };
+std::vector<std::unique_ptr<char[]>>                             StringTable::blocks;
+size_t                                                           StringTable::blockUsed = StringTable::BLOCK_SIZE;
+
+std::string_view StringTable::store(const std::string_view str) {
+	// Strings are null terminated so c_str can hand them to C APIs
+	const size_t bytes = str.size() + 1;
+
+	char* destination;
+	if (bytes > BLOCK_SIZE / 4) {
+		// Large strings get their own block, kept in front of the block currently being filled
+		auto block  = std::make_unique<char[]>(bytes);
+		destination = block.get();
+
+		if (StringTable::blockUsed < BLOCK_SIZE) StringTable::blocks.insert(StringTable::blocks.end() - 1, std::move(block));
+		else StringTable::blocks.push_back(std::move(block));
+	}
+	else {
+		if (StringTable::blockUsed + bytes > BLOCK_SIZE) {
+			StringTable::blocks.push_back(std::make_unique<char[]>(BLOCK_SIZE));
+			StringTable::blockUsed = 0;
+		}
+
+		destination = StringTable::blocks.back().get() + StringTable::blockUsed;
+		StringTable::blockUsed += bytes;
+	}
+
+	memcpy(destination, str.data(), str.size());
+	destination[str.size()] = '\0';
+
+	return std::string_view(destination, str.size());
+}
+
+StringID StringTable::intern(const std::string_view str) {
+	if (str.empty()) return RC_EMPTY_STRING;
+
+	{
+		std::shared_lock<std::shared_mutex> lock(StringTable::mutex);
+
+		auto it = StringTable::ids.find(str);
+		if (it != StringTable::ids.end()) return it->second;
+	}
+
+	std::unique_lock<std::shared_mutex> lock(StringTable::mutex);
+
+	// Another thread may have interned it between the two locks
+	auto it = StringTable::ids.find(str);
+	if (it != StringTable::ids.end()) return it->second;
+
+	const std::string_view stored = StringTable::store(str);
+	const StringID         id     = static_cast<StringID>(StringTable::entries.size());
+
+	StringTable::entries.push_back({ stored, fnv1a64(stored) });
+	StringTable::ids.emplace(stored, id);
+
+	return id;
+}
+StringID StringTable::find(const std::string_view str) {
+	if (str.empty()) return RC_EMPTY_STRING;
+
+	std::shared_lock<std::shared_mutex> lock(StringTable::mutex);
+
+	auto it = StringTable::ids.find(str);
+	if (it == StringTable::ids.end()) return RC_EMPTY_STRING;
+
+	return it->second;
+}
+
+std::string_view StringTable::view(const StringID id) {
+	std::shared_lock<std::shared_mutex> lock(StringTable::mutex);
+
+	if (id >= StringTable::entries.size()) return {};
+	return StringTable::entries[id].str;
+}
+const char* StringTable::c_str(const StringID id) {
+	return StringTable::view(id).data();
+}
+uint64_t StringTable::hash(const StringID id) {
+	std::shared_lock<std::shared_mutex> lock(StringTable::mutex);
+
+	if (id >= StringTable::entries.size()) return StringTable::entries[RC_EMPTY_STRING].hash;
+	return StringTable::entries[id].hash;
+}
+
+size_t StringTable::size() {
+	std::shared_lock<std::shared_mutex> lock(StringTable::mutex);
+	return StringTable::entries.size();
+}
\ No newline at end of file
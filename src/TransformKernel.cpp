@@ -0,0 +1,224 @@
+#include "TransformKernel.h"
+
+namespace {
+	void composeTail(const TransformStreams& streams, const size_t begin, const size_t end, DirectX::XMFLOAT4X4* world, DirectX::XMFLOAT4X4* transposed) {
+		for (size_t i = begin; i < end; i++) {
+			const float x = streams.rotationX[i];
+			const float y = streams.rotationY[i];
+			const float z = streams.rotationZ[i];
+			const float w = streams.rotationW[i];
+
+			const float sx = streams.scaleX[i];
+			const float sy = streams.scaleY[i];
+			const float sz = streams.scaleZ[i];
+
+			const float m[3][3] = {
+				{ sx * (1.0f - 2.0f * (y * y + z * z)), sx * 2.0f * (x * y + w * z),          sx * 2.0f * (x * z - w * y) },
+				{ sy * 2.0f * (x * y - w * z),          sy * (1.0f - 2.0f * (x * x + z * z)), sy * 2.0f * (y * z + w * x) },
+				{ sz * 2.0f * (x * z + w * y),          sz * 2.0f * (y * z - w * x),          sz * (1.0f - 2.0f * (x * x + y * y)) },
+			};
+			const float t[3] = { streams.positionX[i], streams.positionY[i], streams.positionZ[i] };
+
+			if (world) {
+				world[i] = DirectX::XMFLOAT4X4(m[0][0], m[0][1], m[0][2], 0.0f,
+											   m[1][0], m[1][1], m[1][2], 0.0f,
+											   m[2][0], m[2][1], m[2][2], 0.0f,
+											   t[0],    t[1],    t[2],    1.0f);
+			}
+			if (transposed) {
+				transposed[i] = DirectX::XMFLOAT4X4(m[0][0], m[1][0], m[2][0], t[0],
+													m[0][1], m[1][1], m[2][1], t[1],
+													m[0][2], m[1][2], m[2][2], t[2],
+													0.0f,    0.0f,    0.0f,    1.0f);
+			}
+		}
+	}
+
+#if defined(__AVX2__)
+	// Lane k of a, b, c and d becomes the row of matrix k in the low half of out[k % 4], of matrix k + 4 in the high half
+	void transposeRows(const __m256 a, const __m256 b, const __m256 c, const __m256 d, __m256* out) {
+		const __m256 ab0 = _mm256_unpacklo_ps(a, b);
+		const __m256 ab1 = _mm256_unpackhi_ps(a, b);
+		const __m256 cd0 = _mm256_unpacklo_ps(c, d);
+		const __m256 cd1 = _mm256_unpackhi_ps(c, d);
+
+		out[0] = _mm256_shuffle_ps(ab0, cd0, _MM_SHUFFLE(1, 0, 1, 0));
+		out[1] = _mm256_shuffle_ps(ab0, cd0, _MM_SHUFFLE(3, 2, 3, 2));
+		out[2] = _mm256_shuffle_ps(ab1, cd1, _MM_SHUFFLE(1, 0, 1, 0));
+		out[3] = _mm256_shuffle_ps(ab1, cd1, _MM_SHUFFLE(3, 2, 3, 2));
+	}
+
+	// Pairs of rows are adjacent in a matrix, so each store writes two of them
+	void storeMatrices(const __m256* row0, const __m256* row1, const __m256* row2, const __m256* row3, DirectX::XMFLOAT4X4* out) {
+		for (int k = 0; k < 4; k++) {
+			_mm256_storeu_ps(out[k].m[0], _mm256_permute2f128_ps(row0[k], row1[k], 0x20));
+			_mm256_storeu_ps(out[k].m[2], _mm256_permute2f128_ps(row2[k], row3[k], 0x20));
+			_mm256_storeu_ps(out[k + 4].m[0], _mm256_permute2f128_ps(row0[k], row1[k], 0x31));
+			_mm256_storeu_ps(out[k + 4].m[2], _mm256_permute2f128_ps(row2[k], row3[k], 0x31));
+		}
+	}
+
+	size_t composeWide(const TransformStreams& streams, const size_t begin, const size_t end, DirectX::XMFLOAT4X4* world, DirectX::XMFLOAT4X4* transposed) {
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 one  = _mm256_set1_ps(1.0f);
+
+		size_t i = begin;
+		for (; i + 8 <= end; i += 8) {
+			const __m256 x = _mm256_loadu_ps(streams.rotationX.data() + i);
+			const __m256 y = _mm256_loadu_ps(streams.rotationY.data() + i);
+			const __m256 z = _mm256_loadu_ps(streams.rotationZ.data() + i);
+			const __m256 w = _mm256_loadu_ps(streams.rotationW.data() + i);
+
+			const __m256 x2 = _mm256_add_ps(x, x);
+			const __m256 y2 = _mm256_add_ps(y, y);
+			const __m256 z2 = _mm256_add_ps(z, z);
+
+			const __m256 xx = _mm256_mul_ps(x, x2);
+			const __m256 yy = _mm256_mul_ps(y, y2);
+			const __m256 zz = _mm256_mul_ps(z, z2);
+			const __m256 xy = _mm256_mul_ps(x, y2);
+			const __m256 xz = _mm256_mul_ps(x, z2);
+			const __m256 yz = _mm256_mul_ps(y, z2);
+			const __m256 wx = _mm256_mul_ps(w, x2);
+			const __m256 wy = _mm256_mul_ps(w, y2);
+			const __m256 wz = _mm256_mul_ps(w, z2);
+
+			const __m256 sx = _mm256_loadu_ps(streams.scaleX.data() + i);
+			const __m256 sy = _mm256_loadu_ps(streams.scaleY.data() + i);
+			const __m256 sz = _mm256_loadu_ps(streams.scaleZ.data() + i);
+
+			const __m256 m00 = _mm256_mul_ps(sx, _mm256_sub_ps(one, _mm256_add_ps(yy, zz)));
+			const __m256 m01 = _mm256_mul_ps(sx, _mm256_add_ps(xy, wz));
+			const __m256 m02 = _mm256_mul_ps(sx, _mm256_sub_ps(xz, wy));
+			const __m256 m10 = _mm256_mul_ps(sy, _mm256_sub_ps(xy, wz));
+			const __m256 m11 = _mm256_mul_ps(sy, _mm256_sub_ps(one, _mm256_add_ps(xx, zz)));
+			const __m256 m12 = _mm256_mul_ps(sy, _mm256_add_ps(yz, wx));
+			const __m256 m20 = _mm256_mul_ps(sz, _mm256_add_ps(xz, wy));
+			const __m256 m21 = _mm256_mul_ps(sz, _mm256_sub_ps(yz, wx));
+			const __m256 m22 = _mm256_mul_ps(sz, _mm256_sub_ps(one, _mm256_add_ps(xx, yy)));
+
+			const __m256 tx = _mm256_loadu_ps(streams.positionX.data() + i);
+			const __m256 ty = _mm256_loadu_ps(streams.positionY.data() + i);
+			const __m256 tz = _mm256_loadu_ps(streams.positionZ.data() + i);
+
+			__m256 row0[4];
+			__m256 row1[4];
+			__m256 row2[4];
+			__m256 row3[4];
+			if (world) {
+				transposeRows(m00, m01, m02, zero, row0);
+				transposeRows(m10, m11, m12, zero, row1);
+				transposeRows(m20, m21, m22, zero, row2);
+				transposeRows(tx, ty, tz, one, row3);
+				storeMatrices(row0, row1, row2, row3, world + i);
+			}
+			if (transposed) {
+				transposeRows(m00, m10, m20, tx, row0);
+				transposeRows(m01, m11, m21, ty, row1);
+				transposeRows(m02, m12, m22, tz, row2);
+				transposeRows(zero, zero, zero, one, row3);
+				storeMatrices(row0, row1, row2, row3, transposed + i);
+			}
+		}
+		return i;
+	}
+#else
+	// Lane k of a, b, c and d becomes the row of matrix first + k
+	void storeRows(__m128 a, __m128 b, __m128 c, __m128 d, DirectX::XMFLOAT4X4* out, const size_t first, const int row) {
+		_MM_TRANSPOSE4_PS(a, b, c, d);
+		_mm_storeu_ps(out[first + 0].m[row], a);
+		_mm_storeu_ps(out[first + 1].m[row], b);
+		_mm_storeu_ps(out[first + 2].m[row], c);
+		_mm_storeu_ps(out[first + 3].m[row], d);
+	}
+
+	size_t composeWide(const TransformStreams& streams, const size_t begin, const size_t end, DirectX::XMFLOAT4X4* world, DirectX::XMFLOAT4X4* transposed) {
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one  = _mm_set1_ps(1.0f);
+
+		size_t i = begin;
+		for (; i + 4 <= end; i += 4) {
+			const __m128 x = _mm_loadu_ps(streams.rotationX.data() + i);
+			const __m128 y = _mm_loadu_ps(streams.rotationY.data() + i);
+			const __m128 z = _mm_loadu_ps(streams.rotationZ.data() + i);
+			const __m128 w = _mm_loadu_ps(streams.rotationW.data() + i);
+
+			const __m128 x2 = _mm_add_ps(x, x);
+			const __m128 y2 = _mm_add_ps(y, y);
+			const __m128 z2 = _mm_add_ps(z, z);
+
+			const __m128 xx = _mm_mul_ps(x, x2);
+			const __m128 yy = _mm_mul_ps(y, y2);
+			const __m128 zz = _mm_mul_ps(z, z2);
+			const __m128 xy = _mm_mul_ps(x, y2);
+			const __m128 xz = _mm_mul_ps(x, z2);
+			const __m128 yz = _mm_mul_ps(y, z2);
+			const __m128 wx = _mm_mul_ps(w, x2);
+			const __m128 wy = _mm_mul_ps(w, y2);
+			const __m128 wz = _mm_mul_ps(w, z2);
+
+			const __m128 sx = _mm_loadu_ps(streams.scaleX.data() + i);
+			const __m128 sy = _mm_loadu_ps(streams.scaleY.data() + i);
+			const __m128 sz = _mm_loadu_ps(streams.scaleZ.data() + i);
+
+			const __m128 m00 = _mm_mul_ps(sx, _mm_sub_ps(one, _mm_add_ps(yy, zz)));
+			const __m128 m01 = _mm_mul_ps(sx, _mm_add_ps(xy, wz));
+			const __m128 m02 = _mm_mul_ps(sx, _mm_sub_ps(xz, wy));
+			const __m128 m10 = _mm_mul_ps(sy, _mm_sub_ps(xy, wz));
+			const __m128 m11 = _mm_mul_ps(sy, _mm_sub_ps(one, _mm_add_ps(xx, zz)));
+			const __m128 m12 = _mm_mul_ps(sy, _mm_add_ps(yz, wx));
+			const __m128 m20 = _mm_mul_ps(sz, _mm_add_ps(xz, wy));
+			const __m128 m21 = _mm_mul_ps(sz, _mm_sub_ps(yz, wx));
+			const __m128 m22 = _mm_mul_ps(sz, _mm_sub_ps(one, _mm_add_ps(xx, yy)));
+
+			const __m128 tx = _mm_loadu_ps(streams.positionX.data() + i);
+			const __m128 ty = _mm_loadu_ps(streams.positionY.data() + i);
+			const __m128 tz = _mm_loadu_ps(streams.positionZ.data() + i);
+
+			if (world) {
+				storeRows(m00, m01, m02, zero, world, i, 0);
+				storeRows(m10, m11, m12, zero, world, i, 1);
+				storeRows(m20, m21, m22, zero, world, i, 2);
+				storeRows(tx, ty, tz, one, world, i, 3);
+			}
+			if (transposed) {
+				storeRows(m00, m10, m20, tx, transposed, i, 0);
+				storeRows(m01, m11, m21, ty, transposed, i, 1);
+				storeRows(m02, m12, m22, tz, transposed, i, 2);
+				storeRows(zero, zero, zero, one, transposed, i, 3);
+			}
+		}
+		return i;
+	}
+#endif
+}
+
+void composeRange(const TransformStreams& streams, const size_t begin, const size_t end, DirectX::XMFLOAT4X4* world, DirectX::XMFLOAT4X4* transposed) {
+	const size_t processedEnd = composeWide(streams, begin, end, world, transposed);
+	composeTail(streams, processedEnd, end, world, transposed);
+}
+
+void TransformKernel::compose(const TransformStreams& streams, DirectX::XMFLOAT4X4* world, DirectX::XMFLOAT4X4* transposed) {
+	const size_t count = streams.size();
+
+	size_t chunks = 1;
+	if (this->scheduler && count >= RC_TRANSFORM_CHUNK_SIZE * 2) {
+		chunks = std::min(this->threadsAmount, count / RC_TRANSFORM_CHUNK_SIZE);
+	}
+
+	if (chunks == 1) {
+		composeRange(streams, 0, count, world, transposed);
+		return;
+	}
+
+	// Chunk bounds stay multiples of 8 so only the last chunk has a scalar tail
+	auto work = [&](const size_t chunk) {
+		const size_t begin = (chunk * count / chunks) & ~size_t(7);
+		const size_t end   = chunk + 1 == chunks ? count : ((chunk + 1) * count / chunks) & ~size_t(7);
+		composeRange(streams, begin, end, world, transposed);
+	};
+
+	ThreadGroup* group = this->scheduler->scheduleWorkIndexed(chunks, work);
+	group->join();
+	delete group;
+}
\ No newline at end of file
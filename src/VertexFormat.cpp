@@ -0,0 +1,115 @@
+#include "VertexFormat.h"
+
+#include <DirectXPackedVector.h>
+
+#include <cmath>
+#include <algorithm>
+
+namespace {
+	int16_t toSnorm16(const float value) {
+		return static_cast<int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+	}
+	float fromSnorm16(const int16_t value) {
+		// -32768 and -32767 both read as -1, like the input assembler does
+		return std::max(value / 32767.0f, -1.0f);
+	}
+
+	float signNotZero(const float value) {
+		return value >= 0.0f ? 1.0f : -1.0f;
+	}
+
+	// Safe scale for a flat axis, its positions all quantize to 0 either way
+	float axisScale(const float extent) {
+		return extent > 0.0f ? extent : 1.0f;
+	}
+}
+
+DirectX::XMFLOAT2 encodeOctNormal(const DirectX::XMFLOAT3& normal) {
+	const float length = fabsf(normal.x) + fabsf(normal.y) + fabsf(normal.z);
+	if (length == 0.0f) return { 0.0f, 0.0f };
+
+	// Onto the octahedron, then the lower half is folded over the upper one's corners
+	DirectX::XMFLOAT2 encoded(normal.x / length, normal.y / length);
+	if (normal.z < 0.0f) {
+		encoded = DirectX::XMFLOAT2((1.0f - fabsf(encoded.y)) * signNotZero(encoded.x),
+									(1.0f - fabsf(encoded.x)) * signNotZero(encoded.y));
+	}
+	return encoded;
+}
+DirectX::XMFLOAT3 decodeOctNormal(const DirectX::XMFLOAT2& encoded) {
+	DirectX::XMFLOAT3 normal(encoded.x, encoded.y, 1.0f - fabsf(encoded.x) - fabsf(encoded.y));
+
+	const float fold = std::max(-normal.z, 0.0f);
+	normal.x += normal.x >= 0.0f ? -fold : fold;
+	normal.y += normal.y >= 0.0f ? -fold : fold;
+
+	const float length = sqrtf(normal.x * normal.x + normal.y * normal.y + normal.z * normal.z);
+	return { normal.x / length, normal.y / length, normal.z / length };
+}
+
+void compactVertices(const std::vector<Vertex>&  vertices,
+					 const Bounds&               bounds,
+					 std::vector<CompactVertex>* outVertices,
+					 DirectX::XMFLOAT4X4*        outDequantize,
+					 VertexCompactionStats*      outStats)
+{
+	using namespace DirectX::PackedVector;
+
+	const DirectX::XMFLOAT3& center = bounds.center;
+	const DirectX::XMFLOAT3  scale(axisScale(bounds.extents.x), axisScale(bounds.extents.y), axisScale(bounds.extents.z));
+
+	*outDequantize = DirectX::XMFLOAT4X4(scale.x,  0.0f,     0.0f,     0.0f,
+										 0.0f,     scale.y,  0.0f,     0.0f,
+										 0.0f,     0.0f,     scale.z,  0.0f,
+										 center.x, center.y, center.z, 1.0f);
+
+	VertexCompactionStats stats = {};
+	stats.fullBytes    = vertices.size() * sizeof(Vertex);
+	stats.compactBytes = vertices.size() * sizeof(CompactVertex);
+
+	float minNormalCos = 1.0f;
+
+	outVertices->resize(vertices.size());
+	for (size_t i = 0; i < vertices.size(); i++) {
+		const Vertex&  vertex  = vertices[i];
+		CompactVertex& compact = (*outVertices)[i];
+
+		compact.position[0] = toSnorm16((vertex.position.x - center.x) / scale.x);
+		compact.position[1] = toSnorm16((vertex.position.y - center.y) / scale.y);
+		compact.position[2] = toSnorm16((vertex.position.z - center.z) / scale.z);
+		compact.position[3] = 0;
+
+		const DirectX::XMFLOAT2 octahedral = encodeOctNormal(vertex.normal);
+		compact.normal[0] = toSnorm16(octahedral.x);
+		compact.normal[1] = toSnorm16(octahedral.y);
+
+		compact.uv[0] = XMConvertFloatToHalf(vertex.uv.x);
+		compact.uv[1] = XMConvertFloatToHalf(vertex.uv.y);
+
+		// Decoded the way the GPU will, so the errors are what ends up on screen
+		const float dx = fromSnorm16(compact.position[0]) * scale.x + center.x - vertex.position.x;
+		const float dy = fromSnorm16(compact.position[1]) * scale.y + center.y - vertex.position.y;
+		const float dz = fromSnorm16(compact.position[2]) * scale.z + center.z - vertex.position.z;
+		stats.maxPositionError = std::max(stats.maxPositionError, sqrtf(dx * dx + dy * dy + dz * dz));
+
+		const float normalLength = sqrtf(vertex.normal.x * vertex.normal.x + vertex.normal.y * vertex.normal.y + vertex.normal.z * vertex.normal.z);
+		if (normalLength > 0.0f) {
+			const DirectX::XMFLOAT3 decoded = decodeOctNormal({ fromSnorm16(compact.normal[0]), fromSnorm16(compact.normal[1]) });
+			const float cosine = (decoded.x * vertex.normal.x + decoded.y * vertex.normal.y + decoded.z * vertex.normal.z) / normalLength;
+			minNormalCos = std::min(minNormalCos, cosine);
+		}
+
+		stats.maxUvError = std::max({ stats.maxUvError,
+									  fabsf(XMConvertHalfToFloat(compact.uv[0]) - vertex.uv.x),
+									  fabsf(XMConvertHalfToFloat(compact.uv[1]) - vertex.uv.y) });
+	}
+	stats.maxNormalError = DirectX::XMConvertToDegrees(acosf(std::clamp(minNormalCos, -1.0f, 1.0f)));
+
+	if (outStats) *outStats = stats;
+}
+
+std::vector<uint16_t> shortIndices(const std::vector<uint32_t>& indices) {
+	std::vector<uint16_t> out(indices.size());
+	for (size_t i = 0; i < indices.size(); i++) out[i] = static_cast<uint16_t>(indices[i]);
+	return out;
+}
\ No newline at end of file
@@ -2,6 +2,8 @@
 
 #include "DirectX11Handler.h"
 
+#ifndef RC_HEADLESS
+
 LRESULT CALLBACK Window::DefWEWindowProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam) {
     if (ImGui_ImplWin32_WndProcHandler(hWnd, uMsg, wParam, lParam)) return true;
 
@@ -114,4 +116,41 @@ BOOL Window::poolEvents() {
         DispatchMessage(&this->msg);
     }
     return returnValue;
-}
\ No newline at end of file
+}
+void Window::close() {
+    PostMessage(this->hWnd, WM_CLOSE, 0, 0);
+}
+#else
+// Nothing is created, the size is only what the renderer reads for its viewport and projection
+Window::Window(const wchar_t*,
+               const int,
+               const int,
+               const int      width,
+               const int      height) :
+    width(width), height(height)
+{
+    this->wip.w     = &this->width;
+    this->wip.h     = &this->height;
+    this->wip.dx11h = nullptr;
+}
+Window::Window(const wchar_t*,
+               const wchar_t* windowName,
+               const int      x,
+               const int      y,
+               const int      width,
+               const int      height) :
+    Window(windowName, x, y, width, height)
+{}
+
+void Window::setWIP(DirectX11Handler* dx11h) {
+    this->wip.dx11h = dx11h;
+}
+
+BOOL Window::poolEvents() {
+    return FALSE;
+}
+
+void Window::close() {
+    this->squit = TRUE;
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,298 @@
+#include "WorldSnapshot.h"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+	// Read only view of a whole file, the columns are copied straight out of it
+#ifdef _WIN32
+	class MappedFile {
+	private:
+		HANDLE file    = INVALID_HANDLE_VALUE;
+		HANDLE mapping = nullptr;
+
+		const unsigned char* view = nullptr;
+		uint64_t             size = 0;
+
+	public:
+		MappedFile(const std::string& path) {
+			this->file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+			if (this->file == INVALID_HANDLE_VALUE) return;
+
+			LARGE_INTEGER fileSize = {};
+			if (!GetFileSizeEx(this->file, &fileSize) || fileSize.QuadPart == 0) return;
+			this->size = fileSize.QuadPart;
+
+			this->mapping = CreateFileMappingA(this->file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (!this->mapping) return;
+
+			this->view = static_cast<const unsigned char*>(MapViewOfFile(this->mapping, FILE_MAP_READ, 0, 0, 0));
+		}
+		~MappedFile() {
+			if (this->view) UnmapViewOfFile(this->view);
+			if (this->mapping) CloseHandle(this->mapping);
+			if (this->file != INVALID_HANDLE_VALUE) CloseHandle(this->file);
+		}
+
+		const unsigned char* data() const noexcept { return this->view; }
+		uint64_t bytes() const noexcept { return this->size; }
+	};
+#else
+	class MappedFile {
+	private:
+		int file = -1;
+
+		const unsigned char* view = nullptr;
+		uint64_t             size = 0;
+
+	public:
+		MappedFile(const std::string& path) {
+			this->file = open(path.c_str(), O_RDONLY);
+			if (this->file < 0) return;
+
+			struct stat fileStat = {};
+			if (fstat(this->file, &fileStat) != 0 || fileStat.st_size == 0) return;
+			this->size = fileStat.st_size;
+
+			void* mapped = mmap(nullptr, this->size, PROT_READ, MAP_PRIVATE, this->file, 0);
+			if (mapped == MAP_FAILED) return;
+
+			madvise(mapped, this->size, MADV_SEQUENTIAL);
+			this->view = static_cast<const unsigned char*>(mapped);
+		}
+		~MappedFile() {
+			if (this->view) munmap(const_cast<unsigned char*>(this->view), this->size);
+			if (this->file >= 0) close(this->file);
+		}
+
+		const unsigned char* data() const noexcept { return this->view; }
+		uint64_t bytes() const noexcept { return this->size; }
+	};
+#endif
+
+	uint64_t alignUp(const uint64_t value) {
+		return (value + RC_SNAPSHOT_ALIGNMENT - 1) & ~(RC_SNAPSHOT_ALIGNMENT - 1);
+	}
+	void writePadding(std::ofstream& file) {
+		static const char zeros[RC_SNAPSHOT_ALIGNMENT] = {};
+
+		const uint64_t position = static_cast<uint64_t>(file.tellp());
+		file.write(zeros, alignUp(position) - position);
+	}
+}
+
+uint32_t WorldSnapshot::addString(const StringID id) {
+	if (id == RC_EMPTY_STRING) return 0;
+
+	// Interned strings are shared between models, so each one is written once
+	auto it = this->offsets.find(id);
+	if (it != this->offsets.end()) return it->second;
+
+	const std::string_view str    = StringTable::view(id);
+	const uint32_t         offset = static_cast<uint32_t>(this->strings.size());
+	this->strings.insert(this->strings.end(), str.begin(), str.end());
+	this->strings.push_back('\0');
+
+	this->offsets.emplace(id, offset);
+	return offset;
+}
+
+bool WorldSnapshot::write(const std::string& path, ObjectsManager* objectsManager) {
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file.is_open()) {
+		RC_DBG_ERROR("Failed to open snapshot for writing! File path: " << path);
+		return false;
+	}
+
+	// Offset 0 is reserved for empty strings
+	this->strings.assign(1, '\0');
+	this->offsets.clear();
+
+	std::vector<ModelRecord> records;
+	if (auto* models = objectsManager->getColumn(typeid(std::unique_ptr<Model>))) {
+		records.reserve(models->size());
+
+		for (size_t i = 0; i < models->size(); i++) {
+			const Model* model = models->at<std::unique_ptr<Model>>(i)->get();
+
+			ModelRecord record = {};
+			record.entity      = static_cast<uint32_t>(i);
+			record.meshPath    = model->mesh ? this->addString(model->mesh->path) : 0;
+			record.texturePath = model->texture ? this->addString(model->texture->path) : 0;
+			record.name        = this->addString(model->name);
+
+			DirectX::XMStoreFloat3(&record.position, model->transform.position);
+			DirectX::XMStoreFloat4(&record.rotation, model->transform.rotation);
+			DirectX::XMStoreFloat3(&record.scale, model->transform.scale);
+
+			records.push_back(record);
+		}
+	}
+
+	std::vector<std::tuple<HashKey, const ComponentInfo*, FlexibleVector<>*>> columns;
+	for (auto& [key, info] : objectsManager->getComponents()) {
+		if (auto* column = objectsManager->getColumn(key)) columns.push_back({ key, &info, column });
+	}
+
+	SnapshotHeader header  = {};
+	header.magic           = RC_SNAPSHOT_MAGIC;
+	header.version         = RC_SNAPSHOT_VERSION;
+	header.columnCount     = static_cast<uint32_t>(columns.size());
+	header.modelCount      = static_cast<uint32_t>(records.size());
+	header.stringTableSize = this->strings.size();
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(SnapshotHeader));
+	file.write(this->strings.data(), this->strings.size());
+	writePadding(file);
+	file.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(ModelRecord));
+	writePadding(file);
+
+	for (auto& [key, info, column] : columns) {
+		const EntitySlots* slots = objectsManager->getSlots(key);
+
+		SnapshotColumnHeader columnHeader = {};
+		columnHeader.nameHash             = info->nameHash;
+		columnHeader.itemSize             = info->itemSize;
+		columnHeader.count                = column->size();
+		columnHeader.slotCount            = slots ? slots->getGenerations().size() : 0;
+
+		file.write(reinterpret_cast<const char*>(&columnHeader), sizeof(SnapshotColumnHeader));
+		file.write(reinterpret_cast<const char*>(column->data()), column->size() * info->itemSize);
+		writePadding(file);
+
+		// Slot tables keep entity handles valid across a save and load
+		if (columnHeader.slotCount > 0) {
+			file.write(reinterpret_cast<const char*>(slots->getDenseToSlot().data()), columnHeader.count * sizeof(uint32_t));
+			file.write(reinterpret_cast<const char*>(slots->getGenerations().data()), columnHeader.slotCount * sizeof(uint32_t));
+			writePadding(file);
+		}
+	}
+
+	if (!file.good()) {
+		RC_DBG_ERROR("Failed to write snapshot! File path: " << path);
+		return false;
+	}
+	return true;
+}
+
+bool WorldSnapshot::read(const std::string& path, ObjectsManager* objectsManager, Renderer* renderer, const SnapshotResolver& resolver) {
+	MappedFile file(path);
+	if (!file.data()) {
+		RC_DBG_ERROR("Failed to open snapshot for reading! File path: " << path);
+		return false;
+	}
+
+	const unsigned char* begin = file.data();
+	const uint64_t       size  = file.bytes();
+
+	// Every length comes from the file, so each one is checked against what is left before it is used
+	uint64_t offset = 0;
+	auto remaining = [&]() { return size - offset; };
+	auto truncated = [&]() {
+		RC_DBG_ERROR("Snapshot is truncated or corrupt! File path: " << path);
+		return false;
+	};
+
+	if (size < sizeof(SnapshotHeader)) return truncated();
+
+	SnapshotHeader header = {};
+	memcpy(&header, begin, sizeof(SnapshotHeader));
+	if (header.magic != RC_SNAPSHOT_MAGIC || header.version != RC_SNAPSHOT_VERSION) {
+		RC_DBG_ERROR("Snapshot has an unknown format! File path: " << path);
+		return false;
+	}
+	offset = sizeof(SnapshotHeader);
+
+	// The writer ends every string with a null, a table that does not end with one was cut short
+	const char* strings = reinterpret_cast<const char*>(begin + offset);
+	if (header.stringTableSize == 0 || header.stringTableSize > remaining() || strings[header.stringTableSize - 1] != '\0') return truncated();
+	offset = std::min(alignUp(offset + header.stringTableSize), size);
+
+	if (header.modelCount > remaining() / sizeof(ModelRecord)) return truncated();
+
+	std::vector<ModelRecord> records(header.modelCount);
+	if (!records.empty()) memcpy(records.data(), begin + offset, records.size() * sizeof(ModelRecord));
+	offset = std::min(alignUp(offset + records.size() * sizeof(ModelRecord)), size);
+
+	struct ColumnView {
+		SnapshotColumnHeader header;
+		const unsigned char* elements;
+		const uint32_t*      denseToSlot;
+		const uint32_t*      generations;
+	};
+
+	// Columns are only restored once the whole file checked out, a bad one must not leave the world half replaced
+	std::vector<ColumnView> columns;
+	columns.reserve(std::min<uint64_t>(header.columnCount, remaining() / sizeof(SnapshotColumnHeader)));
+	for (uint32_t i = 0; i < header.columnCount; i++) {
+		if (remaining() < sizeof(SnapshotColumnHeader)) return truncated();
+
+		ColumnView column = {};
+		memcpy(&column.header, begin + offset, sizeof(SnapshotColumnHeader));
+		offset += sizeof(SnapshotColumnHeader);
+
+		const SnapshotColumnHeader& columnHeader = column.header;
+		if (columnHeader.itemSize == 0 || columnHeader.count > remaining() / columnHeader.itemSize) return truncated();
+
+		column.elements = begin + offset;
+		offset = std::min(alignUp(offset + columnHeader.count * columnHeader.itemSize), size);
+
+		if (columnHeader.slotCount > 0) {
+			if (columnHeader.count > UINT32_MAX || columnHeader.slotCount > UINT32_MAX) return truncated();
+			if (columnHeader.count > remaining() / sizeof(uint32_t)) return truncated();
+			if (columnHeader.slotCount > (remaining() - columnHeader.count * sizeof(uint32_t)) / sizeof(uint32_t)) return truncated();
+
+			column.denseToSlot = reinterpret_cast<const uint32_t*>(begin + offset);
+			column.generations = column.denseToSlot + columnHeader.count;
+			if (!EntitySlots::validate(column.denseToSlot, static_cast<uint32_t>(columnHeader.count), static_cast<uint32_t>(columnHeader.slotCount))) return truncated();
+
+			offset = std::min(alignUp(offset + (columnHeader.count + columnHeader.slotCount) * sizeof(uint32_t)), size);
+		}
+
+		for (auto& [key, info] : objectsManager->getComponents()) {
+			if (info.nameHash == columnHeader.nameHash && info.itemSize != columnHeader.itemSize) {
+				RC_DBG_ERROR("Component " << info.name << " changed size since the snapshot was written!");
+				return false;
+			}
+		}
+
+		columns.push_back(column);
+	}
+
+	for (const ColumnView& column : columns) {
+		[[maybe_unused]] bool restored = false;
+		for (auto& [key, info] : objectsManager->getComponents()) {
+			if (info.nameHash != column.header.nameHash) continue;
+
+			restored = objectsManager->restoreColumn(key, column.elements, column.header.count,
+													 column.denseToSlot, column.generations, static_cast<uint32_t>(column.header.slotCount));
+			break;
+		}
+		RC_WI_ASSERT(!restored, "Snapshot column " << column.header.nameHash << " has no registered component, skipping it.");
+	}
+
+	if (!resolver) return true;
+
+	for (auto& record : records) {
+		const uint64_t lastString = std::max({ record.meshPath, record.texturePath, record.name });
+		if (lastString >= header.stringTableSize) {
+			RC_DBG_ERROR("Snapshot model " << record.entity << " references a string outside the string table, skipping it.");
+			continue;
+		}
+
+		Model model = resolver(strings + record.meshPath, strings + record.texturePath);
+
+		model.transform.position = DirectX::XMLoadFloat3(&record.position);
+		model.transform.rotation = DirectX::XMLoadFloat4(&record.rotation);
+		model.transform.scale    = DirectX::XMLoadFloat3(&record.scale);
+		model.name               = StringTable::intern(strings + record.name);
+
+		renderer->toQueue(std::move(model));
+	}
+
+	return true;
+}
\ No newline at end of file
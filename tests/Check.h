@@ -0,0 +1,19 @@
+#pragma once
+#include <cstdio>
+
+// Shared by the tests: a failed check is printed and counted, the test goes on and reports at the end
+
+inline int failures = 0;
+
+inline void check(const bool condition, const char* what) {
+	if (condition) return;
+
+	std::printf("FAILED: %s\n", what);
+	failures++;
+}
+
+// Exit code of the test, non zero when any check failed
+inline int finish(const char* test) {
+	if (failures == 0) std::printf("%s passed\n", test);
+	return failures == 0 ? 0 : 1;
+}
\ No newline at end of file
@@ -0,0 +1,104 @@
+#include "DirectX11Handler.h"
+#include "Window.h"
+#include "Check.h"
+
+#include <cstdio>
+
+// Records command lists the way the renderer's recording threads do and plays them back through the handler.
+// Headless only, the checks read the null backend's validation counters
+
+namespace {
+	struct alignas(16) DrawConstants {
+		float color[4];
+		float offset[4];
+	};
+}
+
+int main() {
+	Window window(L"CommandListTest", 0, 0, 320, 240);
+
+	DirectX11HandlerDescription description;
+	description.shaderCacheDirectory = "";
+	DirectX11Handler device(&window, description);
+	DirectX11Handler* handler = &device;
+
+	const Shader plain     = handler->createShadersFromSource("float4 VSMain()", "float4 PSMain()");
+	const Shader instanced = handler->createShadersFromSource("float4 VSMain() INSTANCE_WORLD", "float4 PSMain()");
+
+	Microsoft::WRL::ComPtr<ID3D11Buffer> vertexBuffer;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> indexBuffer;
+	Microsoft::WRL::ComPtr<ID3D11Buffer> shortIndexBuffer;
+	handler->createVertexArrayBuffer(&vertexBuffer, std::vector<Vertex>(4));
+	handler->createIndexArrayBuffer(&indexBuffer, std::vector<uint32_t>{ 0, 1, 2, 0, 2, 3 });
+	handler->createIndexArrayBuffer(&shortIndexBuffer, std::vector<uint16_t>{ 0, 1, 2, 0, 2, 3 });
+
+	Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> texture;
+	handler->createShaderResourceView(&texture, vertexBuffer);
+
+	const DrawConstants constants = {};
+	Microsoft::WRL::ComPtr<ID3D11Buffer> constantBuffer;
+	handler->createConstantBuffer(&constantBuffer, constants);
+	const GpuHandle buffers[1] = { constantBuffer.Get() };
+
+	// Two lists, the second one relies on the pipeline and geometry the first leaves bound
+	std::vector<CommandList> lists(2);
+	for (int frame = 0; frame < 2; frame++) {
+		lists[0].reset();
+		lists[1].reset();
+
+		lists[0].setPipeline(plain.vertexShader.Get(), plain.pixelShader.Get(), plain.inputLayout.Get());
+		lists[0].setGeometry(vertexBuffer.Get(), indexBuffer.Get(), sizeof(Vertex), false);
+		lists[0].setTexture(0, texture.Get());
+		lists[0].setBuffers(RC_COMMAND_ALL_STAGES, 1, buffers, 1);
+		lists[0].setConstants(RC_COMMAND_VERTEX_STAGE, 0, constants);
+		lists[0].draw(6, 0);
+		lists[0].setPipeline(plain.vertexShader.Get(), plain.pixelShader.Get(), plain.inputLayout.Get());
+		lists[0].setGeometry(vertexBuffer.Get(), shortIndexBuffer.Get(), sizeof(Vertex), false, sizeof(uint16_t));
+		lists[0].draw(3, 3);
+
+		lists[1].setConstants(RC_COMMAND_VERTEX_STAGE, 0, constants);
+		lists[1].draw(6, 0);
+		lists[1].setBlend(true);
+		lists[1].setPipeline(instanced.vertexShader.Get(), instanced.pixelShader.Get(), instanced.inputLayout.Get());
+		lists[1].setGeometry(vertexBuffer.Get(), indexBuffer.Get(), sizeof(Vertex), true);
+		lists[1].drawInstanced(6, 0, 10, 0);
+
+		handler->beginInstances(10);
+		handler->endInstances();
+		handler->execute(lists);
+		handler->present();
+	}
+
+	const size_t recorded = lists[0].getStats().commands + lists[1].getStats().commands;
+	check(lists[0].getStats().draws == 2 && lists[1].getStats().draws == 2, "the lists count their draws");
+	check(recorded == 15, "the lists count their commands");
+
+	const NullFrameStats& stats = handler->getFrameStats();
+	check(stats.errors == 0, "replayed lists draw without validation errors");
+	check(stats.commands == recorded, "every recorded command is played back");
+	check(stats.draws == 4 && stats.instancedDraws == 1 && stats.instances == 10, "plain and instanced draws are played back");
+	check(stats.triangles == 2 + 1 + 2 + 20, "draws keep their index counts");
+	check(stats.constantBytes == 2 * sizeof(DrawConstants), "inline constants are copied into the ring");
+
+	// Played back alone, the second list draws without its pipeline
+	handler->beginInstances(10);
+	handler->endInstances();
+	handler->execute(&lists[1], 1);
+	handler->present();
+	check(handler->getFrameStats().errors == 1 && handler->getFrameStats().draws == 1, "a list relying on earlier state fails on its own");
+
+	// 16 bit indices are checked against their own size
+	CommandList overrun;
+	overrun.setPipeline(plain.vertexShader.Get(), plain.pixelShader.Get(), plain.inputLayout.Get());
+	overrun.setGeometry(vertexBuffer.Get(), shortIndexBuffer.Get(), sizeof(Vertex), false, sizeof(uint16_t));
+	overrun.draw(6, 3);
+	handler->execute(&overrun, 1);
+	handler->present();
+	check(handler->getFrameStats().errors == 1 && handler->getFrameStats().draws == 0, "a draw past a 16 bit index buffer is rejected");
+
+	// A reset list is empty and records the same commands again
+	overrun.reset();
+	check(overrun.empty() && overrun.getStats().commands == 0, "reset empties a list");
+
+	return finish("CommandListTest");
+}
\ No newline at end of file
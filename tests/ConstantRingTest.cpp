@@ -0,0 +1,116 @@
+#include "ConstantRing.h"
+#include "Check.h"
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// ConstantRingAllocator bookkeeping: alignment, wraparound and bytes only coming back once their frame's fence retired them
+
+namespace {
+	struct Block {
+		uint64_t frame;
+		size_t   offset;
+		size_t   size;
+	};
+}
+
+int main() {
+	ConstantRingAllocator ring;
+
+	// Alignment
+	ring.build(1000);
+	check(ring.capacity() == 768, "the capacity is rounded down to whole blocks");
+	check(ring.allocate(1) == 0, "a small allocation takes a whole block");
+	check(ring.allocate(257) == 256 && ring.usedBytes() == 768, "allocations are rounded up to the alignment");
+	check(ring.allocate(0) == RC_RING_FULL, "empty allocations fail");
+	check(ring.allocate(1) == RC_RING_FULL, "a full ring fails");
+
+	ring.build(1024);
+	check(ring.allocate(1025) == RC_RING_FULL, "allocations larger than the ring fail");
+
+	// Per frame fence reuse: bytes of a frame come back only once that frame is retired
+	ring.build(1024);
+	check(ring.allocate(256) == 0, "frame 0 allocates");
+	ring.endFrame(0);
+	check(ring.allocate(256) == 256, "frame 1 allocates after frame 0");
+	ring.endFrame(1);
+	check(ring.allocate(512) == 512, "frame 2 takes the rest");
+	ring.endFrame(2);
+
+	check(ring.allocate(256) == RC_RING_FULL, "nothing is free while every frame is in flight");
+	ring.retire(0);
+	check(ring.oldestFrameInFlight() == 1 && ring.usedBytes() == 768, "retiring frame 0 frees only its bytes");
+	check(ring.allocate(256) == 0, "frame 0's bytes are reused");
+	check(ring.allocate(256) == RC_RING_FULL, "frame 1's bytes are still in flight");
+	ring.endFrame(3);
+
+	ring.retire(3);
+	check(!ring.hasFramesInFlight() && ring.usedBytes() == 0, "retiring a later frame releases every earlier one");
+	check(ring.allocate(256) == 0, "an idle ring starts over at zero");
+
+	// Wraparound: a block never straddles the end, the skipped tail belongs to the frame until it retires
+	ring.build(1024);
+	check(ring.allocate(512) == 0, "frame 0 fills the front");
+	ring.endFrame(0);
+	check(ring.allocate(256) == 512, "frame 1 allocates behind it");
+	ring.endFrame(1);
+	ring.retire(0);
+
+	check(ring.allocate(512) == 0, "a block that does not fit before the end wraps to the front");
+	check(ring.usedBytes() == 1024, "the skipped tail counts as used");
+	ring.endFrame(2);
+	ring.retire(1);
+	check(ring.usedBytes() == 768, "the skipped tail stays used until its frame retires");
+	ring.retire(2);
+	check(ring.usedBytes() == 0, "the skipped tail is released with its frame");
+
+	ring.build(2048);
+	ring.allocate(1024);
+	ring.endFrame(0);
+	ring.allocate(768);
+	ring.endFrame(1);
+	ring.retire(0);
+	check(ring.allocate(512) == 0 && ring.allocate(512) == 512, "a wrapped frame allocates up to the oldest frame in flight");
+	check(ring.allocate(256) == RC_RING_FULL, "and never into it");
+
+	// Random frames with a fence two frames behind: blocks of frames in flight never overlap and stay aligned
+	ring.build(16 * 1024);
+	std::mt19937 random(7);
+	std::vector<Block> live;
+
+	bool aligned     = true;
+	bool overlapFree = true;
+	for (uint64_t frame = 0; frame < 5000; frame++) {
+		const uint32_t allocations = random() % 24;
+		for (uint32_t i = 0; i < allocations; i++) {
+			const size_t size   = 1 + random() % 1200;
+			size_t       offset = ring.allocate(size);
+
+			// What the backend does when the ring is full: wait on the oldest fence and try again
+			while (offset == RC_RING_FULL && ring.hasFramesInFlight()) {
+				ring.retire(ring.oldestFrameInFlight());
+				offset = ring.allocate(size);
+			}
+			if (offset == RC_RING_FULL) break;
+
+			aligned &= offset % RC_CONSTANT_ALIGNMENT == 0 && offset + ConstantRingAllocator::align(size) <= ring.capacity();
+			live.push_back({ frame, offset, ConstantRingAllocator::align(size) });
+		}
+		ring.endFrame(frame);
+		if (frame >= 2 && random() % 2) ring.retire(frame - 2);
+
+		const uint64_t oldest = ring.hasFramesInFlight() ? ring.oldestFrameInFlight() : frame + 1;
+		std::erase_if(live, [oldest](const Block& block) { return block.frame < oldest; });
+
+		for (size_t a = 0; a < live.size(); a++) {
+			for (size_t b = a + 1; b < live.size(); b++) {
+				overlapFree &= live[a].offset + live[a].size <= live[b].offset || live[b].offset + live[b].size <= live[a].offset;
+			}
+		}
+	}
+	check(aligned, "random allocations are aligned and inside the ring");
+	check(overlapFree, "blocks of frames in flight never overlap");
+
+	return finish("ConstantRingTest");
+}
\ No newline at end of file
@@ -0,0 +1,93 @@
+#include "DrawSort.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+// DrawSorter against std::sort and std::stable_sort on draw keys built the way the renderer builds them,
+// 256 kinds of prop sharing 16 shaders at random depths, in submission order
+
+namespace {
+	constexpr int RC_BENCH_ROUNDS = 20;
+
+	template <typename Fn>
+	double millisecondsPerSort(const std::vector<uint64_t>& keys, std::vector<uint64_t>& sortKeys, std::vector<uint32_t>& sortValues, Fn&& sort) {
+		double total = 0.0;
+		for (int i = 0; i < RC_BENCH_ROUNDS; i++) {
+			sortKeys = keys;
+			for (uint32_t v = 0; v < sortValues.size(); v++) sortValues[v] = v;
+
+			const auto start = std::chrono::steady_clock::now();
+			sort();
+			total += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		}
+		return total / RC_BENCH_ROUNDS;
+	}
+}
+
+int main() {
+	const size_t threadsAmount = std::max<unsigned>(std::thread::hardware_concurrency(), 1u);
+	ThreadPool pool;
+	pool.build(threadsAmount);
+
+	DrawSorter serial;
+	serial.build(nullptr, 1);
+	DrawSorter parallel;
+	parallel.build(&pool, threadsAmount);
+
+	std::mt19937 random(35);
+	std::uniform_int_distribution<uint32_t> prop(0, 255);
+	std::uniform_real_distribution<float>   depth(0.0f, 1.0f);
+
+	std::printf("%zu threads, per sort\n", threadsAmount);
+	for (const size_t count : { size_t(10000), size_t(100000), size_t(1000000) }) {
+		std::vector<uint64_t> keys(count);
+		for (auto& key : keys) {
+			const RenderPass pass = random() % 10 == 0 ? RenderPass::Transparent : RenderPass::Opaque;
+			const uint32_t   kind = prop(random);
+			key = drawSortKey(pass, kind % 16 + 1, kind + 1, kind + 1, random() % 3, depth(random));
+		}
+
+		// std::stable_sort of key and value pairs is the order the radix sort has to reproduce
+		std::vector<std::pair<uint64_t, uint32_t>> pairs(count);
+		for (uint32_t i = 0; i < count; i++) pairs[i] = { keys[i], i };
+
+		std::vector<uint64_t> sortKeys(count);
+		std::vector<uint32_t> sortValues(count);
+
+		std::vector<std::pair<uint64_t, uint32_t>> sorted;
+		auto byKey = [](const auto& a, const auto& b) { return a.first < b.first; };
+		const double stable = millisecondsPerSort(keys, sortKeys, sortValues, [&]() {
+			sorted = pairs;
+			std::stable_sort(sorted.begin(), sorted.end(), byKey);
+		});
+		const double unstable = millisecondsPerSort(keys, sortKeys, sortValues, [&]() {
+			std::vector<std::pair<uint64_t, uint32_t>> copy = pairs;
+			std::sort(copy.begin(), copy.end(), byKey);
+		});
+
+		auto matchesStable = [&]() {
+			for (size_t i = 0; i < count; i++) {
+				if (sortKeys[i] != sorted[i].first || sortValues[i] != sorted[i].second) return false;
+			}
+			return true;
+		};
+
+		const double radixSerial   = millisecondsPerSort(keys, sortKeys, sortValues, [&]() { serial.sort(sortKeys.data(), sortValues.data(), count); });
+		const bool   serialOk      = matchesStable();
+		const double radixParallel = millisecondsPerSort(keys, sortKeys, sortValues, [&]() { parallel.sort(sortKeys.data(), sortValues.data(), count); });
+		if (!serialOk || !matchesStable()) {
+			std::printf("FAILED: radix sort order differs from std::stable_sort\n");
+			return 1;
+		}
+
+		std::printf("%zu draws, state changes %zu -> %zu\n", count, countStateChanges(keys.data(), count), countStateChanges(sortKeys.data(), count));
+		std::printf("  DrawSorter, 1 thread    %8.3f ms\n", radixSerial);
+		std::printf("  DrawSorter, %2zu threads  %8.3f ms\n", threadsAmount, radixParallel);
+		std::printf("  std::stable_sort        %8.3f ms\n", stable);
+		std::printf("  std::sort               %8.3f ms\n", unstable);
+	}
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,130 @@
+#include "FlatHashMap.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+// FlatHashMap against std::unordered_map on integer and string keys, after a randomized check that both agree.
+// Global allocations are counted to confirm literal lookups into a std::string keyed map build no temporary string
+
+namespace {
+	std::atomic<size_t> allocations = 0;
+
+	constexpr size_t RC_BENCH_KEYS    = 200000;
+	constexpr int    RC_BENCH_ROUNDS  = 5;
+
+	template <typename Fn>
+	double nanosecondsPerOperation(const size_t operations, Fn&& run) {
+		const auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < RC_BENCH_ROUNDS; i++) run();
+		return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / (operations * RC_BENCH_ROUNDS);
+	}
+
+	// Inserts every key, then looks up every key and as many missing ones, then erases every key
+	template <typename Map, typename KeyList>
+	void benchmark(const char* name, const KeyList& keys, const KeyList& missing) {
+		Map map;
+		size_t found = 0;
+
+		const double insert = nanosecondsPerOperation(keys.size(), [&]() {
+			map = Map();
+			for (size_t i = 0; i < keys.size(); i++) map.insert({ keys[i], i });
+		});
+		const double hit = nanosecondsPerOperation(keys.size(), [&]() {
+			for (const auto& key : keys) found += map.find(key) != map.end();
+		});
+		const double miss = nanosecondsPerOperation(missing.size(), [&]() {
+			for (const auto& key : missing) found += map.find(key) != map.end();
+		});
+		const double erase = nanosecondsPerOperation(keys.size(), [&]() {
+			Map copy = map;
+			for (const auto& key : keys) copy.erase(key);
+		});
+
+		std::printf("  %-24s insert %6.1f  hit %6.1f  miss %6.1f  copy + erase %6.1f ns  (%zu)\n", name, insert, hit, miss, erase, found);
+	}
+
+	bool agreesWithStd() {
+		FlatHashMap<uint64_t, int>        map;
+		std::unordered_map<uint64_t, int> reference;
+
+		std::mt19937_64 random(29);
+		for (int i = 0; i < 200000; i++) {
+			const uint64_t key = random() % 5000;
+			switch (random() % 3) {
+			case 0:
+				map[key]       = i;
+				reference[key] = i;
+				break;
+			case 1:
+				if (map.erase(key) != reference.erase(key)) return false;
+				break;
+			default: {
+				auto it    = map.find(key);
+				auto other = reference.find(key);
+				if ((it == map.end()) != (other == reference.end())) return false;
+				if (other != reference.end() && it->second != other->second) return false;
+			}
+			}
+			if (map.size() != reference.size()) return false;
+		}
+
+		for (auto& [key, value] : map) {
+			auto other = reference.find(key);
+			if (other == reference.end() || other->second != value) return false;
+		}
+		return true;
+	}
+}
+
+void* operator new(const size_t size) {
+	allocations.fetch_add(1, std::memory_order_relaxed);
+	if (void* ptr = std::malloc(size ? size : 1)) return ptr;
+	throw std::bad_alloc();
+}
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+
+int main() {
+	if (!agreesWithStd()) {
+		std::printf("FAILED: FlatHashMap disagrees with std::unordered_map\n");
+		return 1;
+	}
+
+	// Longer than any small string buffer, so a temporary std::string would have to allocate
+	FlatHashMap<std::string, int, StringHash, StringEqual> names;
+	names.emplace("models/environment/rocks/boulder_large.obj", 1);
+
+	const size_t before = allocations.load();
+	const bool   found  = names.find("models/environment/rocks/boulder_large.obj") != names.end() &&
+						  names.contains("models/environment/rocks/boulder_small.obj") == false;
+	if (!found || allocations.load() != before) {
+		std::printf("FAILED: literal lookups allocated %zu times\n", allocations.load() - before);
+		return 1;
+	}
+
+	std::mt19937_64 random(1);
+	std::vector<uint64_t> integers(RC_BENCH_KEYS);
+	std::vector<uint64_t> missingIntegers(RC_BENCH_KEYS);
+	for (auto& key : integers) key = random() | 1;
+	for (auto& key : missingIntegers) key = random() & ~1ull;
+
+	std::vector<std::string> strings(RC_BENCH_KEYS);
+	std::vector<std::string> missingStrings(RC_BENCH_KEYS);
+	for (size_t i = 0; i < RC_BENCH_KEYS; i++) {
+		strings[i]        = "assets/models/prop_" + std::to_string(random()) + ".obj";
+		missingStrings[i] = "assets/textures/prop_" + std::to_string(random()) + ".png";
+	}
+
+	std::printf("%zu keys, per operation\n", RC_BENCH_KEYS);
+	benchmark<FlatHashMap<uint64_t, size_t>>("FlatHashMap<uint64_t>", integers, missingIntegers);
+	benchmark<std::unordered_map<uint64_t, size_t>>("unordered_map<uint64_t>", integers, missingIntegers);
+	benchmark<FlatHashMap<std::string, size_t, StringHash, StringEqual>>("FlatHashMap<string>", strings, missingStrings);
+	benchmark<std::unordered_map<std::string, size_t>>("unordered_map<string>", strings, missingStrings);
+
+	return 0;
+}
\ No newline at end of file
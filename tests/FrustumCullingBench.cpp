@@ -0,0 +1,97 @@
+#include "Frustum.h"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+// Culls 1M spheres and boxes against a camera frustum. The scalar reference lives here. Whether cullRange runs its
+// SSE or AVX2 loop is decided when Frustum.cpp is compiled, so build this once as is and once with AVX2 and FMA
+// enabled (/arch:AVX2, or -mavx2 -mfma) and compare the two runs
+
+namespace {
+	constexpr size_t RC_BENCH_OBJECTS = 1000000;
+	constexpr int    RC_BENCH_FRAMES  = 50;
+
+	template <typename Fn>
+	double millisecondsPerFrame(Fn&& frame) {
+		const auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < RC_BENCH_FRAMES; i++) frame();
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / RC_BENCH_FRAMES;
+	}
+
+	// One object at a time, every plane against the sphere and then the box
+	size_t cullScalar(const Frustum& frustum, const CullBounds& bounds, uint32_t* out) {
+		const bool boxes = bounds.hasBoxes();
+
+		size_t count = 0;
+		for (size_t i = 0; i < bounds.size(); i++) {
+			bool inside = true;
+			for (const auto& plane : frustum.planes) {
+				const float distance = plane.x * bounds.centerX[i] + plane.y * bounds.centerY[i] + plane.z * bounds.centerZ[i] + plane.w;
+				if (distance < -bounds.radius[i]) inside = false;
+				if (boxes && distance < -(fabsf(plane.x) * bounds.extentX[i] + fabsf(plane.y) * bounds.extentY[i] + fabsf(plane.z) * bounds.extentZ[i])) inside = false;
+			}
+			if (inside) out[count++] = static_cast<uint32_t>(i);
+		}
+		return count;
+	}
+}
+
+int main() {
+#if defined(__AVX2__)
+	const char* wide = "AVX2";
+#else
+	const char* wide = "SSE";
+#endif
+
+	const Frustum frustum = extractFrustum(
+		DirectX::XMMatrixLookAtLH(DirectX::XMVectorSet(0.0f, 0.0f, -500.0f, 1.0f), DirectX::XMVectorZero(), DirectX::XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f)),
+		DirectX::XMMatrixPerspectiveFovLH(DirectX::XM_PIDIV4, 16.0f / 9.0f, 0.1f, 1000.0f));
+
+	const size_t threadsAmount = std::max<unsigned>(std::thread::hardware_concurrency(), 1u);
+	ThreadPool pool;
+	pool.build(threadsAmount);
+
+	FrustumCuller culler;
+	culler.build(&pool, threadsAmount);
+
+	std::mt19937 random(37);
+	std::uniform_real_distribution<float> position(-600.0f, 600.0f);
+	std::uniform_real_distribution<float> size(0.5f, 8.0f);
+
+	std::vector<uint32_t> expected(RC_BENCH_OBJECTS);
+	std::vector<uint32_t> visible(RC_BENCH_OBJECTS);
+
+	std::printf("%zu objects, wide path %s, %zu threads\n", RC_BENCH_OBJECTS, wide, threadsAmount);
+	for (const bool boxes : { false, true }) {
+		CullBounds bounds;
+		bounds.resize(RC_BENCH_OBJECTS, boxes);
+		for (size_t i = 0; i < RC_BENCH_OBJECTS; i++) {
+			bounds.centerX[i] = position(random);
+			bounds.centerY[i] = position(random);
+			bounds.centerZ[i] = position(random);
+			bounds.radius[i]  = size(random);
+			if (boxes) bounds.extentX[i] = bounds.extentY[i] = bounds.extentZ[i] = bounds.radius[i] * 0.577f;
+		}
+
+		const size_t expectedCount = cullScalar(frustum, bounds, expected.data());
+		const size_t visibleCount  = cullRange(frustum, bounds, 0, RC_BENCH_OBJECTS, visible.data());
+		const auto&  pooled        = culler.cull(frustum, bounds);
+		if (visibleCount != expectedCount || !std::equal(expected.begin(), expected.begin() + expectedCount, visible.begin()) ||
+			!std::equal(pooled.begin(), pooled.end(), expected.begin(), expected.begin() + expectedCount)) {
+			std::printf("FAILED: %s culling differs from the scalar reference\n", wide);
+			return 1;
+		}
+
+		const double scalar = millisecondsPerFrame([&]() { cullScalar(frustum, bounds, expected.data()); });
+		const double single = millisecondsPerFrame([&]() { cullRange(frustum, bounds, 0, RC_BENCH_OBJECTS, visible.data()); });
+		const double all    = millisecondsPerFrame([&]() { culler.cull(frustum, bounds); });
+
+		std::printf("%s, %zu visible\n", boxes ? "spheres and boxes" : "spheres", expectedCount);
+		std::printf("  scalar            %8.3f ms\n", scalar);
+		std::printf("  %-4s, 1 thread    %8.3f ms  (%.2fx)\n", wide, single, scalar / single);
+		std::printf("  %-4s, %2zu threads  %8.3f ms  (%.2fx)\n", wide, threadsAmount, all, scalar / all);
+	}
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,64 @@
+#include "Instancing.h"
+#include "Check.h"
+
+#include <cstdio>
+
+// Batch formation and instance packing, all on the CPU
+
+int main() {
+	int shader  = 0;
+	int texture = 0;
+	int mesh    = 0;
+	int other   = 0;
+
+	InstanceGroupKey groups[6];
+	for (auto& group : groups) {
+		group.shader    = &shader;
+		group.texture   = &texture;
+		group.mesh      = &mesh;
+		group.instanced = true;
+		group.mergeable = true;
+	}
+	groups[3].mesh      = &other;
+	groups[5].instanced = false;
+
+	// Draw 3 uses another mesh and draw 5 a shader without instancing, the sorted order puts 3 between the runs
+	const uint32_t order[6] = { 0, 1, 2, 4, 3, 5 };
+
+	InstanceData drawInstances[6] = {};
+	for (int i = 0; i < 6; i++) drawInstances[i].world.m[3][0] = static_cast<float>(i);
+
+	InstanceBatcher batcher;
+	const auto& batches = batcher.build(order, 6, groups);
+
+	check(batches.size() == 3, "one batch per run of matching draws");
+	check(batches[0].instanced && batches[0].first == 0 && batches[0].count == 4 && batches[0].instanceOffset == 0, "matching draws merge");
+	check(batches[1].instanced && batches[1].count == 1 && batches[1].instanceOffset == 4, "another mesh starts a new batch");
+	check(!batches[2].instanced && batches[2].count == 1, "a shader without instancing stays a plain draw");
+	check(batcher.getInstanceCount() == 5, "plain draws take no instances");
+
+	InstanceData packed[5] = {};
+	batcher.pack(order, drawInstances, packed);
+	const float expected[5] = { 0.0f, 1.0f, 2.0f, 4.0f, 3.0f };
+	bool packedInOrder = true;
+	for (int i = 0; i < 5; i++) packedInOrder &= packed[i].world.m[3][0] == expected[i];
+	check(packedInOrder, "instances are packed in sorted order");
+
+	// Per-model buffers keep a draw on its own even next to matching ones
+	groups[1].mergeable = false;
+	batcher.build(order, 6, groups);
+	check(batcher.getBatches().size() == 5 && batcher.getBatches()[1].count == 1, "unmergeable draws are not merged");
+	groups[1].mergeable = true;
+
+	groups[2].lod = 1;
+	batcher.build(order, 6, groups);
+	check(batcher.getBatches().size() == 5, "another level of detail starts a new batch");
+	groups[2].lod = 0;
+
+	batcher.maxBatchSize = 3;
+	batcher.build(order, 6, groups);
+	check(batcher.getBatches().size() == 4 && batcher.getBatches()[0].count == 3 && batcher.getBatches()[1].count == 1, "long runs are split");
+	check(batcher.getInstanceCount() == 5, "splitting keeps every instance");
+
+	return finish("InstanceBatcherTest");
+}
\ No newline at end of file
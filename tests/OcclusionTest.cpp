@@ -0,0 +1,127 @@
+#include "Occlusion.h"
+#include "Check.h"
+
+#include <cmath>
+#include <cstdio>
+
+// Known occluder and occludee layouts for the CPU occlusion culler: the rasterized depth, the depth pyramid and the queries.
+// The camera sits at z = -10 looking down +z, walls are 6x6 quads facing it
+
+namespace {
+	DirectX::XMMATRIX camera() {
+		using namespace DirectX;
+
+		const XMMATRIX view = XMMatrixLookAtLH(XMVectorSet(0.0f, 0.0f, -10.0f, 1.0f), XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f), XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f));
+		return view * XMMatrixPerspectiveFovLH(1.0f, 2.0f, 0.1f, 100.0f);
+	}
+
+	Mesh wall() {
+		Mesh mesh;
+		mesh.vertices.resize(4);
+		mesh.vertices[0].position = { -3.0f, -3.0f, 0.0f };
+		mesh.vertices[1].position = {  3.0f, -3.0f, 0.0f };
+		mesh.vertices[2].position = {  3.0f,  3.0f, 0.0f };
+		mesh.vertices[3].position = { -3.0f,  3.0f, 0.0f };
+		mesh.indices     = { 0, 1, 2, 0, 2, 3 };
+		mesh.vertexCount = 4;
+		mesh.indexCount  = 6;
+		return mesh;
+	}
+
+	bool visibleBox(const OcclusionCuller& culler, const float x, const float y, const float z, const float extent) {
+		return culler.visible({ x, y, z }, { extent, extent, extent });
+	}
+
+	float projectedDepth(const DirectX::XMMATRIX& viewProjection, const float z) {
+		const DirectX::XMVECTOR clip = DirectX::XMVector4Transform(DirectX::XMVectorSet(0.0f, 0.0f, z, 1.0f), viewProjection);
+		return DirectX::XMVectorGetZ(clip) / DirectX::XMVectorGetW(clip);
+	}
+
+	void frame(OcclusionCuller& culler, const Mesh& mesh, const DirectX::XMMATRIX& world) {
+		culler.begin(camera());
+		culler.addOccluder(mesh, world);
+		culler.rasterize();
+	}
+}
+
+int main() {
+	using namespace DirectX;
+
+	ThreadPool pool;
+	pool.build(2);
+
+	OcclusionCuller culler;
+	culler.build(&pool, 2);
+
+	const Mesh mesh = wall();
+	const uint32_t width  = culler.getWidth();
+	const uint32_t height = culler.getHeight();
+
+	// Nothing rasterized, nothing can be hidden
+	culler.begin(camera());
+	culler.rasterize();
+	check(!culler.hasOccluders(), "an empty frame has no occluders");
+	check(visibleBox(culler, 0.0f, 0.0f, 5.0f, 0.5f), "an empty frame hides nothing");
+
+	// Rasterizer: the wall covers the middle of the buffer at its own depth and leaves the corners clear
+	frame(culler, mesh, XMMatrixIdentity());
+	check(culler.hasOccluders(), "the wall is an occluder");
+	check(culler.getStats().occluderTriangles == 2, "the wall is two triangles");
+
+	const std::vector<float>& depth = culler.getDepth();
+	check(std::abs(depth[(height / 2) * width + width / 2] - projectedDepth(camera(), 0.0f)) < 1e-3f, "the center texel holds the wall depth");
+	check(depth[0] == 1.0f, "the top left corner stays clear");
+	check(depth[width * height - 1] == 1.0f, "the bottom right corner stays clear");
+
+	// Queries against the single wall
+	check(!visibleBox(culler, 0.0f, 0.0f, 5.0f, 0.5f), "a small box behind the wall is occluded");
+	check(!visibleBox(culler, 0.5f, 0.5f, 50.0f, 1.0f), "a far box behind the wall is occluded");
+	check(visibleBox(culler, 4.2f, 0.0f, 5.0f, 0.5f), "a box reaching past the wall edge is visible");
+	check(visibleBox(culler, 0.0f, 0.0f, -2.0f, 0.5f), "a box in front of the wall is visible");
+	check(visibleBox(culler, 8.0f, 0.0f, 5.0f, 0.5f), "a box beside the wall is visible");
+	check(visibleBox(culler, 0.0f, 0.0f, 5.0f, 4.0f), "a box larger than the wall is visible");
+
+	// cull keeps the visible candidates in order
+	CullBounds bounds;
+	bounds.resize(4, true);
+	const float centers[4][2] = { { 0.0f, 5.0f }, { 8.0f, 5.0f }, { 6.0f, 5.0f }, { 0.0f, -2.0f } };
+	for (size_t i = 0; i < 4; i++) {
+		bounds.centerX[i] = centers[i][0];
+		bounds.centerY[i] = 0.0f;
+		bounds.centerZ[i] = centers[i][1];
+		bounds.radius[i]  = 0.5f;
+		bounds.extentX[i] = bounds.extentY[i] = bounds.extentZ[i] = 0.25f;
+	}
+
+	const uint32_t candidates[4] = { 0, 1, 2, 3 };
+	uint32_t kept[4] = {};
+	const size_t keptCount = culler.cull(bounds, candidates, 4, kept);
+	check(keptCount == 3 && kept[0] == 1 && kept[1] == 2 && kept[2] == 3, "cull keeps the visible candidates in order");
+	check(culler.getStats().tested == 4 && culler.getStats().occluded == 1, "cull counts tested and occluded candidates");
+
+	// An occluder crossing the near plane is dropped instead of clipped
+	frame(culler, mesh, XMMatrixRotationY(XM_PIDIV2) * XMMatrixTranslation(0.0f, 0.0f, -10.0f));
+	check(culler.getStats().occluderTriangles == 0, "a wall through the near plane is dropped");
+	check(visibleBox(culler, 0.0f, 0.0f, 5.0f, 0.5f), "a dropped wall hides nothing");
+
+	// Pyramid: two walls with a gap between them. Coarse levels keep the farthest depth, so the gap stays open at every level
+	culler.begin(camera());
+	culler.addOccluder(mesh, XMMatrixTranslation(-3.5f, 0.0f, 0.0f));
+	culler.addOccluder(mesh, XMMatrixTranslation( 3.5f, 0.0f, 0.0f));
+	culler.rasterize();
+	check(!visibleBox(culler, -3.5f, 0.0f, 5.0f, 0.5f), "a box behind the left wall is occluded");
+	check(!visibleBox(culler,  3.5f, 0.0f, 5.0f, 0.5f), "a box behind the right wall is occluded");
+	check(visibleBox(culler, 0.0f, 0.0f, 5.0f, 0.3f), "a box behind the gap is visible");
+	check(visibleBox(culler, 0.0f, 0.0f, 5.0f, 2.0f), "a box spanning the gap is visible");
+
+	// Bands rasterized on the pool match a single threaded culler
+	OcclusionCuller single;
+	single.build(nullptr, 1);
+	single.begin(camera());
+	single.addOccluder(mesh, XMMatrixTranslation(-3.5f, 0.0f, 0.0f));
+	single.addOccluder(mesh, XMMatrixTranslation( 3.5f, 0.0f, 0.0f));
+	single.rasterize();
+	check(single.getDepth() == culler.getDepth(), "pooled and single threaded depth buffers match");
+
+	return finish("OcclusionTest");
+}
\ No newline at end of file
@@ -0,0 +1,49 @@
+#include "EngineCore.h"
+#include "Prefab.h"
+#include "Check.h"
+
+#include <cstdio>
+
+// Instances share a prefab's resources but never its constant buffers, updateBuffer writes those in place
+
+namespace {
+	struct Tint {
+		float color[4];
+	};
+}
+
+int main() {
+	EngineCore core;
+	core.build({ L"PrefabTest", 320, 240 }, 1, { 64, 1 }, 1);
+	Renderer* renderer = core.getRenderer();
+
+	PrefabManager prefabs;
+	prefabs.build(renderer);
+
+	PrefabDescription description = {};
+	description.vertices           = std::vector<Vertex>(3);
+	description.indices            = { 0, 1, 2 };
+	description.vertexShaderSource = "VSMain";
+	description.pixelShaderSource  = "PSMain";
+	description.texturePath        = "missing.png";
+	const PrefabID id = prefabs.registerPrefab("crate", description);
+
+	// A prototype carrying a buffer, as a model copied from one that had createBuffer called on it would
+	Model* prototype = const_cast<Model*>(prefabs.getPrefab(id));
+	renderer->createBuffer(prototype, PipelineStage::PixelStage, Tint{ { 1.0f, 0.0f, 0.0f, 1.0f } });
+
+	Model first  = prefabs.instantiate(id);
+	Model second = prefabs.instantiate(id);
+
+	check(first.mesh == prototype->mesh && first.shader == prototype->shader && first.texture == prototype->texture, "resources stay shared");
+	check(first.buffers.size() == 1 && second.buffers.size() == 1, "instances keep the prototype's buffers");
+	check(first.buffers[0].buffer && first.buffers[0].buffer.Get() != prototype->buffers[0].buffer.Get(), "an instance gets its own buffer");
+	check(first.buffers[0].buffer.Get() != second.buffers[0].buffer.Get(), "two instances do not share a buffer");
+	check(first.buffers[0].contents == prototype->buffers[0].contents, "a copied buffer starts from the prototype's contents");
+
+	renderer->updateBuffer(&first, Tint{ { 0.0f, 1.0f, 0.0f, 1.0f } }, 0);
+	check(first.buffers[0].contents != second.buffers[0].contents, "updating one instance leaves the others alone");
+	check(second.buffers[0].contents == prototype->buffers[0].contents, "updating one instance leaves the prototype alone");
+
+	return finish("PrefabTest");
+}
\ No newline at end of file
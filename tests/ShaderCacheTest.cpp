@@ -0,0 +1,130 @@
+#include "ShaderCache.h"
+#include "Check.h"
+
+#include <cstdio>
+#include <fstream>
+
+// ShaderCache with a fake compiler that counts its calls: hits, misses, persistence and everything that has to invalidate an entry
+
+namespace {
+	int compiles = 0;
+
+	// The "bytecode" is the source, so a wrong entry served from disk is visible
+	bool fakeCompile(const ShaderCompileRequest& request, ShaderBytecode& out, std::string& error) {
+		compiles++;
+		if (request.source.find("broken") != std::string_view::npos) {
+			error = "broken shader";
+			return false;
+		}
+
+		out.assign(request.source.begin(), request.source.end());
+		return true;
+	}
+
+	// True when the request was served without calling the compiler
+	bool served(ShaderCache& cache, const ShaderCompileRequest& request) {
+		const int before = compiles;
+
+		ShaderBytecode bytecode;
+		const bool found = cache.get(request, bytecode);
+		return found && compiles == before && std::string_view(reinterpret_cast<const char*>(bytecode.data()), bytecode.size()) == request.source;
+	}
+}
+
+int main() {
+	const std::filesystem::path directory = std::filesystem::temp_directory_path() / "RCShaderCacheTest";
+	std::filesystem::remove_all(directory);
+
+	const ShaderCompileRequest request = { "float4 VSMain()", "VSMain", "vs_5_0", {} };
+
+	{
+		ShaderCache cache;
+		check(cache.build(directory, fakeCompile, 1), "the cache directory is created");
+
+		check(!served(cache, request), "the first request compiles");
+		check(served(cache, request), "the same request is a hit");
+		check(cache.getStats().hits == 1 && cache.getStats().misses == 1, "hits and misses are counted");
+
+		// Every part of the request is part of the key
+		const ShaderDefine defines[]      = { { "INSTANCED", "1" } };
+		const ShaderDefine otherDefines[] = { { "INSTANCED", "0" } };
+
+		ShaderCompileRequest changed = request;
+		changed.defines = defines;
+		check(!served(cache, changed), "a define misses");
+		changed.defines = otherDefines;
+		check(!served(cache, changed), "another define value misses");
+
+		changed = request;
+		changed.target = "vs_4_0";
+		check(!served(cache, changed), "another target misses");
+		changed = request;
+		changed.flags = 1;
+		check(!served(cache, changed), "other flags miss");
+		changed = request;
+		changed.source = "float4 VSMain() ";
+		check(!served(cache, changed), "another source misses");
+
+		// Field boundaries are hashed, moving bytes between define name and value is another key
+		const ShaderDefine split[]      = { { "AB", "C" } };
+		const ShaderDefine otherSplit[] = { { "A", "BC" } };
+		ShaderCompileRequest left = request;
+		ShaderCompileRequest right = request;
+		left.defines  = split;
+		right.defines = otherSplit;
+		check(shaderCacheKey(left, 1) != shaderCacheKey(right, 1), "define boundaries are part of the key");
+
+		std::string    error;
+		ShaderBytecode bytecode;
+		const ShaderCompileRequest broken = { "broken VSMain", "VSMain", "vs_5_0", {} };
+		check(!cache.get(broken, bytecode, &error) && error == "broken shader", "compile errors are returned");
+		check(!cache.get(broken, bytecode, &error) && cache.getStats().compileErrors == 2, "failed compiles are not cached");
+		check(cache.size() == 6, "one entry per compiled request");
+	}
+
+	{
+		ShaderCache cache;
+		cache.build(directory, fakeCompile, 1);
+		check(cache.size() == 6, "the index is read back");
+		check(served(cache, request), "entries survive a restart");
+	}
+
+	{
+		// Another compiler version never reads the old entries
+		ShaderCache cache;
+		cache.build(directory, fakeCompile, 2);
+		check(shaderCacheKey(request, 1) != shaderCacheKey(request, 2), "the compiler version is part of the key");
+		check(!served(cache, request), "another compiler version misses");
+		check(served(cache, request), "and caches its own entry");
+	}
+
+	{
+		// A blob that does not match its index record is compiled again
+		ShaderCache cache;
+		cache.build(directory, fakeCompile, 1);
+
+		char name[32];
+		snprintf(name, sizeof(name), "%016llx.cso", static_cast<unsigned long long>(shaderCacheKey(request, 1)));
+		std::ofstream(directory / name, std::ios::binary | std::ios::trunc) << "float4 PSMain()";
+
+		check(!served(cache, request), "a corrupt blob is compiled again");
+		check(cache.getStats().corruptEntries == 1, "corrupt blobs are counted");
+		check(served(cache, request), "the recompiled blob is a hit");
+
+		cache.clear();
+		check(cache.size() == 0, "clear empties the index");
+		check(!served(cache, request), "clear drops every entry");
+	}
+
+	{
+		// Without a directory nothing is kept
+		ShaderCache cache;
+		cache.build({}, fakeCompile, 1);
+		check(!served(cache, request) && !served(cache, request), "a cache without a directory always compiles");
+		check(cache.size() == 0, "a cache without a directory stores nothing");
+	}
+
+	std::filesystem::remove_all(directory);
+
+	return finish("ShaderCacheTest");
+}
\ No newline at end of file
@@ -0,0 +1,152 @@
+#include "StateFilter.h"
+#include "Check.h"
+
+#include <cstdio>
+
+// StateFilter against a recording context: every set call that reaches the context is counted,
+// so redundant binds show up as extra calls instead of needing a device
+
+namespace {
+	struct RecordingContext {
+		int shaders       = 0;
+		int inputLayouts  = 0;
+		int topologies    = 0;
+		int vertexBuffers = 0;
+		int indexBuffers  = 0;
+		int states        = 0;
+		int constants     = 0;
+		int resources     = 0;
+		int samplers      = 0;
+
+		int total() const {
+			return this->shaders + this->inputLayouts + this->topologies + this->vertexBuffers + this->indexBuffers +
+				   this->states + this->constants + this->resources + this->samplers;
+		}
+
+		void VSSetShader(ID3D11VertexShader*, ID3D11ClassInstance* const*, UINT) { this->shaders++; }
+		void PSSetShader(ID3D11PixelShader*, ID3D11ClassInstance* const*, UINT) { this->shaders++; }
+		void IASetInputLayout(ID3D11InputLayout*) { this->inputLayouts++; }
+		void IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY) { this->topologies++; }
+		void IASetVertexBuffers(UINT, UINT, ID3D11Buffer* const*, const UINT*, const UINT*) { this->vertexBuffers++; }
+		void IASetIndexBuffer(ID3D11Buffer*, DXGI_FORMAT, UINT) { this->indexBuffers++; }
+
+		void RSSetState(ID3D11RasterizerState*) { this->states++; }
+		void OMSetDepthStencilState(ID3D11DepthStencilState*, UINT) { this->states++; }
+		void OMSetBlendState(ID3D11BlendState*, const FLOAT*, UINT) { this->states++; }
+
+		void VSSetConstantBuffers(UINT, UINT, ID3D11Buffer* const*) { this->constants++; }
+		void PSSetConstantBuffers(UINT, UINT, ID3D11Buffer* const*) { this->constants++; }
+		void VSSetConstantBuffers1(UINT, UINT, ID3D11Buffer* const*, const UINT*, const UINT*) { this->constants++; }
+		void PSSetConstantBuffers1(UINT, UINT, ID3D11Buffer* const*, const UINT*, const UINT*) { this->constants++; }
+
+		void VSSetShaderResources(UINT, UINT, ID3D11ShaderResourceView* const*) { this->resources++; }
+		void PSSetShaderResources(UINT, UINT, ID3D11ShaderResourceView* const*) { this->resources++; }
+		void VSSetSamplers(UINT, UINT, ID3D11SamplerState* const*) { this->samplers++; }
+		void PSSetSamplers(UINT, UINT, ID3D11SamplerState* const*) { this->samplers++; }
+	};
+
+	// Distinct fake objects, the filter only compares the pointers
+	template <typename T>
+	T* fake(const uintptr_t id) {
+		return reinterpret_cast<T*>(id * 16);
+	}
+
+	// What the handler binds for one mesh draw
+	void draw(StateFilter<RecordingContext>& filter, const uintptr_t material, const uintptr_t mesh, const UINT firstConstant) {
+		filter.setVertexShader(fake<ID3D11VertexShader>(material));
+		filter.setPixelShader(fake<ID3D11PixelShader>(material));
+		filter.setInputLayout(fake<ID3D11InputLayout>(1));
+		filter.setPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+		filter.setVertexBuffer(0, fake<ID3D11Buffer>(100 + mesh), sizeof(Vertex), 0);
+		filter.setIndexBuffer(fake<ID3D11Buffer>(200 + mesh), DXGI_FORMAT_R32_UINT, 0);
+		filter.setRasterizerState(fake<ID3D11RasterizerState>(1));
+		filter.setDepthStencilState(fake<ID3D11DepthStencilState>(1), 0);
+		filter.setBlendState(nullptr, nullptr, 0xFFFFFFFF);
+
+		ID3D11ShaderResourceView* view = fake<ID3D11ShaderResourceView>(300 + material);
+		ID3D11SamplerState*       sampler = fake<ID3D11SamplerState>(1);
+		filter.setShaderResources(PipelineStage::PixelStage, 0, 1, &view);
+		filter.setSamplers(PipelineStage::PixelStage, 0, 1, &sampler);
+		filter.setConstantBufferRange(PipelineStage::VertexStage, 0, fake<ID3D11Buffer>(1), firstConstant, 16);
+	}
+}
+
+int main() {
+	RecordingContext context;
+	StateFilter<RecordingContext> filter;
+	filter.build(&context, &context);
+
+	// 64 draws of 4 meshes sharing 2 materials, sorted by material then mesh. Only changes reach the context
+	for (uintptr_t material = 0; material < 2; material++) {
+		for (uintptr_t i = 0; i < 32; i++) draw(filter, 1 + material, 1 + i / 16 + material * 2, static_cast<UINT>(material * 32 + i) * 16);
+	}
+
+	check(context.shaders == 4, "shaders are bound once per material");
+	check(context.inputLayouts == 1 && context.topologies == 1, "the shared input layout and topology are bound once");
+	check(context.vertexBuffers == 4 && context.indexBuffers == 4, "vertex and index buffers are bound once per mesh");
+	check(context.states == 3, "fixed function states are bound once");
+	check(context.resources == 2 && context.samplers == 1, "textures once per material, the sampler once");
+	check(context.constants == 64, "every draw moves its constant window");
+
+	const uint64_t naive = 64 * 12;
+	check(filter.getCurrentStats().issued == static_cast<uint64_t>(context.total()), "issued counts the calls that reached the context");
+	check(filter.getCurrentStats().issued + filter.getCurrentStats().skipped == naive, "every set call is either issued or skipped");
+
+	// Partial overlaps in a slot range still bind, an identical range does not
+	ID3D11Buffer* buffers[3] = { fake<ID3D11Buffer>(10), fake<ID3D11Buffer>(11), fake<ID3D11Buffer>(12) };
+	int before = context.constants;
+	filter.setConstantBuffers(PipelineStage::PixelStage, 1, 3, buffers);
+	filter.setConstantBuffers(PipelineStage::PixelStage, 1, 3, buffers);
+	filter.setConstantBuffers(PipelineStage::PixelStage, 2, 2, buffers + 1);
+	check(context.constants == before + 1, "a range already bound is skipped");
+	buffers[2] = fake<ID3D11Buffer>(13);
+	filter.setConstantBuffers(PipelineStage::PixelStage, 1, 3, buffers);
+	check(context.constants == before + 2, "a range with one changed slot is bound");
+
+	// The vertex and pixel stages are shadowed apart
+	filter.setConstantBuffers(PipelineStage::VertexStage, 1, 3, buffers);
+	check(context.constants == before + 3, "the same range on the other stage is bound");
+
+	// A whole buffer bind and a window of the same buffer are different bindings
+	ID3D11Buffer* ring = fake<ID3D11Buffer>(1);
+	filter.setConstantBuffers(PipelineStage::VertexStage, 0, 1, &ring);
+	check(context.constants == before + 4, "a whole buffer bind replaces a window");
+
+	// Slots past the shadowed ones always reach the context
+	before = context.resources;
+	ID3D11ShaderResourceView* high = fake<ID3D11ShaderResourceView>(400);
+	filter.setShaderResources(PipelineStage::PixelStage, RC_FILTERED_RESOURCE_SLOTS, 1, &high);
+	filter.setShaderResources(PipelineStage::PixelStage, RC_FILTERED_RESOURCE_SLOTS, 1, &high);
+	check(context.resources == before + 2, "unshadowed slots are never skipped");
+
+	// A null blend factor and an explicit default one are the same state, a different factor is not
+	before = context.states;
+	const FLOAT ones[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	const FLOAT half[4] = { 0.5f, 0.5f, 0.5f, 0.5f };
+	filter.setBlendState(nullptr, ones, 0xFFFFFFFF);
+	filter.setBlendState(nullptr, half, 0xFFFFFFFF);
+	filter.setDepthStencilState(fake<ID3D11DepthStencilState>(1), 1);
+	check(context.states == before + 2, "blend factor and stencil ref changes are bound");
+
+	// Null is a real binding, not the unknown state
+	before = context.shaders;
+	filter.setVertexShader(nullptr);
+	filter.setVertexShader(nullptr);
+	check(context.shaders == before + 1, "binding null twice reaches the context once");
+
+	// A new frame forgets the shadow state and publishes the counters
+	const StateFilterStats frame = filter.getCurrentStats();
+	filter.endFrame();
+	check(filter.getFrameStats().issued == frame.issued && filter.getFrameStats().skipped == frame.skipped, "endFrame publishes the frame counters");
+	check(filter.getCurrentStats().issued == 0 && filter.getCurrentStats().skipped == 0, "endFrame starts new counters");
+
+	before = context.total();
+	draw(filter, 2, 4, 0);
+	check(context.total() == before + 12, "the first draw of a frame binds everything");
+
+	filter.invalidate();
+	draw(filter, 2, 4, 0);
+	check(context.total() == before + 24, "invalidate forgets what was bound");
+
+	return finish("StateFilterTest");
+}
\ No newline at end of file
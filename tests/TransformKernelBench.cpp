@@ -0,0 +1,94 @@
+#include "TransformKernel.h"
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+
+// Compares the per object XMMatrix path the renderer used to take with the stream kernel, 100k transforms per frame
+
+namespace {
+	constexpr size_t RC_BENCH_OBJECTS = 100000;
+	constexpr int    RC_BENCH_FRAMES  = 200;
+
+	template <typename Fn>
+	double millisecondsPerFrame(Fn&& frame) {
+		const auto start = std::chrono::steady_clock::now();
+		for (int i = 0; i < RC_BENCH_FRAMES; i++) frame();
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / RC_BENCH_FRAMES;
+	}
+
+	DirectX::XMMATRIX referenceMatrix(const Transform& transform) {
+		return DirectX::XMMatrixScalingFromVector(transform.scale)
+			 * DirectX::XMMatrixRotationQuaternion(transform.rotation)
+			 * DirectX::XMMatrixTranslationFromVector(transform.position);
+	}
+}
+
+int main() {
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+	std::vector<Transform> transforms(RC_BENCH_OBJECTS);
+	TransformStreams       streams;
+	for (auto& transform : transforms) {
+		transform.position = DirectX::XMVectorSet(unit(random) * 500.0f, unit(random) * 500.0f, unit(random) * 500.0f, 1.0f);
+		transform.rotation = DirectX::XMQuaternionNormalize(DirectX::XMVectorSet(unit(random), unit(random), unit(random), unit(random)));
+		transform.scale    = DirectX::XMVectorSet(unit(random) + 2.0f, unit(random) + 2.0f, unit(random) + 2.0f, 0.0f);
+		streams.push(transform);
+	}
+
+	std::vector<DirectX::XMFLOAT4X4> world(RC_BENCH_OBJECTS);
+	std::vector<DirectX::XMFLOAT4X4> transposed(RC_BENCH_OBJECTS);
+
+	const size_t threadsAmount = std::max<unsigned>(std::thread::hardware_concurrency(), 1u);
+	ThreadPool pool;
+	pool.build(threadsAmount);
+
+	TransformKernel serial;
+	serial.build(nullptr, 1);
+	TransformKernel parallel;
+	parallel.build(&pool, threadsAmount);
+
+	// Both outputs have to match what XMMatrix builds before any timing means something
+	parallel.compose(streams, world.data(), transposed.data());
+	float maxError = 0.0f;
+	for (size_t i = 0; i < RC_BENCH_OBJECTS; i++) {
+		DirectX::XMFLOAT4X4 expected;
+		DirectX::XMFLOAT4X4 expectedTransposed;
+		DirectX::XMStoreFloat4x4(&expected, referenceMatrix(transforms[i]));
+		DirectX::XMStoreFloat4x4(&expectedTransposed, DirectX::XMMatrixTranspose(referenceMatrix(transforms[i])));
+
+		for (int r = 0; r < 4; r++) {
+			for (int c = 0; c < 4; c++) {
+				maxError = std::max(maxError, std::abs(expected.m[r][c] - world[i].m[r][c]));
+				maxError = std::max(maxError, std::abs(expectedTransposed.m[r][c] - transposed[i].m[r][c]));
+			}
+		}
+	}
+	if (maxError > 1e-3f) {
+		std::printf("FAILED: kernel differs from XMMatrix by %g\n", maxError);
+		return 1;
+	}
+
+	const double reference = millisecondsPerFrame([&]() {
+		for (size_t i = 0; i < RC_BENCH_OBJECTS; i++) {
+			const DirectX::XMMATRIX matrix = referenceMatrix(transforms[i]);
+			DirectX::XMStoreFloat4x4(&world[i], matrix);
+			DirectX::XMStoreFloat4x4(&transposed[i], DirectX::XMMatrixTranspose(matrix));
+		}
+	});
+	const double reshuffled = millisecondsPerFrame([&]() {
+		for (size_t i = 0; i < RC_BENCH_OBJECTS; i++) streams.set(i, transforms[i]);
+		serial.compose(streams, world.data(), transposed.data());
+	});
+	const double serialCompose   = millisecondsPerFrame([&]() { serial.compose(streams, world.data(), transposed.data()); });
+	const double parallelCompose = millisecondsPerFrame([&]() { parallel.compose(streams, world.data(), transposed.data()); });
+
+	std::printf("%zu transforms, max error %g\n", RC_BENCH_OBJECTS, maxError);
+	std::printf("XMMatrix per object       %8.3f ms\n", reference);
+	std::printf("AoS to SoA copy + compose %8.3f ms\n", reshuffled);
+	std::printf("compose, 1 thread         %8.3f ms  (%.2fx)\n", serialCompose, reference / serialCompose);
+	std::printf("compose, %2zu threads       %8.3f ms  (%.2fx)\n", threadsAmount, parallelCompose, reference / parallelCompose);
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,83 @@
+#include "EngineCore.h"
+#include "Check.h"
+
+#include <cstdio>
+
+// The renderer's transform streams have to follow the model column through queueing, setTransform, removal and reordering.
+// World bounds are derived from the composed matrices, so each model's bounds must sit where its own transform puts it
+
+namespace {
+	void frame(Renderer* renderer) {
+		renderer->clearScreen();
+		renderer->render();
+		renderer->present();
+	}
+
+	Transform at(const float x) {
+		Transform transform;
+		transform.position = DirectX::XMVectorSet(x, 0.0f, 30.0f, 1.0f);
+		return transform;
+	}
+
+	bool placedAt(Renderer* renderer, const char* name, const float x) {
+		const Model* model = renderer->findModel(name);
+		if (!model || !model->mesh) return false;
+
+		return std::abs(model->bounds.center.x - model->mesh->bounds.center.x - x) < 1e-3f;
+	}
+}
+
+int main() {
+	EngineCore core;
+	core.build({ L"TransformStreamsTest", 320, 240 }, 1, { 64, 1 }, 1);
+	Renderer* renderer = core.getRenderer();
+
+	std::vector<Vertex>   vertices(3);
+	std::vector<uint32_t> indices = { 0, 1, 2 };
+	vertices[0].position = { 0.0f, 0.0f, 0.0f };
+	vertices[1].position = { 1.0f, 0.0f, 0.0f };
+	vertices[2].position = { 0.0f, 1.0f, 0.0f };
+
+	const char* names[]     = { "a", "b", "c", "d" };
+	const float positions[] = { 0.0f, 10.0f, 20.0f, 30.0f };
+	for (int i = 0; i < 4; i++) {
+		Model model     = renderer->createModel(vertices, indices, "VSMain", "PSMain", "missing.png");
+		model.name      = StringTable::intern(names[i]);
+		model.transform = at(positions[i]);
+		renderer->toQueue(std::move(model));
+	}
+
+	frame(renderer);
+	check(placedAt(renderer, "a", 0.0f) && placedAt(renderer, "d", 30.0f), "queued models are composed where they were queued");
+
+	renderer->setTransform("b", at(50.0f));
+	frame(renderer);
+	check(placedAt(renderer, "b", 50.0f), "setTransform reaches the composed matrix");
+	check(placedAt(renderer, "c", 20.0f), "setTransform leaves other models alone");
+
+	renderer->removeModel("a");
+	frame(renderer);
+	check(placedAt(renderer, "b", 50.0f) && placedAt(renderer, "c", 20.0f) && placedAt(renderer, "d", 30.0f), "removal keeps the streams in column order");
+
+	// Reversing the column swaps every entry, the streams must be swapped with them
+	renderer->reorderModels([](const Model& model) { return static_cast<uint64_t>(-DirectX::XMVectorGetX(model.transform.position) + 1000.0f); });
+	for (int i = 0; i < 8; i++) frame(renderer);
+	check(placedAt(renderer, "b", 50.0f) && placedAt(renderer, "c", 20.0f) && placedAt(renderer, "d", 30.0f), "reordering moves the streams with the models");
+
+	renderer->setTransform("d", at(-5.0f));
+	frame(renderer);
+	check(placedAt(renderer, "d", -5.0f) && placedAt(renderer, "b", 50.0f), "setTransform after reordering targets the moved model");
+
+	// Writing Model::transform directly is picked up the same way
+	renderer->findModel("c")->transform = at(100.0f);
+	frame(renderer);
+	check(placedAt(renderer, "c", 100.0f), "a direct write reaches the composed matrix");
+	check(std::abs(DirectX::XMVectorGetX(renderer->findModel("c")->transform.model.r[3]) - 100.0f) < 1e-3f, "a direct write reaches transform.model");
+
+	// Swaps outside the locality pass are not announced to the renderer
+	core.getObjectsManager()->swapEntities<std::unique_ptr<Model>>(0, 2);
+	frame(renderer);
+	check(placedAt(renderer, "b", 50.0f) && placedAt(renderer, "c", 100.0f) && placedAt(renderer, "d", -5.0f), "an unannounced swap keeps every model in place");
+
+	return finish("TransformStreamsTest");
+}
\ No newline at end of file
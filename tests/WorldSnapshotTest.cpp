@@ -0,0 +1,111 @@
+#include "EngineCore.h"
+#include "WorldSnapshot.h"
+#include "Check.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <random>
+
+// Round trips a world through a snapshot, then feeds read() truncated and corrupted copies of the file.
+// Run under AddressSanitizer, a bad file has to be rejected without reading outside the mapping
+
+namespace {
+	struct Velocity {
+		float x;
+		float y;
+		float z;
+	};
+
+	std::vector<char> load(const std::filesystem::path& path) {
+		std::ifstream file(path, std::ios::binary);
+		return std::vector<char>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+	void store(const std::filesystem::path& path, const char* data, const size_t size) {
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		file.write(data, size);
+	}
+}
+
+int main() {
+	EngineCore core;
+	core.build({ L"WorldSnapshotTest", 320, 240 }, 1, { 64, 1 }, 1);
+	ObjectsManager* objectsManager = core.getObjectsManager();
+	Renderer*       renderer       = core.getRenderer();
+
+	objectsManager->registerComponent<Velocity>("Velocity");
+
+	std::vector<EntityHandle> handles;
+	for (int i = 0; i < 5; i++) handles.push_back(objectsManager->createEntity(Velocity{ float(i), 0.0f, 0.0f }));
+	objectsManager->destroyEntity<Velocity>(handles[1]);
+
+	const char* names[] = { "rock", "tree" };
+	for (const char* name : names) {
+		Model model = {};
+		model.name  = StringTable::intern(name);
+		renderer->toQueue(std::move(model));
+	}
+
+	const std::filesystem::path path    = std::filesystem::temp_directory_path() / "WorldSnapshotTest.rcws";
+	const std::filesystem::path corrupt = std::filesystem::temp_directory_path() / "WorldSnapshotTest.corrupt.rcws";
+
+	WorldSnapshot snapshot;
+	check(snapshot.write(path.string(), objectsManager), "the snapshot is written");
+
+	size_t resolved = 0;
+	SnapshotResolver resolver = [&resolved](const std::string_view, const std::string_view) {
+		resolved++;
+		return Model{};
+	};
+
+	check(snapshot.read(path.string(), objectsManager, renderer, resolver), "the snapshot reads back");
+	check(resolved == 2, "every saved model goes through the resolver");
+	check(objectsManager->resolve<Velocity>(handles[1]) == nullptr, "a destroyed entity stays destroyed");
+	check(objectsManager->resolve<Velocity>(handles[4]) && objectsManager->resolve<Velocity>(handles[4])->x == 4.0f, "saved handles resolve to their components");
+
+	const std::vector<char> bytes = load(path);
+
+	// The writer pads the file to the snapshot alignment, anything shorter than that misses real data
+	bool rejectedTruncated = true;
+	for (size_t length = 0; length + RC_SNAPSHOT_ALIGNMENT <= bytes.size(); length++) {
+		store(corrupt, bytes.data(), length);
+		rejectedTruncated &= !snapshot.read(corrupt.string(), objectsManager, renderer, resolver);
+	}
+	check(rejectedTruncated, "every truncated snapshot is rejected");
+
+	// Oversized lengths in the headers
+	std::vector<char> edited = bytes;
+	SnapshotHeader header = {};
+	memcpy(&header, bytes.data(), sizeof(SnapshotHeader));
+
+	SnapshotHeader hugeStrings = header;
+	hugeStrings.stringTableSize = UINT64_MAX - 4;
+	memcpy(edited.data(), &hugeStrings, sizeof(SnapshotHeader));
+	store(corrupt, edited.data(), edited.size());
+	check(!snapshot.read(corrupt.string(), objectsManager, renderer, resolver), "an oversized string table is rejected");
+
+	SnapshotHeader hugeModels = header;
+	hugeModels.modelCount = UINT32_MAX;
+	memcpy(edited.data(), &hugeModels, sizeof(SnapshotHeader));
+	store(corrupt, edited.data(), edited.size());
+	check(!snapshot.read(corrupt.string(), objectsManager, renderer, resolver), "an oversized model count is rejected");
+
+	edited = bytes;
+	edited[sizeof(SnapshotHeader) + header.stringTableSize - 1] = 'x';
+	store(corrupt, edited.data(), edited.size());
+	check(!snapshot.read(corrupt.string(), objectsManager, renderer, resolver), "an unterminated string table is rejected");
+
+	// Random damage may or may not be detected, it must never read out of bounds
+	std::mt19937 random(26);
+	for (int i = 0; i < 2000; i++) {
+		edited = bytes;
+		for (int flips = 0; flips < 4; flips++) edited[random() % edited.size()] = static_cast<char>(random());
+
+		store(corrupt, edited.data(), edited.size());
+		snapshot.read(corrupt.string(), objectsManager, renderer, resolver);
+	}
+
+	std::filesystem::remove(path);
+	std::filesystem::remove(corrupt);
+
+	return finish("WorldSnapshotTest");
+}
\ No newline at end of file